@@ -0,0 +1,425 @@
+// Allocation patterns that look more like real programs than "allocate all, free all"
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+#include "Memory_pool.h"
+#include "Size_class_allocator.h"
+
+/*
+	Targets
+	-------
+	The workloads talk to every allocator through the same small interface:
+
+		auto&& local = target.Local();   // per thread handle, once per thread
+		void* p = local.Allocate(size);
+		local.Deallocate(p, size);
+
+	s_MaxSize     biggest request the target takes, 0 = any size
+	s_ThreadSafe  whether several threads may share the target
+
+	Most targets are their own handle. ConcurrentPoolTarget hands out a
+	ThreadCache per thread, which is how that pool is meant to be used.
+*/
+class NewDeleteTarget
+{
+public:
+    static constexpr size_t s_MaxSize = 0;
+    static constexpr bool s_ThreadSafe = true;
+
+    NewDeleteTarget& Local() { return *this; }
+
+    void* Allocate(const size_t size) { return ::operator new(size); }
+    void Deallocate(void* p, const size_t size) { ::operator delete(p, size); }
+};
+
+class MallocTarget
+{
+public:
+    static constexpr size_t s_MaxSize = 0;
+    static constexpr bool s_ThreadSafe = true;
+
+    MallocTarget& Local() { return *this; }
+
+    void* Allocate(const size_t size)
+    {
+        void* p = std::malloc(size);
+        if (!p)
+        {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    void Deallocate(void* p, const size_t) { std::free(p); }
+};
+
+template<typename T, typename Layout = DefaultLayout>
+class PoolTarget
+{
+    MemoryPool<T, Layout>& m_Pool;
+
+public:
+    static constexpr size_t s_MaxSize = sizeof(T);
+    static constexpr bool s_ThreadSafe = false;
+
+    explicit PoolTarget(MemoryPool<T, Layout>& pool) : m_Pool(pool) {}
+
+    PoolTarget& Local() { return *this; }
+
+    void* Allocate(const size_t) { return m_Pool.Allocate(); }
+    void Deallocate(void* p, const size_t) { m_Pool.Deallocate(static_cast<T*>(p)); }
+};
+
+// The "global mutex" baseline
+template<typename T>
+class LockedPoolTarget
+{
+    MemoryPool<T>& m_Pool;
+    std::mutex m_Lock;
+
+public:
+    static constexpr size_t s_MaxSize = sizeof(T);
+    static constexpr bool s_ThreadSafe = true;
+
+    explicit LockedPoolTarget(MemoryPool<T>& pool) : m_Pool(pool) {}
+
+    LockedPoolTarget& Local() { return *this; }
+
+    void* Allocate(const size_t)
+    {
+        std::lock_guard<std::mutex> guard(m_Lock);
+        return m_Pool.Allocate();
+    }
+
+    void Deallocate(void* p, const size_t)
+    {
+        std::lock_guard<std::mutex> guard(m_Lock);
+        m_Pool.Deallocate(static_cast<T*>(p));
+    }
+};
+
+template<typename T, typename Layout = DefaultLayout>
+class ConcurrentPoolTarget
+{
+    ConcurrentMemoryPool<T, Layout>& m_Pool;
+
+public:
+    static constexpr size_t s_MaxSize = sizeof(T);
+    static constexpr bool s_ThreadSafe = true;
+
+    class Handle
+    {
+        typename ConcurrentMemoryPool<T, Layout>::ThreadCache m_Cache;
+
+    public:
+        explicit Handle(ConcurrentMemoryPool<T, Layout>& pool) : m_Cache(pool) {}
+
+        void* Allocate(const size_t) { return m_Cache.Allocate(); }
+        void Deallocate(void* p, const size_t) { m_Cache.Deallocate(static_cast<T*>(p)); }
+    };
+
+    explicit ConcurrentPoolTarget(ConcurrentMemoryPool<T, Layout>& pool) : m_Pool(pool) {}
+
+    Handle Local() { return Handle(m_Pool); }
+};
+
+class SizeClassTarget
+{
+    SizeClassAllocator& m_Allocator;
+
+public:
+    static constexpr size_t s_MaxSize = 0;
+    static constexpr bool s_ThreadSafe = false;
+
+    explicit SizeClassTarget(SizeClassAllocator& allocator) : m_Allocator(allocator) {}
+
+    SizeClassTarget& Local() { return *this; }
+
+    void* Allocate(const size_t size) { return m_Allocator.Allocate(size); }
+    void Deallocate(void* p, const size_t size) { m_Allocator.Deallocate(p, size); }
+};
+
+struct WorkloadConfig
+{
+    size_t liveBlocks = 100'000;   // Blocks alive at the same time
+    size_t operations = 1'000'000; // Allocations per run in the streaming workloads
+    size_t blockSize = 64;         // Request size of the fixed size workloads
+    size_t minSize = 16;           // Range of the mixed size workload
+    size_t maxSize = 512;
+    size_t window = 1'000;         // Lifetime of a block in the sliding window, in allocations
+    size_t producerThreads = 1;    // Producer / consumer pairs
+    uint64_t seed = 42;
+};
+
+/*
+	All random choices (free order, sizes, churn victims) are drawn once in the
+	constructor with a fixed seed, so every allocator replays exactly the same
+	sequence and the timed loops don't pay for the RNG.
+
+	Every block gets one word written on allocation and read back before it is
+	freed, like a real object would, so poor locality shows up in the numbers.
+*/
+class AllocationWorkloads
+{
+    WorkloadConfig m_Config;
+    std::vector<uint32_t> m_FreeOrder;   // Permutation of the live blocks
+    std::vector<uint32_t> m_Sizes;       // One per live block, for MixedSizes
+    std::vector<uint32_t> m_Victims;     // Live block replaced by each churn step
+
+    static void Touch(void* p, uint64_t value)
+    {
+        *static_cast<uint64_t*>(p) = value;
+    }
+
+    static uint64_t Read(const void* p)
+    {
+        return *static_cast<const uint64_t*>(p);
+    }
+
+    // A handful of pointers handed from a producer to its consumer under one lock
+    struct t_Channel
+    {
+        std::mutex lock;
+        std::condition_variable ready;
+        std::condition_variable space;
+        std::deque<std::vector<void*>> batches;
+        bool done = false;
+    };
+
+    static constexpr size_t s_BatchSize = 64;
+
+public:
+    explicit AllocationWorkloads(const WorkloadConfig& config = {}) : m_Config(config)
+    {
+        std::mt19937_64 rng(m_Config.seed);
+
+        m_FreeOrder.resize(m_Config.liveBlocks);
+        for (size_t i = 0; i < m_FreeOrder.size(); i++)
+		{
+			m_FreeOrder[i] = uint32_t(i);
+		}
+        std::shuffle(m_FreeOrder.begin(), m_FreeOrder.end(), rng);
+
+        std::uniform_int_distribution<uint32_t> size_dist(uint32_t(m_Config.minSize), uint32_t(m_Config.maxSize));
+        m_Sizes.resize(m_Config.liveBlocks);
+        for (auto& size : m_Sizes)
+		{
+			size = size_dist(rng);
+		}
+
+        std::uniform_int_distribution<uint32_t> victim_dist(0, uint32_t(m_Config.liveBlocks - 1));
+        m_Victims.resize(m_Config.operations);
+        for (auto& victim : m_Victims)
+		{
+			victim = victim_dist(rng);
+		}
+    }
+
+    const WorkloadConfig& Config() const { return m_Config; }
+
+	// Allocate 'liveBlocks', then free them in random order: the free list ends up shuffled
+    template<typename Target>
+    void RandomOrderFree(Target& target) const
+    {
+        auto&& local = target.Local();
+        std::vector<void*> blocks(m_Config.liveBlocks);
+        uint64_t sum = 0;
+
+        for (size_t i = 0; i < blocks.size(); i++)
+		{
+			blocks[i] = local.Allocate(m_Config.blockSize);
+			Touch(blocks[i], i);
+		}
+
+        for (uint32_t index : m_FreeOrder)
+		{
+			sum += Read(blocks[index]);
+			local.Deallocate(blocks[index], m_Config.blockSize);
+		}
+        DoNotOptimize(sum);
+    }
+
+	// Same, with sizes spread over [minSize, maxSize]
+    template<typename Target>
+    void MixedSizes(Target& target) const
+    {
+        auto&& local = target.Local();
+        std::vector<void*> blocks(m_Config.liveBlocks);
+        uint64_t sum = 0;
+
+        for (size_t i = 0; i < blocks.size(); i++)
+		{
+			blocks[i] = local.Allocate(m_Sizes[i]);
+			Touch(blocks[i], i);
+		}
+
+        for (uint32_t index : m_FreeOrder)
+		{
+			sum += Read(blocks[index]);
+			local.Deallocate(blocks[index], m_Sizes[index]);
+		}
+        DoNotOptimize(sum);
+    }
+
+	// FIFO lifetimes: every allocation frees the block allocated 'window' steps earlier
+    template<typename Target>
+    void SlidingWindow(Target& target) const
+    {
+        auto&& local = target.Local();
+        std::vector<void*> ring(m_Config.window, nullptr);
+        uint64_t sum = 0;
+
+        for (size_t i = 0; i < m_Config.operations; i++)
+		{
+			void*& slot = ring[i % ring.size()];
+			if (slot)
+			{
+				sum += Read(slot);
+				local.Deallocate(slot, m_Config.blockSize);
+			}
+			slot = local.Allocate(m_Config.blockSize);
+			Touch(slot, i);
+		}
+
+        for (void* p : ring)
+		{
+			if (p)
+			{
+				local.Deallocate(p, m_Config.blockSize);
+			}
+		}
+        DoNotOptimize(sum);
+    }
+
+	/*
+		Fill up to 'liveBlocks', then replace random blocks one at a time, so
+		occupancy stays constant while the free list gets thoroughly mixed.
+		A final pass reads every live block: after fragmentation a pool that
+		hands out scattered blocks pays for it here.
+	*/
+    template<typename Target>
+    void SteadyStateChurn(Target& target) const
+    {
+        auto&& local = target.Local();
+        std::vector<void*> blocks(m_Config.liveBlocks);
+        uint64_t sum = 0;
+
+        for (size_t i = 0; i < blocks.size(); i++)
+		{
+			blocks[i] = local.Allocate(m_Config.blockSize);
+			Touch(blocks[i], i);
+		}
+
+        for (size_t i = 0; i < m_Victims.size(); i++)
+		{
+			void*& victim = blocks[m_Victims[i]];
+			sum += Read(victim);
+			local.Deallocate(victim, m_Config.blockSize);
+			victim = local.Allocate(m_Config.blockSize);
+			Touch(victim, i);
+		}
+
+        for (void* p : blocks)
+		{
+			sum += Read(p);
+			local.Deallocate(p, m_Config.blockSize);
+		}
+        DoNotOptimize(sum);
+    }
+
+	/*
+		Producers allocate and consumers free, so every block is released by a
+		thread other than the one that allocated it. At most 'liveBlocks' are
+		in flight, producers wait when their consumer falls behind.
+	*/
+    template<typename Target>
+    void ProducerConsumer(Target& target) const
+    {
+        static_assert(Target::s_ThreadSafe, "ProducerConsumer needs a thread safe target");
+
+        size_t pairs = std::max<size_t>(1, m_Config.producerThreads);
+        size_t max_batches = std::max<size_t>(1, m_Config.liveBlocks / pairs / s_BatchSize);
+        std::vector<t_Channel> channels(pairs);
+        std::vector<std::thread> threads;
+        std::vector<uint64_t> sums(pairs, 0);
+
+        for (size_t t = 0; t < pairs; t++)
+		{
+			size_t count = m_Config.operations / pairs + (t < m_Config.operations % pairs ? 1 : 0);
+			t_Channel& channel = channels[t];
+
+			threads.emplace_back([&, count]()
+			{
+				auto&& local = target.Local();
+				std::vector<void*> batch;
+				batch.reserve(s_BatchSize);
+
+				for (size_t i = 0; i < count; i++)
+				{
+					void* p = local.Allocate(m_Config.blockSize);
+					Touch(p, i);
+					batch.push_back(p);
+
+					if (batch.size() == s_BatchSize || i + 1 == count)
+					{
+						std::unique_lock<std::mutex> lock(channel.lock);
+						channel.space.wait(lock, [&]() { return channel.batches.size() < max_batches; });
+						channel.batches.push_back(std::move(batch));
+						channel.ready.notify_one();
+						batch.clear();
+						batch.reserve(s_BatchSize);
+					}
+				}
+
+				std::lock_guard<std::mutex> lock(channel.lock);
+				channel.done = true;
+				channel.ready.notify_one();
+			});
+
+			threads.emplace_back([&, t]()
+			{
+				auto&& local = target.Local();
+				uint64_t sum = 0;
+
+				for (;;)
+				{
+					std::vector<void*> batch;
+					{
+						std::unique_lock<std::mutex> lock(channel.lock);
+						channel.ready.wait(lock, [&]() { return !channel.batches.empty() || channel.done; });
+						if (channel.batches.empty())
+						{
+							break;
+						}
+						batch = std::move(channel.batches.front());
+						channel.batches.pop_front();
+						channel.space.notify_one();
+					}
+
+					for (void* p : batch)
+					{
+						sum += Read(p);
+						local.Deallocate(p, m_Config.blockSize);
+					}
+				}
+				sums[t] = sum;
+			});
+		}
+
+        for (auto& thread : threads)
+		{
+			thread.join();
+		}
+        DoNotOptimize(sums.data());
+    }
+};
@@ -0,0 +1,215 @@
+// Plug Arena and MemoryPool into standard containers (std::pmr and classic allocators)
+#pragma once
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <new>
+#include "Arena.h"
+#include "Memory_pool.h"
+#include "Size_class_allocator.h"
+
+/*
+	memory_resource adapters
+	------------------------
+	ArenaResource      any size, deallocate is a no-op, free everything with Arena::reset()
+	PoolResource<T>    fixed size blocks from a MemoryPool<T>, bigger requests go upstream
+	SizeClassResource  any size, small ones from SizeClassAllocator (one MemoryPool per class)
+
+	None of them lock, so give each thread (or each request) its own resource.
+*/
+class ArenaResource : public std::pmr::memory_resource
+{
+    Arena& m_Arena;
+
+public:
+    explicit ArenaResource(Arena& arena) : m_Arena(arena) {}
+
+    Arena& arena() const { return m_Arena; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        return m_Arena.allocate(bytes, alignment);
+    }
+
+    // Memory comes back all at once when the arena is reset
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+template<typename T, typename Layout = DefaultLayout>
+class PoolResource : public std::pmr::memory_resource
+{
+    MemoryPool<T, Layout>& m_Pool;
+    std::pmr::memory_resource* m_Upstream;
+
+    static bool FitsBlock(size_t bytes, size_t alignment)
+    {
+        return bytes <= sizeof(T) && alignment <= alignof(T);
+    }
+
+public:
+    explicit PoolResource(MemoryPool<T, Layout>& pool,
+                          std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : m_Pool(pool), m_Upstream(upstream)
+    {
+    }
+
+    MemoryPool<T, Layout>& pool() const { return m_Pool; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        if (FitsBlock(bytes, alignment))
+        {
+            return m_Pool.Allocate();
+        }
+        return m_Upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        if (FitsBlock(bytes, alignment))
+        {
+            m_Pool.Deallocate(static_cast<T*>(p));
+            return;
+        }
+        m_Upstream->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+class SizeClassResource : public std::pmr::memory_resource
+{
+    SizeClassAllocator& m_Allocator;
+    std::pmr::memory_resource* m_Upstream;
+
+    // Size class blocks are 16 byte aligned, anything stricter goes upstream
+    static bool FitsClass(size_t alignment)
+    {
+        return alignment <= SizeClassAllocator::s_Granularity;
+    }
+
+public:
+    explicit SizeClassResource(SizeClassAllocator& allocator,
+                               std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : m_Allocator(allocator), m_Upstream(upstream)
+    {
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        if (FitsClass(alignment))
+        {
+            return m_Allocator.Allocate(bytes);
+        }
+        return m_Upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        if (FitsClass(alignment))
+        {
+            m_Allocator.Deallocate(p, bytes);
+            return;
+        }
+        m_Upstream->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+/*
+	Classic allocators
+	------------------
+	For code that takes an Allocator template argument instead of a
+	memory_resource. Both are cheap to copy (a single pointer) and rebind
+	to node types, so they work with std::list, std::map and friends.
+*/
+template<typename T>
+class ArenaAllocator
+{
+    template<typename U>
+    friend class ArenaAllocator;
+
+    Arena* m_Arena;
+
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(Arena& arena) noexcept : m_Arena(&arena) {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_Arena(other.m_Arena) {}
+
+    T* allocate(size_t n)
+    {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+        return m_Arena->allocate<T>(n);
+    }
+
+    void deallocate(T*, size_t) noexcept {}
+
+    Arena& arena() const noexcept { return *m_Arena; }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept
+    {
+        return m_Arena == other.m_Arena;
+    }
+};
+
+// MemoryPool is typed, a rebindable allocator needs every size, so this one sits on SizeClassAllocator
+template<typename T>
+class PoolAllocator
+{
+    template<typename U>
+    friend class PoolAllocator;
+
+    SizeClassAllocator* m_Allocator;
+
+    static_assert(alignof(T) <= SizeClassAllocator::s_Granularity, "PoolAllocator: over-aligned type");
+
+public:
+    using value_type = T;
+
+    explicit PoolAllocator(SizeClassAllocator& allocator) noexcept : m_Allocator(&allocator) {}
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept : m_Allocator(other.m_Allocator) {}
+
+    T* allocate(size_t n)
+    {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(m_Allocator->Allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        m_Allocator->Deallocate(p, n * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U>& other) const noexcept
+    {
+        return m_Allocator == other.m_Allocator;
+    }
+};
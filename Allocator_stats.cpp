@@ -0,0 +1,111 @@
+// Watching pool and arena load with ALLOCATOR_STATS: occupancy, high-water marks, failures and leaks
+#define ALLOCATOR_STATS 1 // Normally passed on the command line (-DALLOCATOR_STATS=1)
+#include <iostream>
+#include <array>
+#include <new>
+#include <thread>
+#include <vector>
+#include "Arena.h"
+#include "Memory_pool.h"
+
+using Block = std::array<char, 64>;
+
+void PrintStats(const char* name, const AllocatorStatsSnapshot& stats)
+{
+    std::cout << name << ": " << stats.allocations << " allocations, " << stats.deallocations << " deallocations, "
+              << stats.live << " live, peak " << stats.peak << ", " << stats.failures << " failed\n";
+}
+
+// Allocates a few blocks and "forgets" to give one back
+void LeakyHandler(MemoryPool<Block>& pool)
+{
+    Block* header = pool.Allocate();
+    Block* body = pool.Allocate();
+    pool.Deallocate(body);
+    (void)header;
+}
+
+int main()
+{
+    // How close does a fixed size pool get to std::bad_alloc?
+    {
+        MemoryPool<Block> pool(1000);
+        std::vector<Block*> blocks;
+        for (int i = 0; i < 900; i++)
+		{
+			blocks.push_back(pool.Allocate());
+		}
+        for (int i = 0; i < 400; i++)
+		{
+			pool.Deallocate(blocks.back());
+			blocks.pop_back();
+		}
+
+        try
+        {
+            for (;;)
+			{
+				blocks.push_back(pool.Allocate());
+			}
+        }
+        catch (const std::bad_alloc&)
+        {
+        }
+
+        PrintStats("MemoryPool", pool.Stats());
+        for (Block* block : blocks)
+		{
+			pool.Deallocate(block);
+		}
+    }
+
+    // Thread caches add their counts to the pool once per magazine
+    {
+        ConcurrentMemoryPool<Block> pool(64 * 1024);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+		{
+			threads.emplace_back([&pool]()
+			{
+				ConcurrentMemoryPool<Block>::ThreadCache cache(pool);
+				std::vector<Block*> blocks;
+				for (int i = 0; i < 10'000; i++)
+				{
+					blocks.push_back(cache.Allocate());
+				}
+				for (Block* block : blocks)
+				{
+					cache.Deallocate(block);
+				}
+			});
+		}
+        for (auto& thread : threads)
+		{
+			thread.join();
+		}
+        PrintStats("ConcurrentMemoryPool", pool.Stats());
+    }
+
+    // Arenas report bytes: the peak is the size to give the first block
+    {
+        Arena arena(4096);
+        for (int request = 0; request < 100; request++)
+		{
+			Arena::Savepoint scratch(arena);
+			arena.allocate<double>(100 + request * 10);
+		}
+        PrintStats("Arena (bytes)", arena.stats());
+    }
+
+    // A pool destroyed with blocks still out prints a leak report, with call sites in debug builds
+    {
+        MemoryPool<Block> pool(16);
+        for (int i = 0; i < 3; i++)
+		{
+			LeakyHandler(pool);
+		}
+        std::cout << "\nDestroying a pool with leaked blocks:\n" << std::flush;
+    }
+
+    return 0;
+}
@@ -0,0 +1,213 @@
+// Optional counters for pools and arenas: load, high-water mark, failures and leaks
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+/*
+	Build with -DALLOCATOR_STATS=1 to turn the counters on. Without it every
+	hook below is an empty inline function and the stats member of a pool
+	takes no space ([[no_unique_address]]), so normal builds pay nothing.
+
+	With ALLOCATOR_STATS and without NDEBUG the call site of every live block
+	is recorded too, and the leak report printed when a pool is destroyed
+	says where the leaked blocks were allocated. -DALLOCATOR_TRACK_SITES=0
+	or 1 overrides that choice.
+*/
+#if !defined(ALLOCATOR_STATS)
+#define ALLOCATOR_STATS 0
+#endif
+
+#if !defined(ALLOCATOR_TRACK_SITES)
+#if ALLOCATOR_STATS && !defined(NDEBUG)
+#define ALLOCATOR_TRACK_SITES 1
+#else
+#define ALLOCATOR_TRACK_SITES 0
+#endif
+#endif
+
+#if ALLOCATOR_TRACK_SITES
+#include <map>
+#include <mutex>
+#include <source_location>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#endif
+
+// Where an allocation came from. Empty (and free to pass around) unless sites are tracked.
+#if ALLOCATOR_TRACK_SITES
+using AllocationSite = std::source_location;
+#else
+struct AllocationSite
+{
+    static constexpr AllocationSite current() noexcept { return {}; }
+};
+#endif
+
+struct AllocatorStatsSnapshot
+{
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0; // Arenas: rollback() and reset() calls
+    uint64_t failures = 0;      // Requests that threw std::bad_alloc or returned nullptr
+    uint64_t live = 0;          // Blocks in use (pools) or bytes in use (arenas)
+    uint64_t peak = 0;          // High-water mark of 'live'
+};
+
+/*
+	Counters owned by one pool or arena. 'Shared' is true for owners that are
+	used by several threads at once (ConcurrentMemoryPool); only those pay for
+	atomic read-modify-writes. Everything is relaxed: the numbers are for
+	monitoring, nothing synchronizes on them.
+*/
+#if ALLOCATOR_STATS
+template<bool Shared>
+class alignas(Shared ? 64 : alignof(uint64_t)) AllocatorStats // Shared: own cache line, away from the pool's hot fields
+{
+    std::atomic<uint64_t> m_Allocations{ 0 };
+    std::atomic<uint64_t> m_Deallocations{ 0 };
+    std::atomic<uint64_t> m_Failures{ 0 };
+    std::atomic<uint64_t> m_Peak{ 0 };
+
+#if ALLOCATOR_TRACK_SITES
+    mutable std::mutex m_SitesLock;
+    std::unordered_map<const void*, AllocationSite> m_Sites;
+#endif
+
+    static void Add(std::atomic<uint64_t>& counter, uint64_t n)
+    {
+        if constexpr (Shared)
+        {
+            counter.fetch_add(n, std::memory_order_relaxed);
+        }
+        else
+        {
+            // Single owner thread: a plain increment, no locked instruction
+            counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    static constexpr bool s_Enabled = true;
+
+    uint64_t Live() const
+    {
+        uint64_t allocations = m_Allocations.load(std::memory_order_relaxed);
+        uint64_t deallocations = m_Deallocations.load(std::memory_order_relaxed);
+        return allocations > deallocations ? allocations - deallocations : 0;
+    }
+
+    void RaisePeak(uint64_t value)
+    {
+        uint64_t peak = m_Peak.load(std::memory_order_relaxed);
+        while (value > peak && !m_Peak.compare_exchange_weak(peak, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void CountAllocations(uint64_t n) { Add(m_Allocations, n); }
+    void CountDeallocations(uint64_t n) { Add(m_Deallocations, n); }
+    void CountFailure() { Add(m_Failures, 1); }
+
+    void TrackSite([[maybe_unused]] const void* p, [[maybe_unused]] const AllocationSite& site)
+    {
+#if ALLOCATOR_TRACK_SITES
+        std::lock_guard<std::mutex> guard(m_SitesLock);
+        m_Sites[p] = site;
+#endif
+    }
+
+    void ForgetSite([[maybe_unused]] const void* p)
+    {
+#if ALLOCATOR_TRACK_SITES
+        std::lock_guard<std::mutex> guard(m_SitesLock);
+        m_Sites.erase(p);
+#endif
+    }
+
+    // One block handed out / given back by a pool
+    void OnAllocate(const void* p, const AllocationSite& site)
+    {
+        CountAllocations(1);
+        RaisePeak(Live());
+        TrackSite(p, site);
+    }
+
+    void OnDeallocate(const void* p)
+    {
+        CountDeallocations(1);
+        ForgetSite(p);
+    }
+
+    AllocatorStatsSnapshot Snapshot() const
+    {
+        return Snapshot(Live());
+    }
+
+    // For owners that measure 'live' themselves (arenas count bytes, not blocks)
+    AllocatorStatsSnapshot Snapshot(uint64_t live) const
+    {
+        AllocatorStatsSnapshot snapshot;
+        snapshot.allocations = m_Allocations.load(std::memory_order_relaxed);
+        snapshot.deallocations = m_Deallocations.load(std::memory_order_relaxed);
+        snapshot.failures = m_Failures.load(std::memory_order_relaxed);
+        snapshot.live = live;
+        snapshot.peak = m_Peak.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+    // Printed by pools on destruction when blocks are still out
+    void ReportLeaks(const char* owner) const
+    {
+        uint64_t live = Live();
+        if (!live)
+        {
+            return;
+        }
+
+        std::fprintf(stderr, "%s: %llu blocks still allocated (%llu allocations, %llu deallocations, peak %llu)\n",
+                     owner, (unsigned long long)live,
+                     (unsigned long long)m_Allocations.load(std::memory_order_relaxed),
+                     (unsigned long long)m_Deallocations.load(std::memory_order_relaxed),
+                     (unsigned long long)m_Peak.load(std::memory_order_relaxed));
+
+#if ALLOCATOR_TRACK_SITES
+        std::map<std::pair<std::string, uint32_t>, std::pair<std::string, uint64_t>> by_site;
+        {
+            std::lock_guard<std::mutex> guard(m_SitesLock);
+            for (const auto& [block, site] : m_Sites)
+            {
+                auto& entry = by_site[{ site.file_name(), site.line() }];
+                entry.first = site.function_name();
+                ++entry.second;
+            }
+        }
+        for (const auto& [where, entry] : by_site)
+        {
+            std::fprintf(stderr, "    %llu from %s:%u (%s)\n", (unsigned long long)entry.second,
+                         where.first.c_str(), where.second, entry.first.c_str());
+        }
+#endif
+    }
+};
+#else
+template<bool Shared>
+class AllocatorStats
+{
+public:
+    static constexpr bool s_Enabled = false;
+
+    uint64_t Live() const { return 0; }
+    void RaisePeak(uint64_t) {}
+    void CountAllocations(uint64_t) {}
+    void CountDeallocations(uint64_t) {}
+    void CountFailure() {}
+    void TrackSite(const void*, const AllocationSite&) {}
+    void ForgetSite(const void*) {}
+    void OnAllocate(const void*, const AllocationSite&) {}
+    void OnDeallocate(const void*) {}
+    AllocatorStatsSnapshot Snapshot() const { return {}; }
+    AllocatorStatsSnapshot Snapshot(uint64_t) const { return {}; }
+    void ReportLeaks(const char*) const {}
+};
+#endif
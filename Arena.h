@@ -0,0 +1,273 @@
+// Memory arena with alignment, chained blocks and savepoints
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include "Allocator_stats.h"
+#include "Backing_memory.h"
+#include "Bit_tricks.h"
+
+/*
+	Bump allocator over a chain of blocks.
+
+	- allocate(size, align) aligns the returned address, not just the offset
+	- when the current block is full the next one is used, or a new one
+	  twice as large is added to the chain
+	- mark() / rollback() free everything allocated after a point, like a
+	  stack ("free last" from Memory_arena.md)
+	- reset() rewinds to the first block but keeps every block, so an arena
+	  that is reset per request stops calling the system allocator once it
+	  has seen its peak size
+*/
+class Arena
+{
+    struct t_Block
+    {
+        t_Block* next;
+        size_t capacity;
+
+        char* data() { return reinterpret_cast<char*>(this + 1); }
+    };
+
+    BackingProvider* m_Backing;
+    t_Block* m_First;
+    t_Block* m_Current;
+    size_t m_Offset;         // Bump offset inside m_Current
+    size_t m_NextBlockSize;  // Capacity of the next block we have to create
+    [[no_unique_address]] AllocatorStats<false> m_Stats;
+
+    t_Block* NewBlock(size_t capacity)
+    {
+        if (capacity > std::numeric_limits<size_t>::max() - sizeof(t_Block))
+        {
+            throw std::bad_alloc();
+        }
+        size_t got = 0;
+        void* memory = m_Backing->AcquireBlock(sizeof(t_Block) + capacity, alignof(std::max_align_t), got);
+
+        t_Block* block = static_cast<t_Block*>(memory);
+        block->next = nullptr;
+        block->capacity = got - sizeof(t_Block);
+        return block;
+    }
+
+    void FreeBlock(t_Block* block)
+    {
+        m_Backing->ReleaseBlock(block, sizeof(t_Block) + block->capacity, alignof(std::max_align_t));
+    }
+
+    // Capacity of the block after 'capacity', doubling unless the provider wants fixed sizes
+    size_t NextBlockSize(size_t capacity) const
+    {
+        size_t preferred = m_Backing->PreferredBlockSize();
+        if (preferred > sizeof(t_Block))
+        {
+            return preferred - sizeof(t_Block);
+        }
+        return capacity > std::numeric_limits<size_t>::max() / 2 ? capacity : capacity * 2;
+    }
+
+    // Address of the first byte at or after 'offset' in 'block' that has the right alignment
+    static size_t AlignedOffset(t_Block* block, size_t offset, size_t align)
+    {
+        uintptr_t address = reinterpret_cast<uintptr_t>(block->data()) + offset;
+        return offset + (AlignUp(address, uintptr_t(align)) - address);
+    }
+
+    // Bytes consumed up to the bump pointer, alignment padding and skipped block tails included
+    size_t UsedBytes() const
+    {
+        size_t used = m_Offset;
+        for (const t_Block* block = m_First; block != m_Current; block = block->next)
+        {
+            used += block->capacity;
+        }
+        return used;
+    }
+
+    // Usage only grows between rollbacks, so sampling it before each move back is enough for the peak
+    void SamplePeak()
+    {
+        if constexpr (AllocatorStats<false>::s_Enabled)
+        {
+            m_Stats.RaisePeak(UsedBytes());
+        }
+    }
+
+    // Slow path: move to the next block that fits, creating it if needed
+    void* AllocateSlow(size_t size, size_t align)
+    {
+        // Past this no block could be sized for it: the doubling below would wrap
+        if (size > std::numeric_limits<size_t>::max() / 2 - align)
+        {
+            m_Stats.CountFailure();
+            throw std::bad_alloc();
+        }
+
+        SamplePeak();
+        for (t_Block* block = m_Current->next; block; block = block->next)
+        {
+            size_t offset = AlignedOffset(block, 0, align);
+            if (offset + size <= block->capacity)
+            {
+                m_Current = block;
+                m_Offset = offset + size;
+                return block->data() + offset;
+            }
+        }
+
+        // Nothing retained is big enough. Add a block right after the current one,
+        // blocks further down the chain stay around for later reuse.
+        size_t capacity = m_NextBlockSize;
+        while (capacity < size + align)
+        {
+            capacity *= 2;
+        }
+        m_NextBlockSize = NextBlockSize(capacity);
+
+        t_Block* block = nullptr;
+        try
+        {
+            block = NewBlock(capacity);
+        }
+        catch (const std::bad_alloc&)
+        {
+            m_Stats.CountFailure();
+            throw;
+        }
+        block->next = m_Current->next;
+        m_Current->next = block;
+
+        size_t offset = AlignedOffset(block, 0, align);
+        m_Current = block;
+        m_Offset = offset + size;
+        return block->data() + offset;
+    }
+
+public:
+    // Position in the arena, everything allocated after it can be rolled back
+    struct Marker
+    {
+        t_Block* block;
+        size_t offset;
+    };
+
+    // Rolls the arena back to where it was when the savepoint was created
+    class Savepoint
+    {
+        Arena& m_Arena;
+        Marker m_Marker;
+
+    public:
+        explicit Savepoint(Arena& arena) : m_Arena(arena), m_Marker(arena.mark()) {}
+        ~Savepoint() { m_Arena.rollback(m_Marker); }
+
+        Savepoint(const Savepoint&) = delete;
+        Savepoint& operator=(const Savepoint&) = delete;
+    };
+
+    // 'backing' defaults to operator new and must outlive the arena
+    explicit Arena(size_t size = 64 * 1024, BackingProvider* backing = nullptr)
+        : m_Backing(backing ? backing : &HeapBacking::Instance()),
+          m_First(NewBlock(size ? size : 1)),
+          m_Current(m_First),
+          m_Offset(0),
+          m_NextBlockSize(NextBlockSize(m_First->capacity))
+    {
+    }
+
+    ~Arena()
+    {
+        t_Block* block = m_First;
+        while (block)
+        {
+            t_Block* next = block->next;
+            FreeBlock(block);
+            block = next;
+        }
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // 'align' must be a power of two
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t))
+    {
+        m_Stats.CountAllocations(1);
+        size_t offset = AlignedOffset(m_Current, m_Offset, align);
+        if (offset > m_Current->capacity || size > m_Current->capacity - offset) // No 'offset + size': it can wrap
+        {
+            return AllocateSlow(size, align);
+        }
+
+        m_Offset = offset + size;
+        return m_Current->data() + offset;
+    }
+
+    // Typed helper: uninitialized storage for 'count' objects of type T
+    template<typename T>
+    T* allocate(size_t count = 1)
+    {
+        if (count > std::numeric_limits<size_t>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    Marker mark() const
+    {
+        return { m_Current, m_Offset };
+    }
+
+    // Free everything allocated after 'marker' (blocks are kept for reuse)
+    void rollback(Marker marker)
+    {
+        SamplePeak();
+        m_Stats.CountDeallocations(1);
+        m_Current = marker.block;
+        m_Offset = marker.offset;
+    }
+
+    // Free everything, keeping all blocks
+    void reset()
+    {
+        SamplePeak();
+        m_Stats.CountDeallocations(1);
+        m_Current = m_First;
+        m_Offset = 0;
+    }
+
+    // Total bytes owned by the arena, used or not
+    size_t capacity() const
+    {
+        size_t total = 0;
+        for (const t_Block* block = m_First; block; block = block->next)
+        {
+            total += block->capacity;
+        }
+        return total;
+    }
+
+    // All zero unless built with ALLOCATOR_STATS; 'live' and 'peak' are in bytes
+    AllocatorStatsSnapshot stats() const
+    {
+        AllocatorStatsSnapshot snapshot = m_Stats.Snapshot(UsedBytes());
+        if constexpr (AllocatorStats<false>::s_Enabled)
+        {
+            snapshot.peak = snapshot.live > snapshot.peak ? snapshot.live : snapshot.peak;
+        }
+        return snapshot;
+    }
+
+    size_t block_count() const
+    {
+        size_t count = 0;
+        for (const t_Block* block = m_First; block; block = block->next)
+        {
+            ++count;
+        }
+        return count;
+    }
+};
@@ -0,0 +1,228 @@
+// Small inline assembly kernels: cycle counters, prefetch hints, streaming stores, spin-wait pause
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+/*
+	The few places where a hand written instruction beats what the compiler
+	emits for plain C++, each with three implementations picked at compile
+	time: x86-64, AArch64 and a portable fallback.
+
+	Every asm block names its operands through constraints ("=r", "=m", ...)
+	instead of fixed registers, so the compiler allocates registers around
+	it and keeps optimizing the surrounding code; only the registers an
+	instruction really fixes (rdtsc writes edx:eax) are named.
+
+	ReadCycleCounter()        rdtsc / cntvct_el0 / steady_clock. On current
+	                          x86 the TSC ticks at a constant rate, not at
+	                          the core clock; cntvct_el0 ticks at CNTFRQ
+	ReadCycleCounterOrdered() rdtscp / isb + cntvct_el0: waits for earlier
+	                          instructions first, for the end of a timed region
+	Prefetch<Locality>(p)     prefetcht0/t1/t2/nta, prfm pld*
+	StreamFill(p, n, value)   movntdq / stnp: stores that bypass the cache,
+	                          for buffers larger than the last level cache
+	                          that won't be read back soon
+	SpinPause()               pause / yield, inside spin-wait loops
+*/
+
+#if defined(__x86_64__)
+#define ASM_KERNELS_X86 1
+#elif defined(__aarch64__)
+#define ASM_KERNELS_ARM64 1
+#endif
+
+inline uint64_t ReadCycleCounter()
+{
+#if defined(ASM_KERNELS_X86)
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return (uint64_t(high) << 32) | low;
+#elif defined(ASM_KERNELS_ARM64)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Not read before the instructions ahead of it have finished
+inline uint64_t ReadCycleCounterOrdered()
+{
+#if defined(ASM_KERNELS_X86)
+    uint32_t low, high, core;
+    asm volatile("rdtscp" : "=a"(low), "=d"(high), "=c"(core) : : "memory");
+    return (uint64_t(high) << 32) | low;
+#elif defined(ASM_KERNELS_ARM64)
+    uint64_t ticks;
+    asm volatile("isb\n\tmrs %0, cntvct_el0" : "=r"(ticks) : : "memory");
+    return ticks;
+#else
+    return ReadCycleCounter();
+#endif
+}
+
+// Counter ticks per nanosecond, measured once against steady_clock over ~20 ms
+inline double CycleCounterTicksPerNs()
+{
+    static const double s_TicksPerNs = []()
+    {
+        auto start_time = std::chrono::steady_clock::now();
+        uint64_t start = ReadCycleCounterOrdered();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t end = ReadCycleCounterOrdered();
+        double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_time).count());
+        return ns > 0 ? double(end - start) / ns : 1.0;
+    }();
+    return s_TicksPerNs;
+}
+
+enum class PrefetchLocality
+{
+    NonTemporal, // Used once: keep it out of the cache levels as far as possible
+    L3,
+    L2,
+    L1           // Needed very soon, in every level
+};
+
+// Start loading the cache line of 'p'; never faults, even on a bad address
+template<PrefetchLocality Locality = PrefetchLocality::L1>
+inline void Prefetch(const void* p)
+{
+#if defined(ASM_KERNELS_X86)
+    if constexpr (Locality == PrefetchLocality::L1) asm volatile("prefetcht0 (%0)" : : "r"(p));
+    else if constexpr (Locality == PrefetchLocality::L2) asm volatile("prefetcht1 (%0)" : : "r"(p));
+    else if constexpr (Locality == PrefetchLocality::L3) asm volatile("prefetcht2 (%0)" : : "r"(p));
+    else asm volatile("prefetchnta (%0)" : : "r"(p));
+#elif defined(ASM_KERNELS_ARM64)
+    if constexpr (Locality == PrefetchLocality::L1) asm volatile("prfm pldl1keep, [%0]" : : "r"(p));
+    else if constexpr (Locality == PrefetchLocality::L2) asm volatile("prfm pldl2keep, [%0]" : : "r"(p));
+    else if constexpr (Locality == PrefetchLocality::L3) asm volatile("prfm pldl3keep, [%0]" : : "r"(p));
+    else asm volatile("prfm pldl1strm, [%0]" : : "r"(p));
+#elif defined(__GNUC__)
+    __builtin_prefetch(p, 0, int(Locality));
+#else
+    (void)p;
+#endif
+}
+
+// Same for a line that is about to be written
+inline void PrefetchForWrite(const void* p)
+{
+#if defined(ASM_KERNELS_ARM64)
+    asm volatile("prfm pstl1keep, [%0]" : : "r"(p));
+#elif defined(__GNUC__)
+    __builtin_prefetch(p, 1, 3); // prefetchw where the CPU has it, prefetcht0 otherwise
+#else
+    (void)p;
+#endif
+}
+
+/*
+	Fills 'count' elements of 1, 2, 4 or 8 bytes at 'out' with 'value' using
+	non-temporal stores: the lines go to memory through write-combining
+	buffers instead of being read into the cache first (no read-for-
+	ownership) and evicting everything else. Worth it for fills well beyond
+	the last level cache; for small buffers a plain memset / std::fill is
+	faster, since the data would still be in the cache for the next reader.
+
+	The stores are weakly ordered: StreamFill ends with a store fence
+	(sfence / dmb ishst), so the data is visible like normal stores once it
+	returns. 'out' must be aligned to sizeof(T).
+*/
+template<typename T>
+inline void StreamFill(T* out, size_t count, T value)
+{
+    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8, "StreamFill: 1, 2, 4 or 8 byte elements");
+
+    // Scalar stores up to a 16 byte boundary
+    size_t i = 0;
+    for (; i < count && reinterpret_cast<uintptr_t>(out + i) % 16; ++i)
+		out[i] = value;
+
+#if defined(ASM_KERNELS_X86) || defined(ASM_KERNELS_ARM64)
+    alignas(16) T pattern[16 / sizeof(T)];
+    for (T& element : pattern)
+		element = value;
+
+    constexpr size_t s_PerStore = 16 / sizeof(T);
+#if defined(ASM_KERNELS_X86)
+    typedef long long t_Register __attribute__((vector_size(16)));
+    t_Register bytes;
+    std::memcpy(&bytes, pattern, sizeof(bytes));
+    for (; i + s_PerStore <= count; i += s_PerStore)
+		asm volatile("movntdq %1, %0" : "=m"(*reinterpret_cast<t_Register*>(out + i)) : "x"(bytes));
+    asm volatile("sfence" : : : "memory");
+#else
+    // stnp writes a pair of registers: 32 bytes per instruction
+    uint64_t low, high;
+    std::memcpy(&low, pattern, sizeof(low));
+    std::memcpy(&high, reinterpret_cast<const char*>(pattern) + 8, sizeof(high));
+    for (; i + 2 * s_PerStore <= count; i += 2 * s_PerStore)
+    {
+        asm volatile("stnp %1, %2, [%0]\n\tstnp %1, %2, [%0, #16]" : : "r"(out + i), "r"(low), "r"(high) : "memory");
+    }
+    asm volatile("dmb ishst" : : : "memory");
+#endif
+#endif
+
+    for (; i < count; ++i)
+		out[i] = value;
+}
+
+/*
+	One hint to the core that this is a spin-wait loop. On x86 'pause'
+	stops the loop from flooding the pipeline with speculative loads of
+	the contended line (and the memory order violation when it changes),
+	and leaves execution resources to the sibling hyper-thread. Intel
+	raised its latency from ~10 to ~140 cycles with Skylake, so callers
+	should count pauses, not cycles.
+*/
+inline void SpinPause()
+{
+#if defined(ASM_KERNELS_X86)
+    asm volatile("pause" : : : "memory");
+#elif defined(ASM_KERNELS_ARM64)
+    asm volatile("yield" : : : "memory");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+/*
+	Exponential backoff for CAS retry loops:
+
+		SpinBackoff backoff;
+		while (!head.compare_exchange_weak(expected, desired))
+			backoff.Pause();
+
+	Every failed attempt doubles the number of pauses, so threads that
+	collided spread out instead of retrying in lockstep. After s_MaxSpins
+	the thread yields to the scheduler, in case the owner isn't running.
+*/
+class SpinBackoff
+{
+    static constexpr unsigned s_MaxSpins = 64;
+    unsigned m_Spins = 1;
+
+public:
+    void Pause()
+    {
+        if (m_Spins > s_MaxSpins)
+        {
+            std::this_thread::yield();
+            return;
+        }
+        for (unsigned i = 0; i < m_Spins; ++i)
+			SpinPause();
+        m_Spins *= 2;
+    }
+
+    void Reset() { m_Spins = 1; }
+};
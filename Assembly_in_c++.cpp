@@ -1,24 +1,166 @@
 // Assembly program in c++
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include "Asm_kernels.h"
+#include "Auto_array.h"
+#include "Benchmark.h"
+#include "Fast_random.h"
 using namespace std;
 
+/*
+	The operands go through constraints: "=r" lets the compiler pick the
+	output register and "0" puts 'a' in that same register, so the block is
+	a single add with no moves and no clobbered register. Still, the
+	compiler can't see through it (no constant folding, no vectorizing), so
+	it's slower than a plain '+' in a loop; see Asm_kernels.h for the
+	instructions that are worth writing by hand.
+*/
 int sum(int a, int b)
 {
     int result;
-    __asm__(
-        "movl %1, %%eax;" // Move a into eax
-        "addl %2, %%eax;" // Add b to eax
-        "movl %%eax, %0;" // Move result from eax to result
-        : "=r"(result)    // Output
-        : "r"(a), "r"(b)  // Get user input
-        : "%eax"          // Clobbered register
-    );
-
+#if defined(__x86_64__) || defined(__i386__)
+    asm("addl %2, %0" : "=r"(result) : "0"(a), "r"(b) : "cc");
+#elif defined(__aarch64__)
+    asm("add %w0, %w1, %w2" : "=r"(result) : "r"(a), "r"(b));
+#else
+    result = a + b;
+#endif
     return result;
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    cout << sum(4, 6);
+    cout << sum(4, 6) << "\n";
+    cout << "Cycle counter ticks per ns: " << CycleCounterTicksPerNs() << "\n\n";
+
+    // The asm block is opaque to the optimizer, a plain '+' can be folded and vectorized
+    constexpr int COUNT = 10'000'000;
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+    bench.Run("inline asm add", [&]()
+    {
+        int total = 0;
+        for (int i = 0; i < COUNT; i++)
+            total = sum(total, i);
+        DoNotOptimize(total);
+    }, COUNT);
+
+    bench.Run("plain add", [&]()
+    {
+        unsigned total = 0; // Wraps like the asm add, a signed int would overflow
+        for (int i = 0; i < COUNT; i++)
+        {
+            int value = i;
+            DoNotOptimize(value); // Keep the loop from turning into a formula
+            total += unsigned(value);
+        }
+        DoNotOptimize(total);
+    }, COUNT);
+
+    // Timer cost: rdtsc is an instruction, steady_clock::now() a vDSO call doing rdtsc plus scaling
+    constexpr int TIMER_COUNT = 1'000'000;
+    bench.Run("ReadCycleCounter()", [&]()
+    {
+        uint64_t total = 0;
+        for (int i = 0; i < TIMER_COUNT; i++)
+            total += ReadCycleCounter();
+        DoNotOptimize(total);
+    }, TIMER_COUNT);
+
+    bench.Run("ReadCycleCounterOrdered()", [&]()
+    {
+        uint64_t total = 0;
+        for (int i = 0; i < TIMER_COUNT; i++)
+            total += ReadCycleCounterOrdered();
+        DoNotOptimize(total);
+    }, TIMER_COUNT);
+
+    bench.Run("steady_clock::now()", [&]()
+    {
+        int64_t total = 0;
+        for (int i = 0; i < TIMER_COUNT; i++)
+            total += chrono::steady_clock::now().time_since_epoch().count();
+        DoNotOptimize(total);
+    }, TIMER_COUNT);
+
+    /*
+		Random gather from 128 MB, hashing each element: every load misses the
+		cache, and the hash keeps the out-of-order window from reaching more
+		than a few loads ahead. The indices are known ahead of time, so
+		prefetching the element 16 iterations ahead overlaps the misses.
+	*/
+    constexpr size_t TABLE_SIZE = 16 * 1024 * 1024;
+    constexpr size_t GATHER_COUNT = 4'000'000;
+    constexpr size_t DISTANCE = 16;
+    AutoArray<uint64_t> table(TABLE_SIZE);
+    iota(table.begin(), table.end(), uint64_t(0));
+    AutoArray<uint32_t> indices(GATHER_COUNT + DISTANCE);
+    Xoshiro256StarStar engine(42);
+    for (uint32_t& index : indices)
+        index = uint32_t(RandomBelow(engine, TABLE_SIZE));
+
+    auto hash = [](uint64_t x)
+    {
+        for (int k = 0; k < 8; k++)
+            x = x * 0x9E3779B97F4A7C15 + k;
+        return x;
+    };
+
+    bench.Run("random gather + hash", [&]()
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < GATHER_COUNT; i++)
+            total += hash(table[indices[i]]);
+        DoNotOptimize(total);
+    }, GATHER_COUNT);
+
+    bench.Run("random gather + hash, Prefetch(16 ahead)", [&]()
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < GATHER_COUNT; i++)
+        {
+            Prefetch(&table[indices[i + DISTANCE]]);
+            total += hash(table[indices[i]]);
+        }
+        DoNotOptimize(total);
+    }, GATHER_COUNT);
+
+    // Filling 256 MB, far more than the last level cache: streaming stores skip the read-for-ownership
+    constexpr size_t FILL_COUNT = 32 * 1024 * 1024;
+    AlignedArray<uint64_t> buffer(FILL_COUNT);
+    bench.Run("std::fill 256 MB", [&]()
+    {
+        fill(buffer.begin(), buffer.end(), 0x0101010101010101);
+        ClobberMemory();
+    }, FILL_COUNT * sizeof(uint64_t));
+
+    bench.Run("memset 256 MB", [&]()
+    {
+        memset(buffer.data(), 1, FILL_COUNT * sizeof(uint64_t));
+        ClobberMemory();
+    }, FILL_COUNT * sizeof(uint64_t));
+
+    bench.Run("StreamFill 256 MB", [&]()
+    {
+        StreamFill(buffer.data(), FILL_COUNT, uint64_t(0x0101010101010101));
+        ClobberMemory();
+    }, FILL_COUNT * sizeof(uint64_t));
+
+    bool filled = all_of(buffer.begin(), buffer.end(), [](uint64_t x) { return x == 0x0101010101010101; });
+    cout << "StreamFill wrote every element: " << (filled ? "yes" : "NO") << "\n";
+
+    // What one pause costs: ~10 cycles before Skylake, ~140 on Skylake to Ice Lake, ~40 since
+    constexpr int PAUSE_COUNT = 100'000;
+    uint64_t start = ReadCycleCounter();
+    for (int i = 0; i < PAUSE_COUNT; i++)
+        SpinPause();
+    uint64_t ticks = ReadCycleCounterOrdered() - start;
+    cout << "SpinPause(): " << double(ticks) / PAUSE_COUNT << " ticks, "
+         << double(ticks) / PAUSE_COUNT / CycleCounterTicksPerNs() << " ns\n\n";
+
+    bench.Report();
     return 0;
 }
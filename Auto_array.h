@@ -0,0 +1,417 @@
+// Growable array that owns its memory: move-only, uninitialized storage, small-buffer optimization
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+	AutoArray<T, InlineCapacity, Allocator>
+
+	- memory is freed automatically when the array goes out of scope
+	- copying is not allowed (no double deletion of the same memory),
+	  moving is, so an AutoArray can be returned from functions
+	- reserve() only allocates, elements are constructed by emplace_back()
+	  / push_back() / resize(), never default-constructed in bulk
+	- growth relocates trivially copyable types with one memcpy
+	- the first InlineCapacity elements live inside the object itself,
+	  small arrays never touch the allocator
+	- Allocator is any standard allocator, e.g. ArenaAllocator<T> or
+	  PoolAllocator<T> from Allocator_adapters.h, or AlignedAllocator<T, N>
+	  below for buffers that start on a SIMD register / cache line boundary
+*/
+
+// Heap memory aligned to 'Alignment' bytes (32 for AVX2 loads, 64 for AVX-512 and cache lines)
+template<typename T, size_t Alignment = 64>
+class AlignedAllocator
+{
+    static_assert((Alignment & (Alignment - 1)) == 0 && Alignment >= alignof(T), "AlignedAllocator: bad alignment");
+
+public:
+    using value_type = T;
+    static constexpr size_t alignment = Alignment;
+
+    template<typename U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(size_t n)
+    {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+        {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* p, size_t) noexcept
+    {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+};
+
+// Alignment an allocator promises for its arrays; inline storage gets the same
+template<typename Allocator, typename T>
+constexpr size_t AllocatorAlignment()
+{
+    if constexpr (requires { Allocator::alignment; })
+    {
+        return Allocator::alignment > alignof(T) ? Allocator::alignment : alignof(T);
+    }
+    else
+    {
+        return alignof(T);
+    }
+}
+template<typename T, size_t InlineCapacity = 0, typename Allocator = std::allocator<T>>
+class AutoArray
+{
+    using t_Traits = std::allocator_traits<Allocator>;
+
+    struct t_NoInline
+    {
+    };
+
+    struct t_Inline
+    {
+        alignas(AllocatorAlignment<Allocator, T>()) unsigned char bytes[sizeof(T) * (InlineCapacity ? InlineCapacity : 1)];
+    };
+
+    static constexpr bool s_Relocatable = std::is_trivially_copyable_v<T>;
+
+    [[no_unique_address]] Allocator m_Allocator;
+    [[no_unique_address]] std::conditional_t<InlineCapacity != 0, t_Inline, t_NoInline> m_Inline;
+    T* m_Data;
+    size_t m_Size = 0;
+    size_t m_Capacity = InlineCapacity;
+
+    T* InlineData()
+    {
+        if constexpr (InlineCapacity != 0)
+        {
+            return reinterpret_cast<T*>(m_Inline.bytes);
+        }
+        else
+        {
+            return nullptr;
+        }
+    }
+
+    bool IsInline() const
+    {
+        return InlineCapacity && m_Data == const_cast<AutoArray*>(this)->InlineData();
+    }
+
+    /*
+		Move 'count' elements from 'from' to uninitialized 'to' and end the lifetime
+		of the originals. Without a nothrow move the elements are copied, and if a
+		copy throws the ones already built in 'to' are destroyed and 'from' is left
+		as it was, so the caller only has to free 'to' (the std::vector guarantee)
+	*/
+    static void Relocate(T* from, size_t count, T* to)
+    {
+        if constexpr (s_Relocatable)
+        {
+            if (count)
+            {
+                std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(T));
+            }
+        }
+        else
+        {
+            size_t built = 0;
+            try
+            {
+                for (; built < count; ++built)
+                {
+                    ::new (static_cast<void*>(to + built)) T(std::move_if_noexcept(from[built]));
+                }
+            }
+            catch (...)
+            {
+                Destroy(to, built);
+                throw;
+            }
+            Destroy(from, count);
+        }
+    }
+
+    static void Destroy(T* data, size_t count) noexcept
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                data[i].~T();
+            }
+        }
+    }
+
+    void DestroyAll()
+    {
+        Destroy(m_Data, m_Size);
+        m_Size = 0;
+    }
+
+    void ReleaseStorage()
+    {
+        if (!IsInline() && m_Data)
+        {
+            t_Traits::deallocate(m_Allocator, m_Data, m_Capacity);
+        }
+        m_Data = InlineData();
+        m_Capacity = InlineCapacity;
+    }
+
+    size_t GrownCapacity(size_t needed) const
+    {
+        size_t grown = m_Capacity ? m_Capacity * 2 : 4;
+        return grown > needed ? grown : needed;
+    }
+
+    // Switch to a heap buffer of 'capacity' elements
+    void Reallocate(size_t capacity)
+    {
+        T* data = t_Traits::allocate(m_Allocator, capacity);
+        try
+        {
+            Relocate(m_Data, m_Size, data);
+        }
+        catch (...)
+        {
+            t_Traits::deallocate(m_Allocator, data, capacity);
+            throw;
+        }
+        ReleaseStorage();
+        m_Data = data;
+        m_Capacity = capacity;
+    }
+
+    // Slow path of emplace_back(): the new element is built before the old ones move,
+    // so arguments that refer into the array stay valid
+    template<typename... Args>
+    T& EmplaceGrow(Args&&... args)
+    {
+        size_t capacity = GrownCapacity(m_Size + 1);
+        T* data = t_Traits::allocate(m_Allocator, capacity);
+        try
+        {
+            ::new (static_cast<void*>(data + m_Size)) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            t_Traits::deallocate(m_Allocator, data, capacity);
+            throw;
+        }
+
+        try
+        {
+            Relocate(m_Data, m_Size, data);
+        }
+        catch (...)
+        {
+            data[m_Size].~T();
+            t_Traits::deallocate(m_Allocator, data, capacity);
+            throw;
+        }
+        ReleaseStorage();
+        m_Data = data;
+        m_Capacity = capacity;
+        return m_Data[m_Size++];
+    }
+
+    // Take other's elements; afterwards 'other' is empty
+    void StealFrom(AutoArray& other)
+    {
+        if (other.IsInline())
+        {
+            // Inline elements can't change hands, they move one by one
+            Relocate(other.m_Data, other.m_Size, m_Data);
+            m_Size = other.m_Size;
+        }
+        else
+        {
+            m_Data = other.m_Data;
+            m_Size = other.m_Size;
+            m_Capacity = other.m_Capacity;
+            other.m_Data = other.InlineData();
+            other.m_Capacity = InlineCapacity;
+        }
+        other.m_Size = 0;
+    }
+
+public:
+    AutoArray() noexcept(std::is_nothrow_default_constructible_v<Allocator>) : m_Data(InlineData()) {}
+
+    explicit AutoArray(const Allocator& allocator) noexcept : m_Allocator(allocator), m_Data(InlineData()) {}
+
+    // 'count' value-initialized elements (zeros for numbers)
+    explicit AutoArray(size_t count, const Allocator& allocator = Allocator())
+        : m_Allocator(allocator), m_Data(InlineData())
+    {
+        resize(count);
+    }
+
+    ~AutoArray()
+    {
+        DestroyAll();
+        ReleaseStorage();
+    }
+
+    // Prevent Copying to avoid issues with double deletion of the same memory
+    AutoArray(const AutoArray&) = delete;
+    AutoArray& operator=(const AutoArray&) = delete;
+
+    AutoArray(AutoArray&& other) noexcept(s_Relocatable || std::is_nothrow_move_constructible_v<T>)
+        : m_Allocator(std::move(other.m_Allocator)), m_Data(InlineData())
+    {
+        StealFrom(other);
+    }
+
+    AutoArray& operator=(AutoArray&& other)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+
+        DestroyAll();
+        if constexpr (t_Traits::propagate_on_container_move_assignment::value)
+        {
+            ReleaseStorage();
+            m_Allocator = std::move(other.m_Allocator);
+            StealFrom(other);
+        }
+        else
+        {
+            if (m_Allocator == other.m_Allocator)
+            {
+                ReleaseStorage();
+                StealFrom(other);
+            }
+            else
+            {
+                // Other memory source: keep ours and move the elements over
+                reserve(other.m_Size);
+                Relocate(other.m_Data, other.m_Size, m_Data);
+                m_Size = other.m_Size;
+                other.m_Size = 0;
+            }
+        }
+        return *this;
+    }
+
+    // Simple array access
+    T& operator[](size_t index) { return m_Data[index]; }
+    const T& operator[](size_t index) const { return m_Data[index]; }
+
+    T* data() { return m_Data; }
+    const T* data() const { return m_Data; }
+    T* begin() { return m_Data; }
+    T* end() { return m_Data + m_Size; }
+    const T* begin() const { return m_Data; }
+    const T* end() const { return m_Data + m_Size; }
+
+    size_t size() const { return m_Size; }
+    size_t capacity() const { return m_Capacity; }
+    bool empty() const { return m_Size == 0; }
+    size_t getSize() const { return m_Size; }
+    Allocator get_allocator() const { return m_Allocator; }
+
+    // Make room for 'capacity' elements without constructing any
+    void reserve(size_t capacity)
+    {
+        if (capacity > m_Capacity)
+        {
+            Reallocate(capacity);
+        }
+    }
+
+    // Grow with value-initialized elements or shrink by destroying the tail
+    void resize(size_t count)
+    {
+        if (count < m_Size)
+        {
+            if constexpr (!std::is_trivially_destructible_v<T>)
+            {
+                for (size_t i = count; i < m_Size; ++i)
+                {
+                    m_Data[i].~T();
+                }
+            }
+            m_Size = count;
+            return;
+        }
+
+        reserve(count);
+        if constexpr (std::is_trivially_default_constructible_v<T> && std::is_trivially_copyable_v<T>)
+        {
+            if (count > m_Size)
+            {
+                std::memset(static_cast<void*>(m_Data + m_Size), 0, (count - m_Size) * sizeof(T));
+            }
+            m_Size = count;
+        }
+        else
+        {
+            for (; m_Size < count; ++m_Size)
+            {
+                ::new (static_cast<void*>(m_Data + m_Size)) T();
+            }
+        }
+    }
+
+    template<typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        if (m_Size == m_Capacity)
+        {
+            return EmplaceGrow(std::forward<Args>(args)...);
+        }
+        ::new (static_cast<void*>(m_Data + m_Size)) T(std::forward<Args>(args)...);
+        return m_Data[m_Size++];
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+
+    void pop_back()
+    {
+        --m_Size;
+        m_Data[m_Size].~T();
+    }
+
+    // Destroys the elements, keeps the memory
+    void clear() { DestroyAll(); }
+
+    // Printing is opt-in: nothing in the array writes to cout on its own
+    void traverse(std::ostream& out = std::cout) const
+    {
+        out << "Elements of the array: [";
+        for (size_t i = 0; i < m_Size; ++i)
+        {
+            out << m_Data[i];
+            if (i < m_Size - 1)
+                out << ", ";
+        }
+        out << "]" << std::endl;
+    }
+};
+
+// AutoArray whose buffer starts on an 'Alignment' byte boundary, for SIMD loops (Simd_array_ops.h)
+template<typename T, size_t Alignment = 64>
+using AlignedArray = AutoArray<T, 0, AlignedAllocator<T, Alignment>>;
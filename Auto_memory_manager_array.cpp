@@ -1,56 +1,25 @@
 // Auto array memory manager
 // ( note: Memory freed automatically when 'numbers' goes out of scope )
 #include <iostream>
+#include <string>
+#include <vector>
+#include "Allocator_adapters.h"
+#include "Arena.h"
+#include "Auto_array.h"
+#include "Benchmark.h"
 using namespace std;
 
-template <typename T>
-class AutoArray
+// Built once per call and returned by value: moves the buffer, copies nothing
+AutoArray<string> MakeNames(size_t count)
 {
-private:
-    T *ptr = nullptr;
-    size_t size = 0;
-
-public:
-    // Allocates memory
-    AutoArray(size_t array_size) : size(array_size)
-    {
-        ptr = new T[size];
-        cout << "Allocated " << size << " elements\n";
-    }
-
-    // Frees memory
-    ~AutoArray()
-    {
-        delete[] ptr;
-        cout << "Freed memory\n";
-    }
-
-    // Prevent Copying to avoid issues with double deletion of the same memory
-    AutoArray(const AutoArray &) = delete;
-    AutoArray &operator=(const AutoArray &) = delete;
-
-    // Simple array access
-    T &operator[](size_t index)
-    {
-        return ptr[index];
-    }
-
-    void traverse() const
-    {
-        cout << "Elements of the array: [";
-        for (size_t i = 0; i < size; ++i)
-        {
-            cout << ptr[i];
-            if (i < size - 1)
-                cout << ", ";
-        }
-        cout << "]" << endl;
-    }
-
-    size_t getSize() const { return size; }
-};
+    AutoArray<string> names;
+    names.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        names.emplace_back("name " + to_string(i));
+    return names;
+}
 
-int main()
+int main(int argc, char** argv)
 {
     AutoArray<int> numbers(3);
 
@@ -68,5 +37,108 @@ int main()
     // AutoArray<int> numbers = arr1;	// ERROR: Copying not allowed!
     // arr2 = arr1;                   	// ERROR: Assignment not allowed!
 
+    // Moving is allowed: ownership of the memory changes hands
+    AutoArray<int> moved = std::move(numbers);
+    moved.push_back(40);
+    moved.traverse();
+
+    AutoArray<string> names = MakeNames(3);
+    names.traverse();
+
+    // Element access costs the same as a raw array or a vector
+    constexpr size_t COUNT = 1'000'000;
+    AutoArray<int> big(COUNT);
+    vector<int> reference(COUNT);
+
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+    bench.Run("AutoArray fill + sum", [&]()
+    {
+        long long sum = 0;
+        for (size_t i = 0; i < COUNT; ++i)
+            big[i] = int(i);
+        for (size_t i = 0; i < COUNT; ++i)
+            sum += big[i];
+        DoNotOptimize(sum);
+    }, COUNT);
+
+    bench.Run("vector fill + sum", [&]()
+    {
+        long long sum = 0;
+        for (size_t i = 0; i < COUNT; ++i)
+            reference[i] = int(i);
+        for (size_t i = 0; i < COUNT; ++i)
+            sum += reference[i];
+        DoNotOptimize(sum);
+    }, COUNT);
+
+    // Growing one element at a time: AutoArray relocates ints with memcpy
+    bench.Run("AutoArray push_back", [&]()
+    {
+        AutoArray<int> values;
+        for (size_t i = 0; i < COUNT; ++i)
+            values.push_back(int(i));
+        DoNotOptimize(values.data());
+    }, COUNT);
+
+    bench.Run("vector push_back", [&]()
+    {
+        vector<int> values;
+        for (size_t i = 0; i < COUNT; ++i)
+            values.push_back(int(i));
+        DoNotOptimize(values.data());
+    }, COUNT);
+
+    // reserve() allocates only, nothing is constructed until emplace_back
+    bench.Run("AutoArray reserve + emplace_back", [&]()
+    {
+        AutoArray<int> values;
+        values.reserve(COUNT);
+        for (size_t i = 0; i < COUNT; ++i)
+            values.emplace_back(int(i));
+        DoNotOptimize(values.data());
+    }, COUNT);
+
+    // Many short arrays: with inline storage the small ones never allocate
+    constexpr size_t SMALL_ARRAYS = 100'000;
+    constexpr size_t SMALL_SIZE = 8;
+    bench.Run("vector, 8 elements", [&]()
+    {
+        for (size_t n = 0; n < SMALL_ARRAYS; ++n)
+        {
+            vector<int> values;
+            for (size_t i = 0; i < SMALL_SIZE; ++i)
+                values.push_back(int(i + n));
+            DoNotOptimize(values.data());
+        }
+    }, SMALL_ARRAYS);
+
+    bench.Run("AutoArray<int, 8>, 8 elements", [&]()
+    {
+        for (size_t n = 0; n < SMALL_ARRAYS; ++n)
+        {
+            AutoArray<int, SMALL_SIZE> values;
+            for (size_t i = 0; i < SMALL_SIZE; ++i)
+                values.push_back(int(i + n));
+            DoNotOptimize(values.data());
+        }
+    }, SMALL_ARRAYS);
+
+    // Or take the memory from an arena and drop it all at once
+    Arena arena(64 * 1024);
+    bench.Run("AutoArray on Arena, 8 elements", [&]()
+    {
+        for (size_t n = 0; n < SMALL_ARRAYS; ++n)
+        {
+            Arena::Savepoint scratch(arena);
+            AutoArray<int, 0, ArenaAllocator<int>> values{ ArenaAllocator<int>(arena) };
+            values.reserve(SMALL_SIZE);
+            for (size_t i = 0; i < SMALL_SIZE; ++i)
+                values.push_back(int(i + n));
+            DoNotOptimize(values.data());
+        }
+    }, SMALL_ARRAYS);
+
+    bench.Report();
+
     return 0;
 }
@@ -0,0 +1,105 @@
+// MemoryPool and Arena on different backing memory: heap, mmap, huge pages, pre-faulted, NUMA bound
+#include <iostream>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Arena.h"
+#include "Backing_memory.h"
+#include "Benchmark.h"
+#include "Memory_pool.h"
+
+using Block = std::array<uint64_t, 8>; // 64 bytes, one cache line
+
+// First touch of every block (page faults) and a random walk over all blocks (TLB misses)
+class BackingTester
+{
+    Benchmark& m_Bench;
+    size_t m_BlockCount;
+
+public:
+    BackingTester(Benchmark& bench, const size_t block_count) : m_Bench(bench), m_BlockCount(block_count) {}
+
+    void Test(const std::string& name, BackingProvider* backing)
+    {
+        std::unique_ptr<MemoryPool<Block>> pool;
+        std::vector<Block*> blocks;
+        blocks.reserve(m_BlockCount);
+
+        // Every run starts from a fresh pool, so all of its pages are new
+        m_Bench.RunWithSetup(name + " first touch", [&]()
+        {
+            blocks.clear();
+            pool.reset();
+        },
+        [&]()
+        {
+            pool = std::make_unique<MemoryPool<Block>>(m_BlockCount, PoolGrowth::None, 0, backing);
+            for (size_t i = 0; i < m_BlockCount; i++)
+			{
+				blocks.push_back(pool->Allocate());
+				(*blocks.back())[0] = i;
+			}
+        }, m_BlockCount);
+
+        uint64_t sum = 0;
+        m_Bench.Run(name + " random walk", [&]()
+        {
+            uint64_t index = 1;
+            for (size_t i = 0; i < m_BlockCount; i++)
+			{
+				index = index * 6364136223846793005ull + 1442695040888963407ull; // LCG, unpredictable order
+				Block* block = blocks[(index >> 17) % m_BlockCount];
+				(*block)[0] += i;
+				sum += (*block)[0];
+			}
+            DoNotOptimize(sum);
+        }, m_BlockCount);
+    }
+};
+
+int main(int argc, char** argv)
+{
+    constexpr size_t BLOCK_COUNT = 4'000'000; // 256 MB of 64 byte blocks
+
+    // Every run maps and faults in 256 MB, so fewer repetitions than usual
+    BenchmarkOptions defaults;
+    defaults.repetitions = 3;
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv, defaults));
+    BackingTester tester(bench, BLOCK_COUNT);
+
+    MmapBacking plain_mmap;
+    MmapBacking prefaulted({ MmapBacking::HugePages::None, true, -1 });
+    MmapBacking transparent({ MmapBacking::HugePages::Transparent, false, -1 });
+    MmapBacking transparent_prefaulted({ MmapBacking::HugePages::Transparent, true, -1 });
+    MmapBacking explicit_huge({ MmapBacking::HugePages::Explicit, true, -1 });
+
+    // Each worker would create its pools with the node it is running on
+    int node = MmapBacking::CurrentNode();
+    MmapBacking local_node({ MmapBacking::HugePages::Transparent, true, node < 0 ? 0 : node });
+
+    tester.Test("operator new", nullptr);
+    tester.Test("mmap", &plain_mmap);
+    tester.Test("mmap + prefault", &prefaulted);
+    tester.Test("transparent huge pages", &transparent);
+    tester.Test("THP + prefault", &transparent_prefaulted);
+    tester.Test("MAP_HUGETLB + prefault", &explicit_huge);
+    tester.Test("THP + local NUMA node", &local_node);
+
+    // Arenas take the same providers for their blocks
+    Arena arena(64 * 1024 * 1024, &transparent_prefaulted);
+    bench.Run("arena on THP", [&]()
+    {
+        arena.reset();
+        for (int i = 0; i < 1'000'000; i++)
+		{
+			DoNotOptimize(arena.allocate<Block>());
+		}
+    }, 1'000'000);
+
+    bench.Report();
+    std::cout << "\nArena on THP: " << arena.block_count() << " blocks for 1M allocations\n";
+
+    return 0;
+}
@@ -0,0 +1,238 @@
+// Where pools and arenas get their big blocks of memory from
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+/*
+	Source of slabs (MemoryPool) and blocks (Arena). Only called when a pool
+	or an arena grows, shrinks or dies, never per allocation, so a virtual
+	call is fine here.
+*/
+class BackingProvider
+{
+public:
+    virtual ~BackingProvider() = default;
+
+    // Return at least 'min_bytes' aligned to 'align', store the real size in 'got_bytes'
+    virtual void* AcquireBlock(size_t min_bytes, size_t align, size_t& got_bytes) = 0;
+    virtual void ReleaseBlock(void* block, size_t bytes, size_t align) = 0;
+
+    // Block size this provider is built around (e.g. a page pool), 0 if any size is fine
+    virtual size_t PreferredBlockSize() const { return 0; }
+};
+
+// operator new / delete, what the pools and arenas used to call directly
+class HeapBacking : public BackingProvider
+{
+public:
+    void* AcquireBlock(size_t min_bytes, size_t align, size_t& got_bytes) override
+    {
+        got_bytes = min_bytes;
+        return ::operator new(min_bytes, std::align_val_t(align));
+    }
+
+    void ReleaseBlock(void* block, size_t, size_t align) override
+    {
+        ::operator delete(block, std::align_val_t(align));
+    }
+
+    static HeapBacking& Instance()
+    {
+        static HeapBacking s_Instance;
+        return s_Instance;
+    }
+};
+
+/*
+	Anonymous mmap with control over page size, pre-faulting and NUMA placement.
+
+	HugePages::Transparent  madvise(MADV_HUGEPAGE), works without any setup
+	HugePages::Explicit     MAP_HUGETLB, needs pages reserved in
+	                        /proc/sys/vm/nr_hugepages; falls back to
+	                        transparent huge pages when none are left
+	prefault                fault every page in up front (MAP_POPULATE), so
+	                        the first touch in the hot loop doesn't page fault
+	numa_node               bind the memory to one node (mbind), -1 = leave
+	                        it to the kernel's first-touch policy
+
+	On systems without mmap it behaves like HeapBacking.
+*/
+class MmapBacking : public BackingProvider
+{
+public:
+    enum class HugePages
+    {
+        None,
+        Transparent,
+        Explicit
+    };
+
+    struct Options
+    {
+        HugePages hugePages = HugePages::None;
+        bool prefault = false;
+        int numaNode = -1;
+    };
+
+    static constexpr size_t s_HugePageSize = 2 * 1024 * 1024;
+
+private:
+    Options m_Options;
+
+    static size_t RoundUp(size_t bytes, size_t granularity)
+    {
+        return (bytes + granularity - 1) / granularity * granularity;
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    static size_t PageSize()
+    {
+        static const size_t s_PageSize = size_t(sysconf(_SC_PAGESIZE));
+        return s_PageSize;
+    }
+
+    void* MapAnonymous(size_t bytes, int extra_flags) const
+    {
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    // Touch one byte per page, for when MAP_POPULATE would fault pages before mbind()
+    static void Prefault(void* p, size_t bytes)
+    {
+#if defined(MADV_POPULATE_WRITE)
+        if (madvise(p, bytes, MADV_POPULATE_WRITE) == 0)
+        {
+            return;
+        }
+#endif
+        volatile char* bytes_ptr = static_cast<volatile char*>(p);
+        for (size_t offset = 0; offset < bytes; offset += PageSize())
+        {
+            bytes_ptr[offset] = 0;
+        }
+    }
+
+    bool BindToNode(void* p, size_t bytes) const
+    {
+#if defined(__linux__) && defined(SYS_mbind)
+        constexpr size_t s_MaskWords = 16; // Up to 1024 nodes
+        unsigned long mask[s_MaskWords] = {};
+        size_t node = size_t(m_Options.numaNode);
+        if (node >= s_MaskWords * 8 * sizeof(unsigned long))
+        {
+            return false;
+        }
+        mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+
+        // The kernel drops the last bit of 'maxnode', hence the + 1
+        return syscall(SYS_mbind, p, bytes, MPOL_BIND, mask, s_MaskWords * 8 * sizeof(unsigned long) + 1, 0) == 0;
+#else
+        (void)p;
+        (void)bytes;
+        return false;
+#endif
+    }
+#endif
+
+public:
+    MmapBacking() = default;
+    explicit MmapBacking(const Options& options) : m_Options(options) {}
+
+    const Options& options() const { return m_Options; }
+
+    // NUMA node of the CPU the calling thread runs on, -1 if unknown
+    static int CurrentNode()
+    {
+#if defined(__linux__) && defined(SYS_getcpu)
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        {
+            return int(node);
+        }
+#endif
+        return -1;
+    }
+
+    void* AcquireBlock(size_t min_bytes, size_t align, size_t& got_bytes) override
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        // mmap hands out page aligned memory, no pool needs more than that
+        if (align <= PageSize())
+        {
+            bool bind = m_Options.numaNode >= 0;
+            bool wants_thp = m_Options.hugePages != HugePages::None;
+            void* p = nullptr;
+
+#if defined(MAP_HUGETLB)
+            if (m_Options.hugePages == HugePages::Explicit)
+            {
+                got_bytes = RoundUp(min_bytes, s_HugePageSize);
+                p = MapAnonymous(got_bytes, MAP_HUGETLB | (m_Options.prefault && !bind ? MAP_POPULATE : 0));
+                wants_thp = false;
+                if (!p)
+                {
+                    wants_thp = true; // No reserved huge pages left
+                }
+            }
+#endif
+            if (!p)
+            {
+                got_bytes = RoundUp(min_bytes, wants_thp ? s_HugePageSize : PageSize());
+#if defined(MAP_POPULATE)
+                // Populating here is only safe when nothing has to happen before the first fault
+                int flags = m_Options.prefault && !bind && !wants_thp ? MAP_POPULATE : 0;
+#else
+                int flags = 0;
+#endif
+                p = MapAnonymous(got_bytes, flags);
+                if (!p)
+                {
+                    throw std::bad_alloc();
+                }
+#if defined(MADV_HUGEPAGE)
+                if (wants_thp)
+                {
+                    madvise(p, got_bytes, MADV_HUGEPAGE);
+                }
+#endif
+            }
+
+            if (bind)
+            {
+                BindToNode(p, got_bytes);
+            }
+            if (m_Options.prefault && (bind || wants_thp))
+            {
+                Prefault(p, got_bytes);
+            }
+            return p;
+        }
+#endif
+        return HeapBacking::Instance().AcquireBlock(min_bytes, align, got_bytes);
+    }
+
+    void ReleaseBlock(void* block, size_t bytes, size_t align) override
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        if (align <= PageSize())
+        {
+            munmap(block, bytes);
+            return;
+        }
+#endif
+        HeapBacking::Instance().ReleaseBlock(block, bytes, align);
+    }
+};
@@ -0,0 +1,853 @@
+// Benchmark harness shared by the example programs
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Asm_kernels.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+	Optimization barriers.
+
+	DoNotOptimize(x)  forces 'x' to be computed and kept, so the compiler
+	                  can't drop the work that produced it
+	ClobberMemory()   tells the compiler all memory may have been read or
+	                  written, so stores before it can't be elided
+*/
+template<typename T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* s_Sink;
+    s_Sink = &value;
+#endif
+}
+
+template<typename T>
+inline void DoNotOptimize(T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : "+r,m"(value) : : "memory");
+#else
+    static volatile void* s_Sink;
+    s_Sink = &value;
+#endif
+}
+
+inline void ClobberMemory()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#endif
+}
+
+/*
+	Hardware counters through perf_event_open (Linux only): cycles, cache
+	misses and branch misses for the calling thread. Containers and locked
+	down kernels often refuse them, check Available().
+*/
+class PerfCounters
+{
+public:
+    struct Values
+    {
+        uint64_t cycles = 0;
+        uint64_t cacheMisses = 0;
+        uint64_t branchMisses = 0;
+    };
+
+private:
+    static constexpr int s_CounterCount = 3;
+    int m_Fds[s_CounterCount] = { -1, -1, -1 };
+
+#if defined(__linux__)
+    static int Open(uint64_t config, int group_fd)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = group_fd == -1 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        return int(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+    }
+#endif
+
+public:
+    PerfCounters()
+    {
+#if defined(__linux__)
+        m_Fds[0] = Open(PERF_COUNT_HW_CPU_CYCLES, -1);
+        if (m_Fds[0] >= 0)
+        {
+            m_Fds[1] = Open(PERF_COUNT_HW_CACHE_MISSES, m_Fds[0]);
+            m_Fds[2] = Open(PERF_COUNT_HW_BRANCH_MISSES, m_Fds[0]);
+        }
+#endif
+    }
+
+    ~PerfCounters()
+    {
+#if defined(__linux__)
+        for (int fd : m_Fds)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool Available() const
+    {
+        return m_Fds[0] >= 0 && m_Fds[1] >= 0 && m_Fds[2] >= 0;
+    }
+
+    void Start()
+    {
+#if defined(__linux__)
+        if (Available())
+        {
+            ioctl(m_Fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(m_Fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    Values Stop()
+    {
+        Values values;
+#if defined(__linux__)
+        if (Available())
+        {
+            ioctl(m_Fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+            uint64_t buffer[1 + s_CounterCount] = {}; // { count, value... }
+            if (read(m_Fds[0], buffer, sizeof(buffer)) == ssize_t(sizeof(buffer)))
+            {
+                values.cycles = buffer[1];
+                values.cacheMisses = buffer[2];
+                values.branchMisses = buffer[3];
+            }
+        }
+#endif
+        return values;
+    }
+};
+
+/*
+	Resident memory of the whole process, from /proc/self/status (Linux).
+	ResetPeak() rewinds the high-water mark (VmHWM) to the current RSS, so
+	the peak read afterwards belongs to whatever ran in between.
+*/
+class MemoryUsage
+{
+#if defined(__linux__)
+    static size_t ReadStatusKb(const char* field)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        size_t length = std::strlen(field);
+        while (std::getline(status, line))
+        {
+            if (line.compare(0, length, field) == 0)
+            {
+                return std::strtoull(line.c_str() + length, nullptr, 10);
+            }
+        }
+        return 0;
+    }
+#endif
+
+public:
+    static size_t CurrentBytes()
+    {
+#if defined(__linux__)
+        return ReadStatusKb("VmRSS:") * 1024;
+#else
+        return 0;
+#endif
+    }
+
+    static size_t PeakBytes()
+    {
+#if defined(__linux__)
+        return ReadStatusKb("VmHWM:") * 1024;
+#else
+        return 0;
+#endif
+    }
+
+    // False when the peak can't be reset, the next PeakBytes() then covers the process lifetime
+    static bool ResetPeak()
+    {
+#if defined(__linux__)
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        clear_refs << "5";
+        clear_refs.flush();
+        return bool(clear_refs);
+#else
+        return false;
+#endif
+    }
+};
+
+struct BenchmarkOptions
+{
+    size_t warmup = 1;         // Untimed runs before measuring
+    size_t repetitions = 10;   // Timed runs
+    bool perfCounters = false; // Also read hardware counters
+    bool peakMemory = false;   // Track how far each case pushes peak RSS above where it started
+    bool cycleCounter = false; // Also read the CPU's cycle counter around each run (Asm_kernels.h)
+    std::string csvPath;       // Write results as CSV here when the report is printed
+    std::string jsonPath;      // Same, as JSON
+    std::string filter;        // Run only the cases whose name contains this
+    std::vector<size_t> sizes;   // Sweep values for programs that take them, empty = the program's own
+    std::vector<size_t> threads;
+    std::string baselinePath;      // CSV of an earlier run (--csv) to compare against
+    double regressionPercent = 5;  // Slower median than the baseline by more than this: a regression
+
+    /*
+		Shared command line for every program:
+			--reps=N --warmup=N --perf --rss --tsc --csv=FILE --json=FILE
+			--filter=TEXT --sizes=LIST --threads=LIST --baseline=FILE --threshold=PERCENT
+		LIST is comma separated, with optional K / M / G (powers of 1024): --sizes=1K,64K,1M.
+		Unknown arguments are left alone for the program to handle.
+	*/
+    static BenchmarkOptions FromArgs(int argc, char** argv)
+    {
+        return FromArgs(argc, argv, BenchmarkOptions());
+    }
+
+    // Same, starting from a program's own defaults (e.g. fewer repetitions for slow runs)
+    static BenchmarkOptions FromArgs(int argc, char** argv, BenchmarkOptions options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            auto value = [&](const char* key) -> const char*
+            {
+                size_t length = std::strlen(key);
+                return arg.compare(0, length, key) == 0 ? arg.c_str() + length : nullptr;
+            };
+
+            if (const char* v = value("--reps="))
+            {
+                options.repetitions = std::max<size_t>(1, std::strtoull(v, nullptr, 10));
+            }
+            else if (const char* v = value("--warmup="))
+            {
+                options.warmup = std::strtoull(v, nullptr, 10);
+            }
+            else if (arg == "--perf")
+            {
+                options.perfCounters = true;
+            }
+            else if (arg == "--rss")
+            {
+                options.peakMemory = true;
+            }
+            else if (arg == "--tsc")
+            {
+                options.cycleCounter = true;
+            }
+            else if (const char* v = value("--csv="))
+            {
+                options.csvPath = v;
+            }
+            else if (const char* v = value("--json="))
+            {
+                options.jsonPath = v;
+            }
+            else if (const char* v = value("--filter="))
+            {
+                options.filter = v;
+            }
+            else if (const char* v = value("--sizes="))
+            {
+                options.sizes = ParseList(v);
+            }
+            else if (const char* v = value("--threads="))
+            {
+                options.threads = ParseList(v);
+            }
+            else if (const char* v = value("--baseline="))
+            {
+                options.baselinePath = v;
+            }
+            else if (const char* v = value("--threshold="))
+            {
+                options.regressionPercent = std::strtod(v, nullptr);
+            }
+        }
+        return options;
+    }
+
+    // "1K,64K,1M" -> { 1024, 65536, 1048576 }; zeros and junk are skipped
+    static std::vector<size_t> ParseList(const char* text)
+    {
+        std::vector<size_t> values;
+        while (*text)
+        {
+            char* end = nullptr;
+            size_t value = std::strtoull(text, &end, 10);
+            if (end == text)
+            {
+                ++text;
+                continue;
+            }
+            switch (*end)
+            {
+            case 'k': case 'K': value <<= 10; ++end; break;
+            case 'm': case 'M': value <<= 20; ++end; break;
+            case 'g': case 'G': value <<= 30; ++end; break;
+            default: break;
+            }
+            if (value)
+            {
+                values.push_back(value);
+            }
+            text = end;
+        }
+        return values;
+    }
+};
+
+struct BenchmarkResult
+{
+    std::string name;
+    size_t runs = 0;
+    uint64_t items = 0; // Work items per run, for throughput (0 = not reported)
+    double minNs = 0;
+    double medianNs = 0;
+    double p99Ns = 0;
+    double meanNs = 0;
+    double stddevNs = 0;
+    bool hasCounters = false;
+    PerfCounters::Values counters; // Per run average
+    bool hasPeakMemory = false;
+    size_t peakMemoryBytes = 0; // Peak RSS during the case minus RSS when it started (heap an earlier
+                                // case freed but the process kept is reused and not counted again)
+    bool hasTicks = false;
+    uint64_t medianTicks = 0; // Cycle counter ticks of the median run: TSC on x86 (constant rate, not core
+                              // cycles), CNTVCT on AArch64; works where perf_event_open is refused
+
+    double ItemsPerSecond() const
+    {
+        return items && medianNs > 0 ? double(items) * 1e9 / medianNs : 0;
+    }
+};
+
+/*
+	Runs a function 'warmup' times untimed, then 'repetitions' times timed
+	at nanosecond resolution, and keeps min / median / p99 / mean / stddev:
+
+		Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+		bench.Run("pool alloc+free", [&]() { ... }, BLOCK_COUNT);
+		bench.Report();
+
+	Make sure the work has an observable result (DoNotOptimize) or the
+	compiler is free to delete it.
+
+	With --baseline=FILE, Report() also compares every case with the same
+	name in a CSV written earlier with --csv, and counts the ones whose
+	median and min both got slower by more than --threshold percent:
+
+		./suite --csv=before.csv
+		./suite --baseline=before.csv --threshold=10 || echo regressed
+*/
+class Benchmark
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    BenchmarkOptions m_Options;
+    std::vector<BenchmarkResult> m_Results;
+    static inline const BenchmarkResult s_Skipped{}; // What Run() returns for a case --filter leaves out
+
+    static BenchmarkResult Summarize(std::string name, std::vector<double>& samples, uint64_t items)
+    {
+        BenchmarkResult result;
+        result.name = std::move(name);
+        result.runs = samples.size();
+        result.items = items;
+
+        std::sort(samples.begin(), samples.end());
+        size_t n = samples.size();
+        result.minNs = samples.front();
+        result.medianNs = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+        result.p99Ns = samples[std::min(n - 1, size_t(std::ceil(n * 0.99)) - 1)]; // Nearest rank
+
+        double sum = 0;
+        for (double sample : samples)
+        {
+            sum += sample;
+        }
+        result.meanNs = sum / n;
+
+        double squares = 0;
+        for (double sample : samples)
+        {
+            squares += (sample - result.meanNs) * (sample - result.meanNs);
+        }
+        result.stddevNs = n > 1 ? std::sqrt(squares / (n - 1)) : 0;
+        return result;
+    }
+
+    // CSV doubles quotes, JSON escapes them
+    static std::string CsvQuoted(const std::string& text)
+    {
+        std::string out = "\"";
+        for (char c : text)
+        {
+            out += c == '"' ? "\"\"" : std::string(1, c);
+        }
+        return out + "\"";
+    }
+
+    static std::string JsonQuoted(const std::string& text)
+    {
+        std::string out = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+            }
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    static std::string FormatTime(double ns)
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2);
+        if (ns >= 1e9)
+        {
+            out << ns / 1e9 << " s";
+        }
+        else if (ns >= 1e6)
+        {
+            out << ns / 1e6 << " ms";
+        }
+        else if (ns >= 1e3)
+        {
+            out << ns / 1e3 << " us";
+        }
+        else
+        {
+            out << ns << " ns";
+        }
+        return out.str();
+    }
+
+    static std::string FormatBytes(size_t bytes)
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1);
+        if (bytes >= (size_t(1) << 30))
+        {
+            out << double(bytes) / double(size_t(1) << 30) << " GB";
+        }
+        else if (bytes >= (size_t(1) << 20))
+        {
+            out << double(bytes) / double(size_t(1) << 20) << " MB";
+        }
+        else
+        {
+            out << double(bytes) / 1024.0 << " KB";
+        }
+        return out.str();
+    }
+
+public:
+    explicit Benchmark(BenchmarkOptions options = {}) : m_Options(std::move(options)) {}
+
+    const BenchmarkOptions& Options() const { return m_Options; }
+    const std::vector<BenchmarkResult>& Results() const { return m_Results; }
+
+    bool Selected(const std::string& name) const
+    {
+        return m_Options.filter.empty() || name.find(m_Options.filter) != std::string::npos;
+    }
+
+    // The sweep from the command line, or the program's own when there is none
+    std::vector<size_t> Sizes(std::vector<size_t> defaults) const
+    {
+        return m_Options.sizes.empty() ? defaults : m_Options.sizes;
+    }
+
+    std::vector<size_t> Threads(std::vector<size_t> defaults) const
+    {
+        return m_Options.threads.empty() ? defaults : m_Options.threads;
+    }
+
+    // nullptr if no case of that name has run
+    const BenchmarkResult* Find(const std::string& name) const
+    {
+        for (const BenchmarkResult& result : m_Results)
+        {
+            if (result.name == name)
+            {
+                return &result;
+            }
+        }
+        return nullptr;
+    }
+
+    // 'setup' runs untimed before every run (warm-up included), 'func' is what gets measured
+    template<typename Setup, typename Func>
+    const BenchmarkResult& RunWithSetup(const std::string& name, Setup&& setup, Func&& func, uint64_t items = 0)
+    {
+        if (!Selected(name))
+        {
+            return s_Skipped;
+        }
+
+        bool track_memory = m_Options.peakMemory && MemoryUsage::ResetPeak();
+        size_t start_memory = track_memory ? MemoryUsage::CurrentBytes() : 0;
+
+        for (size_t i = 0; i < m_Options.warmup; ++i)
+        {
+            setup();
+            func();
+            ClobberMemory();
+        }
+
+        PerfCounters counters;
+        bool use_counters = m_Options.perfCounters && counters.Available();
+        PerfCounters::Values totals;
+
+        size_t repetitions = m_Options.repetitions ? m_Options.repetitions : 1;
+        std::vector<double> samples;
+        samples.reserve(repetitions);
+        std::vector<uint64_t> ticks;
+        ticks.reserve(m_Options.cycleCounter ? repetitions : 0);
+        for (size_t i = 0; i < repetitions; ++i)
+        {
+            setup();
+            ClobberMemory();
+
+            if (use_counters)
+            {
+                counters.Start();
+            }
+            uint64_t start_ticks = m_Options.cycleCounter ? ReadCycleCounter() : 0;
+            auto start = Clock::now();
+            func();
+            ClobberMemory();
+            auto end = Clock::now();
+            if (m_Options.cycleCounter)
+            {
+                ticks.push_back(ReadCycleCounterOrdered() - start_ticks);
+            }
+            if (use_counters)
+            {
+                PerfCounters::Values run = counters.Stop();
+                totals.cycles += run.cycles;
+                totals.cacheMisses += run.cacheMisses;
+                totals.branchMisses += run.branchMisses;
+            }
+
+            samples.push_back(double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+        }
+
+        BenchmarkResult result = Summarize(name, samples, items);
+        if (use_counters)
+        {
+            result.hasCounters = true;
+            result.counters.cycles = totals.cycles / result.runs;
+            result.counters.cacheMisses = totals.cacheMisses / result.runs;
+            result.counters.branchMisses = totals.branchMisses / result.runs;
+        }
+        if (!ticks.empty())
+        {
+            std::sort(ticks.begin(), ticks.end());
+            result.hasTicks = true;
+            result.medianTicks = ticks[ticks.size() / 2];
+        }
+        if (track_memory)
+        {
+            size_t peak = MemoryUsage::PeakBytes();
+            result.hasPeakMemory = true;
+            result.peakMemoryBytes = peak > start_memory ? peak - start_memory : 0;
+        }
+        m_Results.push_back(std::move(result));
+        return m_Results.back();
+    }
+
+    template<typename Func>
+    const BenchmarkResult& Run(const std::string& name, Func&& func, uint64_t items = 0)
+    {
+        return RunWithSetup(name, []() {}, func, items);
+    }
+
+    void PrintTable(std::ostream& out) const
+    {
+        size_t width = 4;
+        for (const BenchmarkResult& result : m_Results)
+        {
+            width = std::max(width, result.name.size());
+        }
+
+        out << std::left << std::setw(int(width)) << "name" << std::right
+            << std::setw(12) << "min" << std::setw(12) << "median" << std::setw(12) << "p99"
+            << std::setw(12) << "stddev" << std::setw(14) << "items/s";
+        if (m_Options.perfCounters)
+        {
+            out << std::setw(14) << "cycles" << std::setw(14) << "cache-miss" << std::setw(14) << "branch-miss";
+        }
+        if (m_Options.cycleCounter)
+        {
+            out << std::setw(14) << "ticks";
+        }
+        if (m_Options.peakMemory)
+        {
+            out << std::setw(12) << "peak RSS";
+        }
+        out << "\n";
+
+        for (const BenchmarkResult& result : m_Results)
+        {
+            out << std::left << std::setw(int(width)) << result.name << std::right
+                << std::setw(12) << FormatTime(result.minNs)
+                << std::setw(12) << FormatTime(result.medianNs)
+                << std::setw(12) << FormatTime(result.p99Ns)
+                << std::setw(12) << FormatTime(result.stddevNs);
+
+            std::ostringstream rate;
+            if (result.items)
+            {
+                rate << std::setprecision(3) << result.ItemsPerSecond();
+            }
+            else
+            {
+                rate << "-";
+            }
+            out << std::setw(14) << rate.str();
+
+            if (m_Options.perfCounters)
+            {
+                if (result.hasCounters)
+                {
+                    out << std::setw(14) << result.counters.cycles << std::setw(14) << result.counters.cacheMisses
+                        << std::setw(14) << result.counters.branchMisses;
+                }
+                else
+                {
+                    out << std::setw(14) << "n/a" << std::setw(14) << "n/a" << std::setw(14) << "n/a";
+                }
+            }
+            if (m_Options.cycleCounter)
+            {
+                out << std::setw(14) << (result.hasTicks ? std::to_string(result.medianTicks) : "n/a");
+            }
+            if (m_Options.peakMemory)
+            {
+                out << std::setw(12) << (result.hasPeakMemory ? "+" + FormatBytes(result.peakMemoryBytes) : "n/a");
+            }
+            out << "\n";
+        }
+    }
+
+    void WriteCsv(std::ostream& out) const
+    {
+        out << "name,runs,items,min_ns,median_ns,p99_ns,mean_ns,stddev_ns,cycles,cache_misses,branch_misses,peak_rss_bytes,ticks\n";
+        for (const BenchmarkResult& result : m_Results)
+        {
+            out << CsvQuoted(result.name) << ',' << result.runs << ',' << result.items << ','
+                << std::fixed << std::setprecision(1)
+                << result.minNs << ',' << result.medianNs << ',' << result.p99Ns << ','
+                << result.meanNs << ',' << result.stddevNs << ',';
+            if (result.hasCounters)
+            {
+                out << result.counters.cycles << ',' << result.counters.cacheMisses << ',' << result.counters.branchMisses;
+            }
+            else
+            {
+                out << ",,";
+            }
+            out << ',';
+            if (result.hasPeakMemory)
+            {
+                out << result.peakMemoryBytes;
+            }
+            out << ',';
+            if (result.hasTicks)
+            {
+                out << result.medianTicks;
+            }
+            out << "\n";
+        }
+    }
+
+    void WriteJson(std::ostream& out) const
+    {
+        out << "[\n" << std::fixed << std::setprecision(1);
+        for (size_t i = 0; i < m_Results.size(); ++i)
+        {
+            const BenchmarkResult& result = m_Results[i];
+            out << "  { \"name\": " << JsonQuoted(result.name) << ", \"runs\": " << result.runs
+                << ", \"items\": " << result.items
+                << ", \"min_ns\": " << result.minNs << ", \"median_ns\": " << result.medianNs
+                << ", \"p99_ns\": " << result.p99Ns << ", \"mean_ns\": " << result.meanNs
+                << ", \"stddev_ns\": " << result.stddevNs;
+            if (result.hasCounters)
+            {
+                out << ", \"cycles\": " << result.counters.cycles << ", \"cache_misses\": " << result.counters.cacheMisses
+                    << ", \"branch_misses\": " << result.counters.branchMisses;
+            }
+            if (result.hasPeakMemory)
+            {
+                out << ", \"peak_rss_bytes\": " << result.peakMemoryBytes;
+            }
+            if (result.hasTicks)
+            {
+                out << ", \"ticks\": " << result.medianTicks;
+            }
+            out << " }" << (i + 1 < m_Results.size() ? "," : "") << "\n";
+        }
+        out << "]\n";
+    }
+
+    // Results back from a file WriteCsv() wrote (name, runs, items and the times; no counters)
+    static std::vector<BenchmarkResult> ReadCsv(std::istream& in)
+    {
+        std::vector<BenchmarkResult> results;
+        std::string line;
+        std::getline(in, line); // Header
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line[0] != '"')
+            {
+                continue;
+            }
+
+            BenchmarkResult result;
+            size_t i = 1;
+            for (; i < line.size(); ++i)
+            {
+                if (line[i] == '"' && (i + 1 == line.size() || line[i + 1] != '"'))
+                {
+                    break;
+                }
+                result.name += line[i];
+                i += line[i] == '"'; // "" is one quote
+            }
+
+            std::istringstream fields(line.substr(std::min(line.size(), i + 2)));
+            char comma;
+            fields >> result.runs >> comma >> result.items >> comma >> result.minNs >> comma >> result.medianNs >> comma
+                   >> result.p99Ns >> comma >> result.meanNs >> comma >> result.stddevNs;
+            if (fields)
+            {
+                results.push_back(std::move(result));
+            }
+        }
+        return results;
+    }
+
+    /*
+		Median against the baseline for every case both runs have, and the
+		number of regressions: median and min both slower by more than the
+		threshold (a run the scheduler preempted moves the median, rarely
+		the min). Compare runs of the same build flags on an idle machine,
+		a noisy one moves medians by several percent on its own (see the
+		stddev column).
+	*/
+    size_t CompareWithBaseline(std::ostream& out) const
+    {
+        std::ifstream file(m_Options.baselinePath);
+        if (!file)
+        {
+            out << "\nBaseline " << m_Options.baselinePath << " can't be read, nothing compared\n";
+            return 0;
+        }
+        std::vector<BenchmarkResult> baseline = ReadCsv(file);
+
+        size_t width = 4;
+        for (const BenchmarkResult& result : m_Results)
+        {
+            width = std::max(width, result.name.size());
+        }
+        out << "\nAgainst " << m_Options.baselinePath << " (regression: median and min more than " << m_Options.regressionPercent
+            << "% slower)\n" << std::left << std::setw(int(width)) << "name" << std::right << std::setw(12) << "baseline"
+            << std::setw(12) << "now" << std::setw(10) << "change" << "\n";
+
+        size_t regressions = 0;
+        for (const BenchmarkResult& result : m_Results)
+        {
+            auto before = std::find_if(baseline.begin(), baseline.end(),
+                                       [&](const BenchmarkResult& old) { return old.name == result.name; });
+            out << std::left << std::setw(int(width)) << result.name << std::right;
+            if (before == baseline.end() || before->medianNs <= 0)
+            {
+                out << std::setw(12) << "-" << std::setw(12) << FormatTime(result.medianNs) << std::setw(10) << "new" << "\n";
+                continue;
+            }
+
+            double change = (result.medianNs - before->medianNs) / before->medianNs * 100;
+            double min_change = before->minNs > 0 ? (result.minNs - before->minNs) / before->minNs * 100 : change;
+            std::ostringstream percent;
+            percent << std::showpos << std::fixed << std::setprecision(1) << change << '%';
+            out << std::setw(12) << FormatTime(before->medianNs) << std::setw(12) << FormatTime(result.medianNs)
+                << std::setw(10) << percent.str();
+            if (change > m_Options.regressionPercent && min_change > m_Options.regressionPercent)
+            {
+                out << "  REGRESSION";
+                ++regressions;
+            }
+            else if (change < -m_Options.regressionPercent)
+            {
+                out << "  faster";
+            }
+            out << "\n";
+        }
+        out << regressions << (regressions == 1 ? " regression\n" : " regressions\n");
+        return regressions;
+    }
+
+    // Table on stdout, the CSV / JSON files asked for on the command line, and the baseline comparison; returns the regressions found
+    size_t Report(std::ostream& out = std::cout) const
+    {
+        PrintTable(out);
+
+        if (!m_Options.csvPath.empty())
+        {
+            std::ofstream file(m_Options.csvPath);
+            WriteCsv(file);
+        }
+        if (!m_Options.jsonPath.empty())
+        {
+            std::ofstream file(m_Options.jsonPath);
+            WriteJson(file);
+        }
+        return m_Options.baselinePath.empty() ? 0 : CompareWithBaseline(out);
+    }
+};
@@ -0,0 +1,751 @@
+// Every technique in the repo in one program: allocators, arenas, AutoArray, random numbers, bit tricks and I/O, and the claims the guides make checked on this machine
+#include <iostream>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Arena.h"
+#include "Auto_array.h"
+#include "Benchmark.h"
+#include "Bit_tricks.h"
+#include "Fast_io.h"
+#include "Fast_random.h"
+#include "Flat_hash_map.h"
+#include "Memory_pool.h"
+#include "Simd_integer_parser.h"
+#include "Simd_random.h"
+#include "Size_class_allocator.h"
+#include "Thread_local_arena.h"
+
+/*
+	Every case is named "<group>: <what>, n=<size>" (plus the block size or
+	thread count where those are swept too), so one sweep value can be
+	picked out with --filter, and any two runs compare with --baseline:
+
+		Benchmark_suite --group=alloc,bits --sizes=4K,1M --threads=1,4 --csv=before.csv
+		Benchmark_suite --group=alloc,bits --sizes=4K,1M --threads=1,4 --baseline=before.csv
+
+	Groups: alloc arena array rng bits io (all by default).
+*/
+
+// 'faster' should beat 'slower' at every sweep value; closer than --threshold percent counts as no difference
+struct Claim
+{
+    const char* source; // Where the repo says it
+    const char* text;
+    std::string faster; // Case names without the sweep suffix
+    std::string slower;
+};
+
+std::string SizeName(size_t n)
+{
+    if (n >= (size_t(1) << 20) && n % (size_t(1) << 20) == 0)
+		return std::to_string(n >> 20) + "M";
+    if (n >= 1024 && n % 1024 == 0)
+		return std::to_string(n >> 10) + "K";
+    return std::to_string(n);
+}
+
+std::string ThreadsName(size_t threads)
+{
+    return std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+}
+
+// Powers of two up to the core count, and the core count itself
+std::vector<size_t> ThreadCounts()
+{
+    const size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    std::vector<size_t> counts;
+    for (size_t n = 1; n < cores; n *= 2)
+		counts.push_back(n);
+    counts.push_back(cores);
+    return counts;
+}
+
+// Runs 'work(count)' on every thread, the n items split evenly
+template<typename Work>
+void RunThreads(size_t threads, size_t n, Work&& work)
+{
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++)
+		workers.emplace_back([&, t]() { work(n / threads + (t < n % threads ? 1 : 0)); });
+    for (std::thread& worker : workers)
+		worker.join();
+}
+
+// Allocate n blocks of 'Bytes' then free them in order, through each allocator; then the same from several threads
+template<size_t Bytes>
+void AllocatorCases(Benchmark& bench, size_t n, const std::vector<size_t>& thread_counts)
+{
+    using Block = std::array<char, Bytes>;
+    const std::string suffix = ", " + std::to_string(Bytes) + " B, n=" + SizeName(n);
+    std::vector<Block*> blocks(n);
+
+    bench.Run("alloc: new/delete" + suffix, [&]()
+    {
+        for (size_t i = 0; i < n; i++)
+		{
+			blocks[i] = new Block;
+			DoNotOptimize(blocks[i]);
+		}
+        for (Block* block : blocks)
+			delete block;
+    }, n);
+
+    bench.Run("alloc: malloc/free" + suffix, [&]()
+    {
+        for (size_t i = 0; i < n; i++)
+		{
+			blocks[i] = static_cast<Block*>(std::malloc(Bytes));
+			DoNotOptimize(blocks[i]);
+		}
+        for (Block* block : blocks)
+			std::free(block);
+    }, n);
+
+    {
+        MemoryPool<Block> pool(n);
+        bench.Run("alloc: MemoryPool" + suffix, [&]()
+        {
+            for (size_t i = 0; i < n; i++)
+			{
+				blocks[i] = pool.Allocate();
+				DoNotOptimize(blocks[i]);
+			}
+            for (Block* block : blocks)
+				pool.Deallocate(block);
+        }, n);
+    }
+
+    {
+        SizeClassAllocator size_classes;
+        bench.Run("alloc: SizeClassAllocator" + suffix, [&]()
+        {
+            for (size_t i = 0; i < n; i++)
+			{
+				blocks[i] = static_cast<Block*>(size_classes.Allocate(Bytes));
+				DoNotOptimize(blocks[i]);
+			}
+            for (Block* block : blocks)
+				size_classes.Deallocate(block, Bytes);
+        }, n);
+    }
+
+    // Each thread keeps its own blocks: the cost of sharing one allocator, not of passing blocks around
+    for (size_t threads : thread_counts)
+	{
+		const std::string threaded = suffix + ", " + ThreadsName(threads);
+		bench.Run("alloc: new/delete" + threaded, [&]()
+		{
+			RunThreads(threads, n, [](size_t count)
+			{
+				std::vector<Block*> mine(count);
+				for (Block*& block : mine)
+				{
+					block = new Block;
+					DoNotOptimize(block);
+				}
+				for (Block* block : mine)
+					delete block;
+			});
+		}, n);
+
+		ConcurrentMemoryPool<Block> pool(n + threads * 3 * 64);
+		bench.Run("alloc: ConcurrentMemoryPool" + threaded, [&]()
+		{
+			RunThreads(threads, n, [&](size_t count)
+			{
+				typename ConcurrentMemoryPool<Block>::ThreadCache cache(pool);
+				std::vector<Block*> mine(count);
+				for (Block*& block : mine)
+				{
+					block = cache.Allocate();
+					DoNotOptimize(block);
+				}
+				for (Block* block : mine)
+					cache.Deallocate(block);
+			});
+		}, n);
+	}
+}
+
+struct Particle
+{
+    float position[3];
+    float velocity[3];
+    uint32_t id;
+    uint32_t flags;
+};
+
+// n short lived objects, all freed together
+void ArenaCases(Benchmark& bench, size_t n)
+{
+    const std::string suffix = ", n=" + SizeName(n);
+    std::vector<Particle*> particles(n);
+
+    bench.Run("arena: new/delete per object" + suffix, [&]()
+    {
+        for (size_t i = 0; i < n; i++)
+		{
+			particles[i] = new Particle{ {}, {}, uint32_t(i), 0 };
+			DoNotOptimize(particles[i]);
+		}
+        for (Particle* particle : particles)
+			delete particle;
+    }, n);
+
+    // reset() keeps the blocks: after the warm-up no run calls the system allocator
+    Arena arena;
+    bench.Run("arena: Arena allocate + reset" + suffix, [&]()
+    {
+        for (size_t i = 0; i < n; i++)
+		{
+			particles[i] = new (arena.allocate<Particle>()) Particle{ {}, {}, uint32_t(i), 0 };
+			DoNotOptimize(particles[i]);
+		}
+        arena.reset();
+    }, n);
+
+    bench.Run("arena: ArenaScope on the thread arena" + suffix, [&]()
+    {
+        ArenaScope scope;
+        Arena& local = ThreadArenas::Local();
+        for (size_t i = 0; i < n; i++)
+		{
+			particles[i] = new (local.allocate<Particle>()) Particle{ {}, {}, uint32_t(i), 0 };
+			DoNotOptimize(particles[i]);
+		}
+    }, n);
+}
+
+[[gnu::noinline]] uint64_t SumByValue(std::vector<int> values)
+{
+    uint64_t sum = 0;
+    for (int value : values)
+		sum += uint64_t(value);
+    return sum;
+}
+
+[[gnu::noinline]] uint64_t SumByReference(const std::vector<int>& values)
+{
+    uint64_t sum = 0;
+    for (int value : values)
+		sum += uint64_t(value);
+    return sum;
+}
+
+// Containers and the habits the guide recommends for them
+void ArrayCases(Benchmark& bench, size_t n)
+{
+    const std::string suffix = ", n=" + SizeName(n);
+
+    bench.Run("array: std::vector push_back" + suffix, [&]()
+    {
+        std::vector<int> values;
+        for (size_t i = 0; i < n; i++)
+			values.push_back(int(i));
+        DoNotOptimize(values.data());
+    }, n);
+
+    bench.Run("array: std::vector reserve + push_back" + suffix, [&]()
+    {
+        std::vector<int> values;
+        values.reserve(n);
+        for (size_t i = 0; i < n; i++)
+			values.push_back(int(i));
+        DoNotOptimize(values.data());
+    }, n);
+
+    bench.Run("array: AutoArray push_back" + suffix, [&]()
+    {
+        AutoArray<int> values;
+        for (size_t i = 0; i < n; i++)
+			values.push_back(int(i));
+        DoNotOptimize(values.data());
+    }, n);
+
+    bench.Run("array: AutoArray reserve + push_back" + suffix, [&]()
+    {
+        AutoArray<int> values;
+        values.reserve(n);
+        for (size_t i = 0; i < n; i++)
+			values.push_back(int(i));
+        DoNotOptimize(values.data());
+    }, n);
+
+    bench.Run("array: push_back(make_pair(i, string))" + suffix, [&]()
+    {
+        std::vector<std::pair<int, std::string>> values;
+        values.reserve(n);
+        for (size_t i = 0; i < n; i++)
+			values.push_back(std::make_pair(int(i), "Hello"));
+        DoNotOptimize(values.data());
+    }, n);
+
+    bench.Run("array: emplace_back(i, string)" + suffix, [&]()
+    {
+        std::vector<std::pair<int, std::string>> values;
+        values.reserve(n);
+        for (size_t i = 0; i < n; i++)
+			values.emplace_back(int(i), "Hello");
+        DoNotOptimize(values.data());
+    }, n);
+
+    // 16 calls over a vector of n ints: by value copies (and frees) it every time
+    std::vector<int> numbers(n);
+    for (size_t i = 0; i < n; i++)
+		numbers[i] = int(i * 2654435761u);
+    bench.Run("array: pass std::vector by value" + suffix, [&]()
+    {
+        uint64_t sum = 0;
+        for (int call = 0; call < 16; call++)
+			sum += SumByValue(numbers);
+        DoNotOptimize(sum);
+    }, 16 * n);
+
+    bench.Run("array: pass std::vector by const&" + suffix, [&]()
+    {
+        uint64_t sum = 0;
+        for (int call = 0; call < 16; call++)
+			sum += SumByReference(numbers);
+        DoNotOptimize(sum);
+    }, 16 * n);
+
+    // Strings longer than the small string buffer: a copy allocates, a move takes the pointer
+    std::vector<std::string> source, target(n);
+    auto refill = [&]()
+    {
+        source.assign(n, std::string(100, 'x'));
+    };
+    bench.RunWithSetup("array: copy strings" + suffix, refill, [&]()
+    {
+        for (size_t i = 0; i < n; i++)
+			target[i] = source[i];
+        DoNotOptimize(target.data());
+    }, n);
+
+    bench.RunWithSetup("array: std::move strings" + suffix, refill, [&]()
+    {
+        for (size_t i = 0; i < n; i++)
+			target[i] = std::move(source[i]);
+        DoNotOptimize(target.data());
+    }, n);
+
+    // n lookups of keys that are all present, in random order
+    std::vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; i++)
+		keys[i] = (i + 1) * 0x9E3779B97F4A7C15;
+    std::vector<uint64_t> probes = keys;
+    std::shuffle(probes.begin(), probes.end(), std::mt19937_64(3));
+
+    auto lookups = [&](const std::string& name, auto& map)
+    {
+        if (!bench.Selected(name + suffix))
+			return;
+        for (uint64_t key : keys)
+			map.try_emplace(key, key);
+        bench.Run(name + suffix, [&]()
+        {
+            uint64_t found = 0;
+            for (uint64_t key : probes)
+				found += map.find(key)->second;
+            DoNotOptimize(found);
+        }, n);
+    };
+    {
+        std::map<uint64_t, uint64_t> map;
+        lookups("array: std::map lookups", map);
+    }
+    {
+        std::unordered_map<uint64_t, uint64_t> map;
+        lookups("array: std::unordered_map lookups", map);
+    }
+    {
+        FlatHashMap<uint64_t, uint64_t> map;
+        lookups("array: FlatHashMap lookups", map);
+    }
+
+    // The same n words read from an 8 byte aligned address and from one byte past it
+    std::vector<uint64_t> storage(n + 1);
+    for (size_t i = 0; i < n; i++)
+		storage[i] = i;
+    auto sum_words = [&](const char* bytes)
+    {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; i++)
+		{
+			uint64_t word;
+			std::memcpy(&word, bytes + i * 8, 8);
+			sum += word;
+		}
+        DoNotOptimize(sum);
+    };
+    bench.Run("array: sum of aligned uint64_t" + suffix, [&]() { sum_words(reinterpret_cast<const char*>(storage.data())); }, n);
+    bench.Run("array: sum of misaligned uint64_t" + suffix, [&]() { sum_words(reinterpret_cast<const char*>(storage.data()) + 1); }, n);
+}
+
+std::mt19937 g_Mt19937(12345);
+
+int RandomPercentReseeded(unsigned seed)
+{
+    std::mt19937 rng(seed);
+    return int(rng() % 100);
+}
+
+int RandomPercent()
+{
+    return int(g_Mt19937() % 100);
+}
+
+template<typename Engine>
+uint64_t SumOutputs(Engine& engine, size_t count)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; i++)
+		sum += engine();
+    return sum;
+}
+
+void RandomCases(Benchmark& bench, size_t n)
+{
+    const std::string suffix = ", n=" + SizeName(n);
+
+    // A new engine per number: 2.5 KB of state to seed every time, so fewer of them
+    const size_t reseeded = std::max<size_t>(n / 64, 1);
+    bench.Run("rng: mt19937 seeded on every call" + suffix, [&]()
+    {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < reseeded; i++)
+			sum += uint64_t(RandomPercentReseeded(unsigned(i)));
+        DoNotOptimize(sum);
+    }, reseeded);
+
+    bench.Run("rng: mt19937 seeded once" + suffix, [&]()
+    {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; i++)
+			sum += uint64_t(RandomPercent());
+        DoNotOptimize(sum);
+    }, n);
+
+    bench.Run("rng: mt19937 + uniform_int_distribution" + suffix, [&]()
+    {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; i++)
+			sum += uint64_t(std::uniform_int_distribution<int>(1, 50)(g_Mt19937));
+        DoNotOptimize(sum);
+    }, n);
+
+    bench.Run("rng: ThreadRandom + RandomInt" + suffix, [&]()
+    {
+        uint64_t sum = 0;
+        Xoshiro256StarStar& engine = ThreadRandom::Local();
+        for (size_t i = 0; i < n; i++)
+			sum += uint64_t(RandomInt(engine, 1, 50));
+        DoNotOptimize(sum);
+    }, n);
+
+    bench.Run("rng: rand()" + suffix, [&]()
+    {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; i++)
+			sum += uint64_t(std::rand());
+        DoNotOptimize(sum);
+    }, n);
+
+    std::mt19937_64 mt64(1);
+    bench.Run("rng: mt19937_64 raw" + suffix, [&]() { DoNotOptimize(SumOutputs(mt64, n)); }, n);
+    Xoshiro256StarStar xoshiro(1);
+    bench.Run("rng: Xoshiro256** raw" + suffix, [&]() { DoNotOptimize(SumOutputs(xoshiro, n)); }, n);
+    Pcg64 pcg(1);
+    bench.Run("rng: Pcg64 raw" + suffix, [&]() { DoNotOptimize(SumOutputs(pcg, n)); }, n);
+
+    std::vector<uint64_t> out(n);
+    SimdRandom<> simd(1);
+    bench.Run("rng: SimdRandom Fill" + suffix, [&]()
+    {
+        simd.Fill(std::span<uint64_t>(out.data(), n));
+        ClobberMemory();
+    }, n);
+}
+
+[[gnu::noinline]] int PopCountLoop(uint32_t x)
+{
+    int count = 0;
+    for (; x; x >>= 1)
+		count += int(x & 1);
+    return count;
+}
+
+void BitCases(Benchmark& bench, size_t n)
+{
+    const std::string suffix = ", n=" + SizeName(n);
+    std::vector<int> numbers(n);
+    for (size_t i = 0; i < n; i++)
+		numbers[i] = int(i * 2654435761u);
+
+    bench.Run("bits: x & 1" + suffix, [&]()
+    {
+        size_t odd = 0;
+        for (int x : numbers)
+			odd += x & 1;
+        DoNotOptimize(odd);
+    }, n);
+
+    bench.Run("bits: x % 2 != 0" + suffix, [&]()
+    {
+        size_t odd = 0;
+        for (int x : numbers)
+			odd += x % 2 != 0;
+        DoNotOptimize(odd);
+    }, n);
+
+    std::vector<int> doubled(n);
+    bench.Run("bits: x << 1" + suffix, [&]()
+    {
+        for (size_t i = 0; i < n; i++)
+			doubled[i] = int(unsigned(numbers[i]) << 1);
+        DoNotOptimize(doubled.data());
+    }, n);
+
+    bench.Run("bits: x * 2" + suffix, [&]()
+    {
+        for (size_t i = 0; i < n; i++)
+			doubled[i] = int(unsigned(numbers[i]) * 2);
+        DoNotOptimize(doubled.data());
+    }, n);
+
+    bench.Run("bits: PopCount" + suffix, [&]()
+    {
+        size_t bits = 0;
+        for (int x : numbers)
+			bits += size_t(PopCount(uint32_t(x)));
+        DoNotOptimize(bits);
+    }, n);
+
+    bench.Run("bits: popcount loop over the bits" + suffix, [&]()
+    {
+        size_t bits = 0;
+        for (int x : numbers)
+			bits += size_t(PopCountLoop(uint32_t(x)));
+        DoNotOptimize(bits);
+    }, n);
+
+    // The alignment isn't known at compile time, as in an allocator
+    volatile size_t runtime_align = 64;
+    const size_t align = runtime_align;
+    bench.Run("bits: AlignUp" + suffix, [&]()
+    {
+        size_t total = 0;
+        for (int x : numbers)
+			total += AlignUp(size_t(unsigned(x)), align);
+        DoNotOptimize(total);
+    }, n);
+
+    bench.Run("bits: (x + align - 1) / align * align" + suffix, [&]()
+    {
+        size_t total = 0;
+        for (int x : numbers)
+			total += (size_t(unsigned(x)) + align - 1) / align * align;
+        DoNotOptimize(total);
+    }, n);
+}
+
+// n numbers written and read back through each API, one file in the temp directory
+void IoCases(Benchmark& bench, size_t n)
+{
+    const std::string suffix = ", n=" + SizeName(n);
+    const std::string path = (std::filesystem::temp_directory_path() / "benchmark_suite.txt").string();
+    const std::string written = path + ".out";
+
+    // A flush per line is a write(2) per line: fewer of them
+    const size_t flushed = std::max<size_t>(n / 64, 1);
+    bench.Run("io: ofstream << std::endl" + suffix, [&]()
+    {
+        std::ofstream out(written);
+        for (size_t i = 0; i < flushed; i++)
+			out << i << std::endl;
+    }, flushed);
+
+    bench.Run("io: ofstream << '\\n'" + suffix, [&]()
+    {
+        std::ofstream out(written);
+        for (size_t i = 0; i < n; i++)
+			out << i << '\n';
+    }, n);
+
+    bench.Run("io: FastOutput" + suffix, [&]()
+    {
+        FastOutput out(written.c_str());
+        for (size_t i = 0; i < n; i++)
+			out << i << '\n';
+    }, n);
+    std::filesystem::remove(written);
+
+    // Written here whatever --filter leaves out, and read from the page cache
+    {
+        FastOutput out(path.c_str());
+        for (size_t i = 0; i < n; i++)
+			out << i << '\n';
+    }
+    const long long expected = (long long)n * ((long long)n - 1) / 2;
+    auto check = [&](const char* what, long long sum)
+    {
+        if (sum != expected)
+			std::cerr << what << suffix << ": wrong sum\n";
+    };
+
+    bench.Run("io: ifstream >>" + suffix, [&]()
+    {
+        std::ifstream in(path);
+        long long sum = 0, value;
+        while (in >> value)
+			sum += value;
+        check("ifstream", sum);
+    }, n);
+
+    bench.Run("io: fscanf" + suffix, [&]()
+    {
+        FILE* in = std::fopen(path.c_str(), "r");
+        long long sum = 0, value;
+        while (in && std::fscanf(in, "%lld", &value) == 1)
+			sum += value;
+        if (in)
+			std::fclose(in);
+        check("fscanf", sum);
+    }, n);
+
+    bench.Run("io: FastInput::Read" + suffix, [&]()
+    {
+        FastInput in(path.c_str());
+        long long sum = 0;
+        int64_t value;
+        while (in.Read(value))
+			sum += value;
+        check("FastInput", sum);
+    }, n);
+
+    // Into the caller's buffer a chunk at a time, so the array growing isn't part of the comparison
+    std::vector<int64_t> chunk(4096);
+    bench.Run("io: FastInput + ParseIntegers" + suffix, [&]()
+    {
+        FastInput in(path.c_str());
+        long long sum = 0;
+        while (size_t got = ParseIntegers(in, std::span<int64_t>(chunk)))
+			for (size_t i = 0; i < got; i++)
+				sum += chunk[i];
+        check("ParseIntegers", sum);
+    }, n);
+
+    std::filesystem::remove(path);
+}
+
+/*
+	For every case whose name starts with 'faster', the case named 'slower'
+	with the same sweep suffix: throughput (items/s) against throughput, so
+	cases that run fewer items because they are slow still compare.
+*/
+void ReportClaims(const Benchmark& bench, const std::vector<Claim>& claims)
+{
+    const double threshold = 1 + bench.Options().regressionPercent / 100;
+    std::cout << "\nClaims (holds: the faster case wins by more than " << bench.Options().regressionPercent << "%)\n"
+              << std::fixed << std::setprecision(2);
+    for (const Claim& claim : claims)
+	{
+		std::cout << claim.source << ": " << claim.text << '\n';
+		bool any = false;
+		for (const BenchmarkResult& faster : bench.Results())
+		{
+			if (faster.name.compare(0, claim.faster.size(), claim.faster) != 0 || !faster.items)
+				continue;
+			const std::string sweep = faster.name.substr(claim.faster.size());
+			const BenchmarkResult* slower = bench.Find(claim.slower + sweep);
+			if (!slower || !slower->items)
+				continue;
+
+			double ratio = faster.ItemsPerSecond() / slower->ItemsPerSecond();
+			const char* verdict = ratio > threshold ? "holds" : ratio < 1 / threshold ? "the other way round" : "no measurable difference";
+			std::cout << "  " << (sweep.size() > 2 ? sweep.substr(2) : sweep) << ": " << ratio << "x, " << verdict << '\n';
+			any = true;
+		}
+		if (!any)
+			std::cout << "  not run\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions defaults;
+    defaults.repetitions = 5;
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv, defaults));
+    const std::vector<size_t> sizes = bench.Sizes({ 1 << 10, 1 << 16, 1 << 20 });
+    const std::vector<size_t> thread_counts = bench.Threads(ThreadCounts());
+
+    std::string groups = "alloc,arena,array,rng,bits,io";
+    for (int i = 1; i < argc; i++)
+		if (std::strncmp(argv[i], "--group=", 8) == 0)
+			groups = argv[i] + 8;
+    auto wanted = [&](const char* group) { return ("," + groups + ",").find("," + std::string(group) + ",") != std::string::npos; };
+
+    for (size_t n : sizes)
+	{
+		if (wanted("alloc"))
+		{
+			AllocatorCases<16>(bench, n, {});
+			AllocatorCases<64>(bench, n, thread_counts);
+			AllocatorCases<256>(bench, n, {});
+		}
+		if (wanted("arena"))
+			ArenaCases(bench, n);
+		if (wanted("array"))
+			ArrayCases(bench, n);
+		if (wanted("rng"))
+			RandomCases(bench, n);
+		if (wanted("bits"))
+			BitCases(bench, n);
+		if (wanted("io"))
+			IoCases(bench, n);
+	}
+
+    size_t regressions = bench.Report();
+
+    const std::vector<Claim> claims = {
+        { "Fast_allocator_than_new_and_delete.cpp", "the pool is faster than new and delete", "alloc: MemoryPool", "alloc: new/delete" },
+        { "Custom_memory_allocation_technics.md", "memory pool: extremely fast (one shared pool, thread caches)", "alloc: ConcurrentMemoryPool", "alloc: new/delete" },
+        { "Size_class_allocator.cpp", "size classes beat malloc for small objects", "alloc: SizeClassAllocator", "alloc: malloc/free" },
+        { "How_memory_arena_works.md", "ultra-fast allocations and bulk deallocation", "arena: Arena allocate + reset", "arena: new/delete per object" },
+        { "Memory_arena.md", "fast allocation by bumping an offset (thread arena, scoped)", "arena: ArenaScope on the thread arena", "arena: new/delete per object" },
+        { "Custom_memory_allocation_technics.md", "alignment: faster CPU access", "array: sum of aligned uint64_t", "array: sum of misaligned uint64_t" },
+        { "Tricks_to_low_level_programming.md #1", "seed once instead of on every call", "rng: mt19937 seeded once", "rng: mt19937 seeded on every call" },
+        { "Efficient_random_number_generator.cpp", "thread xoshiro256** + Lemire beats mt19937 + distribution", "rng: ThreadRandom + RandomInt", "rng: mt19937 + uniform_int_distribution" },
+        { "Tricks_to_low_level_programming.md #2", "'\\n' is faster than std::endl", "io: ofstream << '\\n'", "io: ofstream << std::endl" },
+        { "Tricks_to_low_level_programming.md #3", "reserve() makes push_back faster", "array: std::vector reserve + push_back", "array: std::vector push_back" },
+        { "Tricks_to_low_level_programming.md #4", "pass large objects by const&", "array: pass std::vector by const&", "array: pass std::vector by value" },
+        { "Tricks_to_low_level_programming.md #5", "std::move avoids the copy", "array: std::move strings", "array: copy strings" },
+        { "Odd_or_even.cpp", "x & 1 is the fastest way to check odd / even", "bits: x & 1", "bits: x % 2 != 0" },
+        { "Tricks_to_low_level_programming.md #6", "x << 1 is faster than x * 2", "bits: x << 1", "bits: x * 2" },
+        { "Tricks_to_low_level_programming.md #6", "PopCount is one instruction, not a loop", "bits: PopCount", "bits: popcount loop over the bits" },
+        { "Tricks_to_low_level_programming.md #6", "AlignUp needs no division", "bits: AlignUp", "bits: (x + align - 1) / align * align" },
+        { "Tricks_to_low_level_programming.md #7", "emplace_back is faster than push_back(make_pair)", "array: emplace_back(i, string)", "array: push_back(make_pair(i, string))" },
+        { "Tricks_to_low_level_programming.md #8", "unordered_map lookups are faster than map", "array: std::unordered_map lookups", "array: std::map lookups" },
+        { "Tricks_to_low_level_programming.md #8", "FlatHashMap lookups are faster than unordered_map", "array: FlatHashMap lookups", "array: std::unordered_map lookups" },
+        { "Fast_io.h", "FastInput is faster than iostreams", "io: FastInput::Read", "io: ifstream >>" },
+        { "Simd_integer_parser.h", "the bulk parser is faster than one Read() per number", "io: FastInput + ParseIntegers", "io: FastInput::Read" },
+    };
+    ReportClaims(bench, claims);
+
+    // Non-zero exit status when --baseline found regressions, for scripts
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,203 @@
+// Bit tricks beyond x & 1: every helper of Bit_tricks.h against the naive loop it replaces
+#include <iostream>
+#include <bitset>
+#include <cstdint>
+#include <vector>
+#include "Benchmark.h"
+#include "Bit_tricks.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Everything is usable at compile time
+static_assert(PopCount(0xF0F0u) == 8 && Parity(0b111u) == 1 && Parity(0b11u) == 0);
+static_assert(CountLeadingZeros(uint32_t(1)) == 31 && CountTrailingZeros(uint64_t(8)) == 3);
+static_assert(CountTrailingZeros(0u) == 32);
+static_assert(NextPowerOfTwo(17u) == 32 && NextPowerOfTwo(32u) == 32 && NextPowerOfTwo(0u) == 1);
+static_assert(AlignUp(size_t(13), size_t(8)) == 16 && AlignDown(size_t(13), size_t(8)) == 8);
+static_assert(ExtractBits(0b1011'0110u, 0b1111'0000u) == 0b1011u);
+static_assert(DepositBits(0b1011u, 0b1111'0000u) == 0b1011'0000u);
+static_assert(BranchlessMin(-3, 7) == -3 && BranchlessMax(-3, 7) == 7 && BranchlessAbs(-5) == 5);
+static_assert(Select(true, 1, 2) == 1 && Select(false, 1, 2) == 2);
+static_assert([]()
+{
+    BitSet<300> bits;
+    bits.Set(5);
+    bits.Set(299);
+    return bits.FindFirst() == 5 && bits.FindNext(6) == 299 && bits.Count() == 2 && bits.FindFirstClear() == 0;
+}());
+
+// The textbook loops
+int NaivePopCount(uint64_t x)
+{
+    int count = 0;
+    for (; x; x >>= 1)
+		count += int(x & 1);
+    return count;
+}
+
+int NaiveLeadingZeros(uint64_t x)
+{
+    int count = 0;
+    for (uint64_t bit = uint64_t(1) << 63; bit && !(x & bit); bit >>= 1)
+		count++;
+    return count;
+}
+
+uint64_t NaiveNextPowerOfTwo(uint64_t x)
+{
+    uint64_t power = 1;
+    while (power < x)
+		power <<= 1;
+    return power;
+}
+
+uint64_t NaiveAlignUp(uint64_t value, uint64_t align)
+{
+    return (value + align - 1) / align * align;
+}
+
+uint64_t NaiveExtractBits(uint64_t x, uint64_t mask)
+{
+    uint64_t result = 0;
+    int out = 0;
+    for (int bit = 0; bit < 64; bit++)
+	{
+		if (mask & (uint64_t(1) << bit))
+			result |= ((x >> bit) & 1) << out++;
+	}
+    return result;
+}
+
+int64_t BranchyAbs(int64_t x)
+{
+    if (x < 0)
+		return -x;
+    return x;
+}
+
+#if defined(__x86_64__)
+// PEXT for CPUs that have it, whatever this file was compiled for
+__attribute__((target("bmi2"))) uint64_t SumPext(const std::vector<uint64_t>& values, uint64_t mask)
+{
+    uint64_t sum = 0;
+    for (uint64_t v : values)
+		sum += _pext_u64(v, mask);
+    return sum;
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    constexpr size_t COUNT = 1'000'000;
+    std::vector<uint64_t> values(COUNT);
+    uint64_t state = 1;
+    for (uint64_t& v : values)
+	{
+		state = state * 6364136223846793005 + 1442695040888963407;
+		v = state >> (state >> 58); // All bit lengths, so the loops don't always run 64 times
+	}
+
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+
+    auto sum_of = [&](auto function)
+    {
+        return [&values, function]()
+        {
+            uint64_t sum = 0;
+            for (uint64_t v : values)
+				sum += uint64_t(function(v));
+            DoNotOptimize(sum);
+        };
+    };
+
+    bench.Run("popcount: bit loop", sum_of([](uint64_t v) { return NaivePopCount(v); }), COUNT);
+    bench.Run("popcount: PopCount", sum_of([](uint64_t v) { return PopCount(v); }), COUNT);
+    bench.Run("parity: bit loop", sum_of([](uint64_t v) { return NaivePopCount(v) & 1; }), COUNT);
+    bench.Run("parity: Parity", sum_of([](uint64_t v) { return Parity(v); }), COUNT);
+    bench.Run("leading zeros: bit loop", sum_of([](uint64_t v) { return NaiveLeadingZeros(v); }), COUNT);
+    bench.Run("leading zeros: CountLeadingZeros", sum_of([](uint64_t v) { return CountLeadingZeros(v); }), COUNT);
+    bench.Run("next power of two: doubling loop", sum_of([](uint64_t v) { return NaiveNextPowerOfTwo(v >> 1); }), COUNT);
+    bench.Run("next power of two: NextPowerOfTwo", sum_of([](uint64_t v) { return NextPowerOfTwo(v >> 1); }), COUNT);
+
+    // A runtime alignment: the division can't be turned into a shift
+    volatile uint64_t runtime_align = 64;
+    const uint64_t align = runtime_align;
+    bench.Run("align up: divide and multiply", sum_of([align](uint64_t v) { return NaiveAlignUp(v >> 8, align); }), COUNT);
+    bench.Run("align up: AlignUp", sum_of([align](uint64_t v) { return AlignUp(v >> 8, align); }), COUNT);
+
+    const uint64_t mask = 0x00FF'F0F0'0F0F'AA55;
+    bench.Run("extract bits: bit loop", sum_of([mask](uint64_t v) { return NaiveExtractBits(v, mask); }), COUNT);
+    bench.Run("extract bits: ExtractBits", sum_of([mask](uint64_t v) { return ExtractBits(v, mask); }), COUNT);
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("bmi2"))
+		bench.Run("extract bits: PEXT", [&]() { DoNotOptimize(SumPext(values, mask)); }, COUNT);
+#endif
+
+    // Unpredictable signs: a branch mispredicts half the time. The sums are unsigned, so they wrap instead of overflowing
+    std::vector<int64_t> signed_values(values.begin(), values.end());
+    bench.Run("abs: branch", [&]()
+    {
+        uint64_t sum = 0;
+        for (int64_t v : signed_values)
+			sum += uint64_t(BranchyAbs(v >> 1));
+        DoNotOptimize(sum);
+    }, COUNT);
+
+    bench.Run("abs: BranchlessAbs", [&]()
+    {
+        uint64_t sum = 0;
+        for (int64_t v : signed_values)
+			sum += uint64_t(BranchlessAbs(v >> 1));
+        DoNotOptimize(sum);
+    }, COUNT);
+
+    bench.Run("min: Select over pairs", [&]()
+    {
+        uint64_t sum = 0;
+        for (size_t i = 0; i + 1 < COUNT; i++)
+			sum += uint64_t(BranchlessMin(signed_values[i], signed_values[i + 1]));
+        DoNotOptimize(sum);
+    }, COUNT);
+
+    // Walking the set bits of a sparse million-bit set
+    constexpr size_t BITS = 1 << 20;
+    static BitSet<BITS> sparse;
+    static std::bitset<BITS> standard;
+    for (size_t i = 0; i < BITS; i += 4099)
+	{
+		sparse.Set(i);
+		standard.set(i);
+	}
+
+    bench.Run("bitset scan: std::bitset test(i)", [&]()
+    {
+        size_t sum = 0;
+        for (size_t i = 0; i < BITS; i++)
+		{
+			if (standard.test(i))
+				sum += i;
+		}
+        DoNotOptimize(sum);
+    }, BITS);
+
+    bench.Run("bitset scan: BitSet FindNext", [&]()
+    {
+        size_t sum = 0;
+        for (size_t i = sparse.FindFirst(); i < BITS; i = sparse.FindNext(i + 1))
+			sum += i;
+        DoNotOptimize(sum);
+    }, BITS);
+
+    bench.Run("bitset scan: BitSet ForEach", [&]()
+    {
+        size_t sum = 0;
+        sparse.ForEach([&](size_t i) { sum += i; });
+        DoNotOptimize(sum);
+    }, BITS);
+
+    bench.Report();
+    return 0;
+}
@@ -0,0 +1,355 @@
+// Branchless bit manipulation: counts, powers of two, alignment, PEXT/PDEP, min/max/select and a scannable BitSet
+#pragma once
+#include <bit>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+/*
+	Everything here is constexpr and works on any unsigned integer type
+	(the min/max/abs/select helpers also on signed ones).
+
+	The counts go through <bit> (std::popcount, std::countl_zero, ...),
+	which GCC and Clang lower to one instruction (popcnt, lzcnt / bsr,
+	tzcnt / bsf, cnt on AArch64) when the target has it, -mpopcnt / -mbmi /
+	-march=native, and to a short table-free sequence otherwise.
+
+	ExtractBits / DepositBits are x86's PEXT / PDEP. With BMI2 enabled at
+	compile time (-mbmi2, -march=haswell or newer) they are one instruction,
+	otherwise and in constant evaluation a loop over the mask bits. Note
+	that AMD before Zen 3 runs PEXT / PDEP in microcode: the loop can be
+	faster there for sparse masks.
+*/
+
+template<typename T>
+concept UnsignedBits = std::is_unsigned_v<T> && !std::is_same_v<T, bool>;
+
+template<typename T>
+inline constexpr int s_BitWidth = int(sizeof(T) * CHAR_BIT);
+
+// Number of set bits
+template<UnsignedBits T>
+constexpr int PopCount(T x)
+{
+    return std::popcount(x);
+}
+
+// 1 when an odd number of bits is set
+template<UnsignedBits T>
+constexpr int Parity(T x)
+{
+    return std::popcount(x) & 1;
+}
+
+// Zeros above the highest set bit; the bit width for 0
+template<UnsignedBits T>
+constexpr int CountLeadingZeros(T x)
+{
+    return std::countl_zero(x);
+}
+
+// Zeros below the lowest set bit; the bit width for 0
+template<UnsignedBits T>
+constexpr int CountTrailingZeros(T x)
+{
+    return std::countr_zero(x);
+}
+
+template<UnsignedBits T>
+constexpr bool IsPowerOfTwo(T x)
+{
+    return x && !(x & (x - 1));
+}
+
+// Smallest power of two >= x; 1 for 0. x must not be above the largest power of two of T
+template<UnsignedBits T>
+constexpr T NextPowerOfTwo(T x)
+{
+    return x <= 1 ? T(1) : T(T(1) << (s_BitWidth<T> - std::countl_zero(T(x - 1))));
+}
+
+// Lowest set bit alone (x & -x), and x without it
+template<UnsignedBits T>
+constexpr T LowestBit(T x)
+{
+    return T(x & (~x + 1));
+}
+
+template<UnsignedBits T>
+constexpr T ClearLowestBit(T x)
+{
+    return T(x & (x - 1));
+}
+
+/*
+	Rounding to a multiple of 'align', a power of two: one add and one and,
+	no division. AlignUp(13, 8) == 16, AlignUp(16, 8) == 16.
+*/
+template<UnsignedBits T>
+constexpr T AlignUp(T value, T align)
+{
+    return T((value + align - 1) & ~T(align - 1));
+}
+
+template<UnsignedBits T>
+constexpr T AlignDown(T value, T align)
+{
+    return T(value & ~T(align - 1));
+}
+
+template<UnsignedBits T>
+constexpr bool IsAligned(T value, T align)
+{
+    return (value & (align - 1)) == 0;
+}
+
+// For pointers: the first address at or after 'p' that is a multiple of 'align'
+template<typename T>
+inline T* AlignUp(T* p, size_t align)
+{
+    return reinterpret_cast<T*>(AlignUp(reinterpret_cast<uintptr_t>(p), uintptr_t(align)));
+}
+
+/*
+	PEXT: the bits of 'x' selected by 'mask', packed into the low bits.
+		ExtractBits(0b1011'0110, 0b1111'0000) == 0b1011
+	PDEP: the low bits of 'x' spread out to the positions set in 'mask'.
+		DepositBits(0b1011, 0b1111'0000) == 0b1011'0000
+*/
+template<UnsignedBits T>
+constexpr T ExtractBitsSoftware(T x, T mask)
+{
+    T result = 0;
+    for (T bit = 1; mask; bit <<= 1)
+    {
+        if (x & LowestBit(mask))
+			result |= bit;
+        mask = ClearLowestBit(mask);
+    }
+    return result;
+}
+
+template<UnsignedBits T>
+constexpr T DepositBitsSoftware(T x, T mask)
+{
+    T result = 0;
+    for (T bit = 1; mask; bit <<= 1)
+    {
+        if (x & bit)
+			result |= LowestBit(mask);
+        mask = ClearLowestBit(mask);
+    }
+    return result;
+}
+
+template<UnsignedBits T>
+constexpr T ExtractBits(T x, T mask)
+{
+#if defined(__BMI2__)
+    if (!std::is_constant_evaluated())
+    {
+        if constexpr (sizeof(T) <= 4)
+			return T(_pext_u32(uint32_t(x), uint32_t(mask)));
+        else if constexpr (sizeof(T) == 8)
+			return T(_pext_u64(uint64_t(x), uint64_t(mask)));
+    }
+#endif
+    return ExtractBitsSoftware(x, mask);
+}
+
+template<UnsignedBits T>
+constexpr T DepositBits(T x, T mask)
+{
+#if defined(__BMI2__)
+    if (!std::is_constant_evaluated())
+    {
+        if constexpr (sizeof(T) <= 4)
+			return T(_pdep_u32(uint32_t(x), uint32_t(mask)));
+        else if constexpr (sizeof(T) == 8)
+			return T(_pdep_u64(uint64_t(x), uint64_t(mask)));
+    }
+#endif
+    return DepositBitsSoftware(x, mask);
+}
+
+/*
+	Branchless helpers: the condition becomes an all-ones / all-zeros mask,
+	so a loop over unpredictable data takes no mispredicted branches. The
+	compiler often emits cmov for the plain ternary too; these make it
+	independent of that decision and also vectorize.
+*/
+template<typename T>
+    requires std::is_integral_v<T>
+constexpr T Select(bool condition, T if_true, T if_false)
+{
+    using U = std::make_unsigned_t<T>;
+    const U mask = U(0) - U(condition);
+    return T((U(if_true) & mask) | (U(if_false) & ~mask));
+}
+
+template<typename T>
+    requires std::is_integral_v<T>
+constexpr T BranchlessMin(T a, T b)
+{
+    using U = std::make_unsigned_t<T>;
+    return T(U(b) ^ ((U(a) ^ U(b)) & (U(0) - U(a < b))));
+}
+
+template<typename T>
+    requires std::is_integral_v<T>
+constexpr T BranchlessMax(T a, T b)
+{
+    using U = std::make_unsigned_t<T>;
+    return T(U(a) ^ ((U(a) ^ U(b)) & (U(0) - U(a < b))));
+}
+
+// |x|, wrapping like the hardware for the most negative value
+template<typename T>
+    requires std::is_integral_v<T> && std::is_signed_v<T>
+constexpr T BranchlessAbs(T x)
+{
+    using U = std::make_unsigned_t<T>;
+    const U mask = U(0) - U(x < 0);
+    return T((U(x) ^ mask) - mask);
+}
+
+/*
+	BitSet<N>: N bits in 64 bit words, e.g. the free slots of a pool or the
+	occupied buckets of a table.
+
+	FindFirst / FindNext / FindFirstClear skip empty (or full) words 4 at a
+	time: a 32 byte vector of words is xor-ed with the word to skip and its
+	lanes or-ed together, one test per 256 bits, then one count of trailing
+	zeros finishes inside the word. A sparse set of a million bits is
+	scanned at memory speed instead of bit by bit.
+	In constant evaluation the same functions loop over words.
+*/
+template<size_t N>
+class BitSet
+{
+    static constexpr size_t s_WordBits = 64;
+    static constexpr size_t s_Words = (N + s_WordBits - 1) / s_WordBits;
+    static constexpr size_t s_Stride = 4; // Words per vector test
+
+    typedef uint64_t t_Block __attribute__((vector_size(s_Stride * sizeof(uint64_t)), aligned(alignof(uint64_t)), may_alias));
+
+    alignas(32) uint64_t m_Words[s_Words ? s_Words : 1] = {};
+
+    // Bits past N in the last word, which must stay clear
+    static constexpr uint64_t LastWordMask()
+    {
+        return N % s_WordBits ? (uint64_t(1) << (N % s_WordBits)) - 1 : ~uint64_t(0);
+    }
+
+    // First word at or after 'word' that isn't 'skip' (0: empty words, ~0: full words)
+    constexpr size_t NextWord(size_t word, uint64_t skip) const
+    {
+        if (!std::is_constant_evaluated())
+        {
+            const t_Block skipped = t_Block{} + skip;
+            for (; word + s_Stride <= s_Words; word += s_Stride)
+            {
+                t_Block differs = *reinterpret_cast<const t_Block*>(m_Words + word) ^ skipped;
+                uint64_t any = 0;
+                for (size_t i = 0; i < s_Stride; ++i)
+					any |= differs[i];
+                if (any)
+					break;
+            }
+        }
+        for (; word < s_Words && m_Words[word] == skip; ++word)
+        {
+        }
+        return word;
+    }
+
+public:
+    static constexpr size_t s_Size = N;
+
+    constexpr size_t size() const { return N; }
+
+    constexpr bool Test(size_t i) const { return (m_Words[i / s_WordBits] >> (i % s_WordBits)) & 1; }
+    constexpr void Set(size_t i) { m_Words[i / s_WordBits] |= uint64_t(1) << (i % s_WordBits); }
+    constexpr void Reset(size_t i) { m_Words[i / s_WordBits] &= ~(uint64_t(1) << (i % s_WordBits)); }
+    constexpr void Flip(size_t i) { m_Words[i / s_WordBits] ^= uint64_t(1) << (i % s_WordBits); }
+
+    constexpr void Assign(size_t i, bool value)
+    {
+        uint64_t& word = m_Words[i / s_WordBits];
+        const uint64_t bit = uint64_t(1) << (i % s_WordBits);
+        word = (word & ~bit) | ((uint64_t(0) - uint64_t(value)) & bit);
+    }
+
+    constexpr void SetAll()
+    {
+        for (size_t w = 0; w < s_Words; ++w)
+			m_Words[w] = ~uint64_t(0);
+        if constexpr (s_Words != 0)
+			m_Words[s_Words - 1] = LastWordMask();
+    }
+
+    constexpr void ResetAll()
+    {
+        for (size_t w = 0; w < s_Words; ++w)
+			m_Words[w] = 0;
+    }
+
+    constexpr size_t Count() const
+    {
+        size_t count = 0;
+        for (size_t w = 0; w < s_Words; ++w)
+			count += size_t(std::popcount(m_Words[w]));
+        return count;
+    }
+
+    constexpr bool Any() const { return NextWord(0, 0) < s_Words; }
+    constexpr bool None() const { return !Any(); }
+
+    // Index of the first set bit, N if there is none
+    constexpr size_t FindFirst() const { return FindNext(0); }
+
+    // First set bit at or after 'from', N if there is none
+    constexpr size_t FindNext(size_t from) const
+    {
+        if (from >= N)
+			return N;
+        size_t word = from / s_WordBits;
+        uint64_t bits = m_Words[word] & (~uint64_t(0) << (from % s_WordBits));
+        if (!bits)
+        {
+            word = NextWord(word + 1, 0);
+            if (word == s_Words)
+				return N;
+            bits = m_Words[word];
+        }
+        return word * s_WordBits + size_t(std::countr_zero(bits));
+    }
+
+    // Index of the first clear bit, N if every bit is set
+    constexpr size_t FindFirstClear() const
+    {
+        size_t word = NextWord(0, ~uint64_t(0));
+        if (word == s_Words)
+			return N;
+        size_t index = word * s_WordBits + size_t(std::countr_one(m_Words[word]));
+        return index < N ? index : N;
+    }
+
+    // f(index) for every set bit, in order
+    template<typename Function>
+    constexpr void ForEach(Function&& f) const
+    {
+        for (size_t w = 0; w < s_Words; ++w)
+        {
+            for (uint64_t bits = m_Words[w]; bits; bits &= bits - 1)
+				f(w * s_WordBits + size_t(std::countr_zero(bits)));
+        }
+    }
+
+    constexpr const uint64_t* Words() const { return m_Words; }
+};
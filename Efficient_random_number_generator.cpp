@@ -1,20 +1,142 @@
 // Accurate and efficient random number generator
 #include <iostream>
+#include <mutex>
 #include <random>
+#include <thread>
 #include <time.h>
+#include <vector>
+#include "Benchmark.h"
+#include "Fast_random.h"
 using namespace std;
 
-// Seed generator once like srand(time(0))
-mt19937 rng(time(0)); 
+// The classic version: one global engine seeded like srand(time(0)), a distribution per call.
+// Not safe to call from two threads at once, and the engine drags 5 KB of state around
+mt19937 rng(time(0));
 
-int RandomNumGen(int a, int z)
+int RandomNumGenMt19937(int a, int z)
 {
     uniform_int_distribution<int> dist(a, z); // Define the range
-    return dist(rng);                         
+    return dist(rng);
+}
+
+// Same contract: every thread has its own small engine and stream, the range costs one multiplication
+int RandomNumGen(int a, int z)
+{
+    return RandomInt(ThreadRandom::Local(), a, z);
 }
 
-int main()
+// Sum of 'count' raw outputs, to compare the engines alone
+template<typename Engine>
+uint64_t SumOutputs(Engine& engine, int count)
+{
+    uint64_t sum = 0;
+    for (int i = 0; i < count; i++)
+        sum += engine();
+    return sum;
+}
+
+int main(int argc, char** argv)
 {
     cout << "Random number is: " << RandomNumGen(1, 50) << endl;
+    cout << "State: mt19937 " << sizeof(mt19937) << " bytes, xoshiro256** " << sizeof(Xoshiro256StarStar)
+         << " bytes, pcg64 " << sizeof(Pcg64) << " bytes, splitmix64 " << sizeof(SplitMix64) << " bytes\n\n";
+
+    // Reseeding per call (a new engine every time) is the classic mistake this avoids
+    constexpr int COUNT = 1'000'000;
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+    bench.Run("RandomNumGen (global mt19937 + distribution)", [&]()
+    {
+        int sum = 0;
+        for (int i = 0; i < COUNT; i++)
+            sum += RandomNumGenMt19937(1, 50);
+        DoNotOptimize(sum);
+    }, COUNT);
+
+    bench.Run("RandomNumGen (thread xoshiro256** + Lemire)", [&]()
+    {
+        int sum = 0;
+        for (int i = 0; i < COUNT; i++)
+            sum += RandomNumGen(1, 50);
+        DoNotOptimize(sum);
+    }, COUNT);
+
+    bench.Run("rand() % 50 + 1", [&]()
+    {
+        int sum = 0;
+        for (int i = 0; i < COUNT; i++)
+            sum += rand() % 50 + 1;
+        DoNotOptimize(sum);
+    }, COUNT);
+
+    bench.Run("new mt19937 per call", [&]()
+    {
+        int sum = 0;
+        for (int i = 0; i < COUNT / 100; i++)
+        {
+            mt19937 fresh(i);
+            sum += uniform_int_distribution<int>(1, 50)(fresh);
+        }
+        DoNotOptimize(sum);
+    }, COUNT / 100);
+
+    // The engines on their own: 64 bit outputs
+    mt19937_64 mt64(1);
+    SplitMix64 splitmix(1);
+    Xoshiro256StarStar xoshiro(1);
+    Pcg64 pcg(1);
+    bench.Run("mt19937_64 raw", [&]() { DoNotOptimize(SumOutputs(mt64, COUNT)); }, COUNT);
+    bench.Run("splitmix64 raw", [&]() { DoNotOptimize(SumOutputs(splitmix, COUNT)); }, COUNT);
+    bench.Run("xoshiro256** raw", [&]() { DoNotOptimize(SumOutputs(xoshiro, COUNT)); }, COUNT);
+    bench.Run("pcg64 raw", [&]() { DoNotOptimize(SumOutputs(pcg, COUNT)); }, COUNT);
+
+    // The range mapping on its own, same engine
+    bench.Run("xoshiro256** + uniform_int_distribution", [&]()
+    {
+        uniform_int_distribution<int> dist(1, 50);
+        int sum = 0;
+        for (int i = 0; i < COUNT; i++)
+            sum += dist(xoshiro);
+        DoNotOptimize(sum);
+    }, COUNT);
+
+    bench.Run("xoshiro256** + RandomInt (Lemire)", [&]()
+    {
+        int sum = 0;
+        for (int i = 0; i < COUNT; i++)
+            sum += RandomInt(xoshiro, 1, 50);
+        DoNotOptimize(sum);
+    }, COUNT);
+
+    // From several threads the global engine needs a lock to be correct at all
+    constexpr int THREADS = 4;
+    mutex rng_lock;
+    auto in_threads = [&](auto&& draw)
+    {
+        vector<thread> threads;
+        for (int t = 0; t < THREADS; t++)
+        {
+            threads.emplace_back([&]()
+            {
+                int sum = 0;
+                for (int i = 0; i < COUNT; i++)
+                    sum += draw();
+                DoNotOptimize(sum);
+            });
+        }
+        for (thread& worker : threads)
+            worker.join();
+    };
+    bench.Run("4 threads: global mt19937 + mutex", [&]()
+    {
+        in_threads([&]()
+        {
+            lock_guard<mutex> guard(rng_lock);
+            return RandomNumGenMt19937(1, 50);
+        });
+    }, THREADS * COUNT);
+
+    bench.Run("4 threads: ThreadRandom", [&]() { in_threads([]() { return RandomNumGen(1, 50); }); }, THREADS * COUNT);
+
+    bench.Report();
     return 0;
 }
@@ -1,109 +1,125 @@
 // Custom allocator which is faster then new and delete
 #include <iostream>
-#include <chrono>
 #include <array>
+#include <string>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include "Allocation_workloads.h"
+#include "Benchmark.h"
+#include "Memory_pool.h"
+#include "Size_class_allocator.h"
 
-template<typename T>
-class MemoryPool
+// Allocation testing
+class AllocatorTester
 {
-    struct t_FreeBlock
-    {
-        t_FreeBlock* next;
-    };
-
-    char* m_Pool;
-    t_FreeBlock* m_FreeList;
+    Benchmark& m_Bench;
     size_t m_BlockCount;
 
 public:
-    MemoryPool(const size_t block_count)
-        : m_Pool(new char[sizeof(T) * block_count]),
-          m_FreeList(nullptr),
-          m_BlockCount(block_count)
-    {
-        /* 
-			Build the free list, aka the linked list of free blocks
-           	The reason why we need to build this linked list is because
-           	we don't know which blocks are free and which are not.
-           	By building the linked list, we can easily traverse it
-           	and find the next free block when we want to allocate memory
-		*/
-
-        m_FreeList = reinterpret_cast<t_FreeBlock*>(m_Pool);
-        t_FreeBlock* block = m_FreeList;
-        for (size_t i = 1; i < m_BlockCount; ++i)
-        {
-            block->next = reinterpret_cast<t_FreeBlock*>(m_Pool + i * sizeof(T));
-            block = block->next;
-        }
-        block->next = nullptr;
-    }
+    AllocatorTester(Benchmark& bench, const size_t block_count) : m_Bench(bench), m_BlockCount(block_count) {}
 
-    ~MemoryPool()
+	// Note: I used lambda function for simplicity
+	template<typename T>	
+    const BenchmarkResult& TestStdNewDelete(const std::string& name)
     {
-        delete[] m_Pool;
-    }
+        return m_Bench.Run(name, [&]()
+        {
+            std::vector<T*> ptrs;
+            ptrs.reserve(m_BlockCount);
 
-    // Allocate a block of type T
-    T* Allocate()
-    {
-        if (!m_FreeList)
-		{
-			throw std::bad_alloc();	
-		}
+            for (size_t i = 0; i < m_BlockCount; i++)
+			{
+				ptrs.push_back(new T);
+				DoNotOptimize(ptrs.back());
+			}
 
-        t_FreeBlock* block = m_FreeList;
-        m_FreeList = m_FreeList->next;
-        return reinterpret_cast<T*>(block);
+            for (auto p : ptrs)
+			{
+				delete p;
+			}
+        }, m_BlockCount);
     }
 
-    // Deallocate a block of type T
-    void Deallocate(T* p)
+    template<typename T, typename Layout>
+    const BenchmarkResult& TestMemoryPool(const std::string& name, MemoryPool<T, Layout>& pool)
     {
-        t_FreeBlock* block = reinterpret_cast<t_FreeBlock*>(p);
-        block->next = m_FreeList;
-        m_FreeList = block;
-    }
-};
+        return m_Bench.Run(name, [&]()
+        {
+            std::vector<T*> ptrs;
+            ptrs.reserve(m_BlockCount);
 
-// Benchmark Utility
-class Benchmark
-{
-public:
-    using Clock = std::chrono::steady_clock;
+            for (size_t i = 0; i < m_BlockCount; i++)
+			{
+				ptrs.push_back(pool.Allocate());
+				DoNotOptimize(ptrs.back());
+			}
 
-	// Takes the function as args
-    template <typename Func>
-    static long long measure(Func&& func)
-    {
-        auto start = Clock::now();
-        func();
-        auto end = Clock::now();
-        return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+            for (auto p : ptrs)
+			{
+				pool.Deallocate(p);
+			}
+        }, m_BlockCount);
     }
-};
 
-// Allocation testing
-class AllocatorTester
-{
-    size_t m_BlockCount;
+    /*
+		Message loop: allocate a batch of nodes, use them, free the batch.
+		'bulk' does each batch with one AllocateBulk / DeallocateBulk call
+		instead of one call per node.
+	*/
+    template<typename T, typename Pool>
+    const BenchmarkResult& TestBatches(const std::string& name, Pool& pool, const size_t batch_size, const bool bulk)
+    {
+        return m_Bench.Run(name, [&]()
+        {
+            std::vector<T*> batch(batch_size);
 
-public:
-    AllocatorTester(const size_t block_count) : m_BlockCount(block_count) {}
+            for (size_t done = 0; done < m_BlockCount; done += batch_size)
+			{
+				if (bulk)
+				{
+					pool.AllocateBulk(batch.data(), batch_size);
+				}
+				else
+				{
+					for (auto& p : batch)
+					{
+						p = pool.Allocate();
+					}
+				}
+				DoNotOptimize(batch.data());
 
-	// Note: I used lambda function for simplicity
-	template<typename T>	
-    long long TestStdNewDelete(const size_t block_size)
+				if (bulk)
+				{
+					pool.DeallocateBulk(batch.data(), batch_size);
+				}
+				else
+				{
+					for (auto p : batch)
+					{
+						pool.Deallocate(p);
+					}
+				}
+			}
+        }, m_BlockCount);
+    }
+
+    /*
+		Multi-threaded scenarios: the same amount of work as above, split
+		evenly across 'thread_count' threads that all share one allocator.
+	*/
+    template<typename T>
+    const BenchmarkResult& TestStdNewDeleteThreaded(const std::string& name, const size_t thread_count)
     {
-        return Benchmark::measure([&]()
+        return RunThreads(name, thread_count, [&](size_t count)
         {
             std::vector<T*> ptrs;
-            ptrs.reserve(m_BlockCount);
+            ptrs.reserve(count);
 
-            for (size_t i = 0; i < m_BlockCount; i++)
+            for (size_t i = 0; i < count; i++)
 			{
 				ptrs.push_back(new T);
+				DoNotOptimize(ptrs.back());
 			}
 
             for (auto p : ptrs)
@@ -113,40 +129,201 @@ public:
         });
     }
 
+	// The "global mutex" baseline we want to get rid of
     template<typename T>
-    long long TestMemoryPool(MemoryPool<T>& pool)
+    const BenchmarkResult& TestLockedMemoryPool(const std::string& name, MemoryPool<T>& pool, std::mutex& lock, const size_t thread_count)
     {
-        return Benchmark::measure([&]()
+        return RunThreads(name, thread_count, [&](size_t count)
         {
             std::vector<T*> ptrs;
-            ptrs.reserve(m_BlockCount);
+            ptrs.reserve(count);
 
-            for (size_t i = 0; i < m_BlockCount; i++)
+            for (size_t i = 0; i < count; i++)
 			{
+				std::lock_guard<std::mutex> guard(lock);
 				ptrs.push_back(pool.Allocate());
+				DoNotOptimize(ptrs.back());
 			}
 
             for (auto p : ptrs)
 			{
+				std::lock_guard<std::mutex> guard(lock);
 				pool.Deallocate(p);
 			}
         });
     }
+
+    template<typename T, typename Layout>
+    const BenchmarkResult& TestConcurrentMemoryPool(const std::string& name, ConcurrentMemoryPool<T, Layout>& pool, const size_t thread_count)
+    {
+        return RunThreads(name, thread_count, [&](size_t count)
+        {
+            typename ConcurrentMemoryPool<T, Layout>::ThreadCache cache(pool);
+            std::vector<T*> ptrs;
+            ptrs.reserve(count);
+
+            for (size_t i = 0; i < count; i++)
+			{
+				ptrs.push_back(cache.Allocate());
+				DoNotOptimize(ptrs.back());
+			}
+
+            for (auto p : ptrs)
+			{
+				cache.Deallocate(p);
+			}
+        });
+    }
+
+    /*
+		Every pattern from AllocationWorkloads the target supports: mixed sizes
+		need a target that takes any size, producer / consumer a thread safe one.
+	*/
+    template<typename Target>
+    void TestWorkloads(const std::string& name, Target& target, const AllocationWorkloads& workloads)
+    {
+        const WorkloadConfig& config = workloads.Config();
+
+        m_Bench.Run(name + ": random order free", [&]() { workloads.RandomOrderFree(target); }, config.liveBlocks);
+        m_Bench.Run(name + ": sliding window", [&]() { workloads.SlidingWindow(target); }, config.operations);
+        m_Bench.Run(name + ": steady state churn", [&]() { workloads.SteadyStateChurn(target); },
+                    config.liveBlocks + config.operations);
+
+        if constexpr (Target::s_MaxSize == 0)
+        {
+            m_Bench.Run(name + ": mixed sizes", [&]() { workloads.MixedSizes(target); }, config.liveBlocks);
+        }
+        if constexpr (Target::s_ThreadSafe)
+        {
+            m_Bench.Run(name + ": producer/consumer", [&]() { workloads.ProducerConsumer(target); }, config.operations);
+        }
+    }
+
+private:
+	// Runs 'func(blocks_for_this_thread)' on every thread and times the whole batch
+    template<typename Func>
+    const BenchmarkResult& RunThreads(const std::string& name, const size_t thread_count, Func&& func)
+    {
+        return m_Bench.Run(name, [&]()
+        {
+            std::vector<std::thread> threads;
+            threads.reserve(thread_count);
+
+            for (size_t t = 0; t < thread_count; t++)
+			{
+				size_t count = m_BlockCount / thread_count + (t < m_BlockCount % thread_count ? 1 : 0);
+				threads.emplace_back(func, count);
+			}
+
+            for (auto& thread : threads)
+			{
+				thread.join();
+			}
+        }, m_BlockCount);
+    }
 };
 
-int main()
+int main(int argc, char** argv)
 {
     constexpr size_t BLOCK_COUNT = 1'000'000;
     constexpr size_t BLOCK_SIZE = 64;
 	using Block = std::array<char, BLOCK_SIZE>;
+
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+    AllocatorTester tester(bench, BLOCK_COUNT);
+
+    // Construction is O(1), blocks (and their pages) are carved out on first use
+    bench.Run("pool construction", [&]()
+    {
+        MemoryPool<Block> cold_pool(BLOCK_COUNT);
+        DoNotOptimize(cold_pool);
+    });
+
     MemoryPool<Block> pool(BLOCK_COUNT);
-	
-    AllocatorTester tester(BLOCK_COUNT);
-    auto std_time = tester.TestStdNewDelete<Block>(BLOCK_SIZE);
-    auto pool_time = tester.TestMemoryPool(pool);
+    tester.TestMemoryPool("custom allocator", pool);
+    tester.TestStdNewDelete<Block>("new/delete");
+
+    // Batches of 1024 nodes, one call per node against one call per batch
+    constexpr size_t BATCH_SIZE = 1024;
+    tester.TestBatches<Block>("pool, batches one by one", pool, BATCH_SIZE, false);
+    tester.TestBatches<Block>("pool, AllocateBulk", pool, BATCH_SIZE, true);
+
+    // Start small and let the pool chain new slabs while the burst runs
+    MemoryPool<Block> growing_pool(BLOCK_COUNT / 64, PoolGrowth::Geometric);
+    tester.TestMemoryPool("growable pool", growing_pool);
+    size_t slabs = growing_pool.SlabCount();
+    size_t released = growing_pool.ShrinkToFit();
+
+    // Scaling from 1 to N cores with one shared allocator
+    constexpr uint32_t MAGAZINE_SIZE = 64;
+    const size_t max_threads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+
+    // Every thread cache may park up to two magazines, so leave room for them
+    MemoryPool<Block> locked_pool(BLOCK_COUNT);
+    std::mutex locked_pool_mutex;
+    ConcurrentMemoryPool<Block> shared_pool(BLOCK_COUNT + max_threads * 2 * MAGAZINE_SIZE, MAGAZINE_SIZE);
+
+    {
+        ConcurrentMemoryPool<Block>::ThreadCache cache(shared_pool);
+        tester.TestBatches<Block>("thread cache, batches one by one", cache, BATCH_SIZE, false);
+        tester.TestBatches<Block>("thread cache, AllocateBulk", cache, BATCH_SIZE, true);
+    }
+
+    for (size_t threads = 1; threads <= max_threads;
+         threads = (threads < max_threads && threads * 2 > max_threads) ? max_threads : threads * 2)
+    {
+        std::string suffix = " x" + std::to_string(threads) + " threads";
+        tester.TestStdNewDeleteThreaded<Block>("new/delete" + suffix, threads);
+        tester.TestLockedMemoryPool("mutex + pool" + suffix, locked_pool, locked_pool_mutex, threads);
+        tester.TestConcurrentMemoryPool("concurrent pool" + suffix, shared_pool, threads);
+    }
+
+    bench.Report();
+    std::cout << "\nGrowable pool used " << slabs << " slabs, ShrinkToFit released " << released << " blocks, "
+              << growing_pool.BlockCount() << " blocks left\n\n";
+
+    // Realistic patterns, with how much each one grows the process (memory the allocator keeps)
+    BenchmarkOptions workload_defaults;
+    workload_defaults.peakMemory = true;
+    Benchmark workload_bench(BenchmarkOptions::FromArgs(argc, argv, workload_defaults));
+    AllocatorTester workload_tester(workload_bench, BLOCK_COUNT);
+
+    WorkloadConfig config;
+    config.blockSize = BLOCK_SIZE;
+    config.producerThreads = std::max<size_t>(1, max_threads / 2);
+    AllocationWorkloads workloads(config);
+
+    // Every allocator starts empty; new/delete and malloc go first, before glibc has cached anything
+    {
+        NewDeleteTarget target;
+        workload_tester.TestWorkloads("new/delete", target, workloads);
+    }
+    {
+        MallocTarget target;
+        workload_tester.TestWorkloads("malloc", target, workloads);
+    }
+    {
+        MemoryPool<Block> workload_pool(config.liveBlocks, PoolGrowth::Geometric);
+        PoolTarget<Block> target(workload_pool);
+        workload_tester.TestWorkloads("pool", target, workloads);
+    }
+    {
+        MemoryPool<Block> workload_pool(config.liveBlocks, PoolGrowth::Geometric);
+        LockedPoolTarget<Block> target(workload_pool);
+        workload_tester.TestWorkloads("mutex + pool", target, workloads);
+    }
+    {
+        ConcurrentMemoryPool<Block> workload_pool(config.liveBlocks + max_threads * 2 * MAGAZINE_SIZE, MAGAZINE_SIZE);
+        ConcurrentPoolTarget<Block> target(workload_pool);
+        workload_tester.TestWorkloads("concurrent pool", target, workloads);
+    }
+    {
+        SizeClassAllocator size_classes(config.liveBlocks / 16);
+        SizeClassTarget target(size_classes);
+        workload_tester.TestWorkloads("size classes", target, workloads);
+    }
 
-    std::cout << "Time (custom allocator): " << pool_time << " ms\n";
-    std::cout << "Time (new/delete):       " << std_time << " ms\n";
+    workload_bench.Report();
 
     return 0;
 }
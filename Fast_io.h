@@ -0,0 +1,522 @@
+// Fast input and output without iostreams: big read(2) buffers or mmap, hand-written parsers, chunked writes
+#pragma once
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include "Auto_array.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+	FastInput reads whitespace separated tokens from a file descriptor or a
+	file. It never formats through a locale and never copies a token:
+
+	- InputMode::Read fills a large buffer (1 MiB) with read(2), one system
+	  call per megabyte instead of per line
+	- InputMode::Map maps a regular file and parses it in place; pipes and
+	  terminals fall back to Read
+	- integers are parsed by hand (one multiply-add per digit, overflow
+	  checked), floating point numbers with std::from_chars
+
+	Any byte <= ' ' separates tokens (spaces, tabs, newlines, '\r').
+
+		FastInput in;                      // stdin
+		int64_t n;
+		while (in.Read(n))
+			sum += n;
+
+	FastOutput collects text in a 1 MiB buffer and hands it to write(2) in
+	one piece when it is full, on Flush() and on destruction. Integers are
+	formatted with std::to_chars straight into the buffer.
+
+		FastOutput out;                    // stdout
+		out << n << '\n';
+
+	I/O errors throw std::system_error, like a failed open.
+*/
+enum class InputMode
+{
+    Read,
+    Map
+};
+
+class FastInput
+{
+    int m_Fd = -1;
+    bool m_OwnsFd = false;
+    AutoArray<char> m_Buffer; // Read mode; only its capacity is used
+    char* m_Mapped = nullptr; // Map mode
+    size_t m_MappedBytes = 0;
+    const char* m_Pos = nullptr;
+    const char* m_End = nullptr;
+    bool m_Exhausted = false; // Nothing left behind m_End
+
+    static bool IsSpace(char c) { return static_cast<unsigned char>(c) <= ' '; }
+
+    [[noreturn]] static void Fail(const char* what)
+    {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    void Map()
+    {
+        struct stat info;
+        if (fstat(m_Fd, &info) != 0 || !S_ISREG(info.st_mode))
+        {
+            return;
+        }
+
+        m_MappedBytes = size_t(info.st_size);
+        if (m_MappedBytes)
+        {
+            void* p = mmap(nullptr, m_MappedBytes, PROT_READ, MAP_PRIVATE, m_Fd, 0);
+            if (p == MAP_FAILED)
+            {
+                m_MappedBytes = 0;
+                return;
+            }
+            madvise(p, m_MappedBytes, MADV_SEQUENTIAL);
+            m_Mapped = static_cast<char*>(p);
+        }
+        m_Pos = m_Mapped;
+        m_End = m_Mapped + m_MappedBytes;
+        m_Exhausted = true;
+    }
+
+    // Keep the unread bytes, move them to the front and read behind them; false if nothing came
+    bool Refill()
+    {
+        if (m_Exhausted)
+        {
+            return false;
+        }
+
+        size_t kept = size_t(m_End - m_Pos);
+        if (kept == m_Buffer.capacity())
+        {
+            // One token fills the whole buffer
+            AutoArray<char> bigger;
+            bigger.reserve(m_Buffer.capacity() * 2);
+            std::memcpy(bigger.data(), m_Pos, kept);
+            m_Buffer = std::move(bigger);
+        }
+        else if (kept)
+        {
+            std::memmove(m_Buffer.data(), m_Pos, kept);
+        }
+        m_Pos = m_Buffer.data();
+        m_End = m_Buffer.data() + kept;
+
+        for (;;)
+        {
+            ssize_t got = ::read(m_Fd, m_Buffer.data() + kept, m_Buffer.capacity() - kept);
+            if (got > 0)
+            {
+                m_End += got;
+                return true;
+            }
+            if (got == 0)
+            {
+                m_Exhausted = true;
+                return false;
+            }
+            if (errno != EINTR)
+            {
+                Fail("FastInput: read");
+            }
+        }
+    }
+
+    void SkipSpace()
+    {
+        for (;;)
+        {
+            while (m_Pos != m_End && IsSpace(*m_Pos))
+				++m_Pos;
+            if (m_Pos != m_End || !Refill())
+            {
+                return;
+            }
+        }
+    }
+
+    // The next token, whole in the window; empty at the end of the input
+    std::string_view NextToken()
+    {
+        SkipSpace();
+        size_t length = 0;
+        for (;;)
+        {
+            const char* p = m_Pos + length;
+            while (p != m_End && !IsSpace(*p))
+				++p;
+            length = size_t(p - m_Pos);
+            if (p != m_End || !Refill())
+            {
+                break;
+            }
+        }
+
+        std::string_view token(m_Pos, length);
+        m_Pos += length;
+        return token;
+    }
+
+    template<typename T>
+    static bool ParseInteger(std::string_view token, T& value)
+    {
+        const char* p = token.data();
+        const char* end = p + token.size();
+        bool negative = false;
+        if (p != end && (*p == '-' || *p == '+'))
+        {
+            negative = *p == '-';
+            if (negative && !std::is_signed_v<T>)
+            {
+                return false;
+            }
+            ++p;
+        }
+        if (p == end)
+        {
+            return false;
+        }
+
+        // Signed values accumulate as negative numbers: there is room for the most negative one
+        T result = 0;
+        for (; p != end; ++p)
+        {
+            unsigned digit = unsigned(*p) - '0';
+            if (digit > 9)
+            {
+                return false;
+            }
+            if constexpr (std::is_signed_v<T>)
+            {
+                if (__builtin_mul_overflow(result, 10, &result) || __builtin_sub_overflow(result, T(digit), &result))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                if (__builtin_mul_overflow(result, 10, &result) || __builtin_add_overflow(result, T(digit), &result))
+                {
+                    return false;
+                }
+            }
+        }
+
+        if constexpr (std::is_signed_v<T>)
+        {
+            if (!negative)
+            {
+                if (result == std::numeric_limits<T>::min())
+                {
+                    return false;
+                }
+                result = -result;
+            }
+        }
+        value = result;
+        return true;
+    }
+
+    /*
+		Common case in one pass: the token ends inside the window and has too
+		few digits to overflow. Anything else is left for NextToken() and
+		ParseInteger(), the position only moves on success.
+	*/
+    template<typename T>
+    bool ReadShortInteger(T& value)
+    {
+        SkipSpace();
+        const char* p = m_Pos;
+        bool negative = std::is_signed_v<T> && p != m_End && *p == '-';
+        p += negative;
+
+        const char* digits = p;
+        std::make_unsigned_t<T> magnitude = 0;
+        for (unsigned digit; p != m_End && (digit = unsigned(*p) - '0') <= 9; ++p)
+			magnitude = magnitude * 10 + digit;
+
+        size_t count = size_t(p - digits);
+        if (p == m_End || !IsSpace(*p) || count == 0 || count > size_t(std::numeric_limits<T>::digits10))
+        {
+            return false;
+        }
+        value = negative ? T(0 - magnitude) : T(magnitude);
+        m_Pos = p;
+        return true;
+    }
+
+    template<typename T>
+    static bool ParseFloat(std::string_view token, T& value)
+    {
+        const char* begin = token.data();
+        if (!token.empty() && *begin == '+')
+        {
+            ++begin; // from_chars doesn't take a leading '+'
+            // One sign only, as for integers: "+-5" and "++5" are not numbers
+            if (begin != token.data() + token.size() && (*begin == '-' || *begin == '+'))
+            {
+                return false;
+            }
+        }
+#if defined(__cpp_lib_to_chars)
+        auto [end, error] = std::from_chars(begin, token.data() + token.size(), value);
+        return error == std::errc() && end == token.data() + token.size();
+#else
+        char copy[128];
+        size_t length = size_t(token.data() + token.size() - begin);
+        if (length >= sizeof(copy))
+        {
+            return false;
+        }
+        std::memcpy(copy, begin, length);
+        copy[length] = '\0';
+        char* end = nullptr;
+        value = T(std::strtold(copy, &end));
+        return end == copy + length && length;
+#endif
+    }
+
+public:
+    static constexpr size_t s_BufferSize = size_t(1) << 20;
+    static constexpr size_t s_MinBufferSize = 4096;
+
+    // Reads from an open descriptor (does not close it)
+    explicit FastInput(int fd = STDIN_FILENO, size_t buffer_size = s_BufferSize) : m_Fd(fd)
+    {
+        m_Buffer.reserve(buffer_size > s_MinBufferSize ? buffer_size : s_MinBufferSize);
+    }
+
+    explicit FastInput(const char* path, InputMode mode = InputMode::Map, size_t buffer_size = s_BufferSize)
+        : m_Fd(::open(path, O_RDONLY | O_CLOEXEC)), m_OwnsFd(true)
+    {
+        if (m_Fd < 0)
+        {
+            Fail(path);
+        }
+        if (mode == InputMode::Map)
+        {
+            Map();
+        }
+        if (!m_Mapped && !m_Exhausted)
+        {
+            m_Buffer.reserve(buffer_size > s_MinBufferSize ? buffer_size : s_MinBufferSize);
+        }
+    }
+
+    ~FastInput()
+    {
+        if (m_Mapped)
+        {
+            munmap(m_Mapped, m_MappedBytes);
+        }
+        if (m_OwnsFd)
+        {
+            ::close(m_Fd);
+        }
+    }
+
+    FastInput(const FastInput&) = delete;
+    FastInput& operator=(const FastInput&) = delete;
+
+    bool Mapped() const { return m_Mapped != nullptr; }
+
+    // Next token as an integer or floating point number; false at the end or if it isn't one (it is skipped)
+    template<typename T>
+    bool Read(T& value)
+    {
+        static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "FastInput: numbers only");
+        if constexpr (std::is_integral_v<T>)
+        {
+            if (ReadShortInteger(value))
+            {
+                return true;
+            }
+        }
+
+        std::string_view token = NextToken();
+        if (token.empty())
+        {
+            return false;
+        }
+        if constexpr (std::is_integral_v<T>)
+        {
+            return ParseInteger(token, value);
+        }
+        else
+        {
+            return ParseFloat(token, value);
+        }
+    }
+
+    // Next token; the view stays valid until the next call. False at the end of the input.
+    bool Read(std::string_view& token)
+    {
+        token = NextToken();
+        return !token.empty();
+    }
+
+    /*
+		Raw access for bulk parsers: the bytes read but not yet consumed.
+		Fetch() tops the window up when fewer than 'wanted' bytes remain,
+		and returns false once the input has nothing more to give.
+	*/
+    std::string_view Window() const { return { m_Pos, size_t(m_End - m_Pos) }; }
+
+    bool Fetch(size_t wanted)
+    {
+        return size_t(m_End - m_Pos) >= wanted || Refill();
+    }
+
+    void Consume(size_t bytes) { m_Pos += bytes; }
+
+    bool AtEnd() const { return m_Pos == m_End && m_Exhausted; }
+};
+
+class FastOutput
+{
+    int m_Fd;
+    bool m_OwnsFd = false;
+    AutoArray<char> m_Buffer; // Only its capacity is used
+    size_t m_Used = 0;
+
+    static constexpr size_t s_MaxNumberChars = 64; // Any integer or shortest-form double
+
+    [[noreturn]] static void Fail(const char* what)
+    {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    void WriteAll(const char* data, size_t bytes)
+    {
+        while (bytes)
+        {
+            ssize_t done = ::write(m_Fd, data, bytes);
+            if (done < 0)
+            {
+                if (errno == EINTR)
+				{
+					continue;
+				}
+                Fail("FastOutput: write");
+            }
+            data += done;
+            bytes -= size_t(done);
+        }
+    }
+
+    char* Room(size_t bytes)
+    {
+        if (m_Used + bytes > m_Buffer.capacity())
+        {
+            Flush();
+        }
+        return m_Buffer.data() + m_Used;
+    }
+
+public:
+    static constexpr size_t s_BufferSize = size_t(1) << 20;
+
+    // Writes to an open descriptor (does not close it)
+    explicit FastOutput(int fd = STDOUT_FILENO, size_t buffer_size = s_BufferSize) : m_Fd(fd)
+    {
+        m_Buffer.reserve(buffer_size > s_MaxNumberChars ? buffer_size : s_MaxNumberChars);
+    }
+
+    // Creates or truncates 'path'
+    explicit FastOutput(const char* path, size_t buffer_size = s_BufferSize)
+        : FastOutput(::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644), buffer_size)
+    {
+        if (m_Fd < 0)
+        {
+            Fail(path);
+        }
+        m_OwnsFd = true;
+    }
+
+    // Errors while flushing here can't be reported, call Flush() first to see them
+    ~FastOutput()
+    {
+        try
+        {
+            Flush();
+        }
+        catch (const std::system_error&)
+        {
+        }
+        if (m_OwnsFd)
+        {
+            ::close(m_Fd);
+        }
+    }
+
+    FastOutput(const FastOutput&) = delete;
+    FastOutput& operator=(const FastOutput&) = delete;
+
+    void Flush()
+    {
+        size_t used = std::exchange(m_Used, 0);
+        WriteAll(m_Buffer.data(), used);
+    }
+
+    void Write(char c)
+    {
+        *Room(1) = c;
+        ++m_Used;
+    }
+
+    void Write(std::string_view text)
+    {
+        if (text.size() > m_Buffer.capacity() - m_Used)
+        {
+            Flush();
+            if (text.size() >= m_Buffer.capacity())
+            {
+                WriteAll(text.data(), text.size()); // Too big to be worth copying
+                return;
+            }
+        }
+        std::memcpy(m_Buffer.data() + m_Used, text.data(), text.size());
+        m_Used += text.size();
+    }
+
+    void Write(const char* text) { Write(std::string_view(text)); }
+
+    template<typename T>
+    requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>) && (!std::is_same_v<T, char>)
+    void Write(T value)
+    {
+        char* begin = Room(s_MaxNumberChars);
+#if !defined(__cpp_lib_to_chars)
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            m_Used += size_t(std::snprintf(begin, s_MaxNumberChars, "%.17g", double(value)));
+            return;
+        }
+#endif
+        m_Used += size_t(std::to_chars(begin, begin + s_MaxNumberChars, value).ptr - begin);
+    }
+
+    template<typename T>
+    FastOutput& operator<<(const T& value)
+    {
+        Write(value);
+        return *this;
+    }
+};
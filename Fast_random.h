@@ -0,0 +1,271 @@
+// Small, fast random number engines, per-thread streams and unbiased bounded integers without a distribution object
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+/*
+	Engines
+
+	SplitMix64          8 bytes of state, one add and a few multiply/xor
+	                    steps per number. Used to expand one 64 bit seed
+	                    into the state of the others.
+	Xoshiro256StarStar  32 bytes, period 2^256 - 1, the general purpose
+	                    default. Jump() moves 2^128 numbers ahead, so one
+	                    seed gives 2^128 non-overlapping streams.
+	Pcg64               32 bytes (128 bit LCG and increment), period 2^128
+	                    per stream, 2^127 selectable streams, Advance(n)
+	                    skips n numbers in O(log n).
+
+	All of them are UniformRandomBitGenerators, so they also work with
+	std::shuffle and the <random> distributions. std::mt19937 by comparison
+	carries 5 KB of state, which is more than a cache line per table the
+	program touches around it.
+
+	Bounded integers
+
+	RandomBelow(engine, n) uses Lemire's multiply-shift method: the 128 bit
+	product of a random 64 bit number and n holds the result in its upper
+	half, and only when the lower half falls in a sliver of size 2^64 mod n
+	is a number rejected. The division that computes that sliver is only
+	reached in that case, so almost every call is one multiplication.
+*/
+
+class SplitMix64
+{
+    uint64_t m_State;
+
+public:
+    using result_type = uint64_t;
+
+    explicit SplitMix64(uint64_t seed = 0) : m_State(seed) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+
+    result_type operator()()
+    {
+        uint64_t z = (m_State += 0x9E3779B97F4A7C15);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+        return z ^ (z >> 31);
+    }
+};
+
+class Xoshiro256StarStar
+{
+    uint64_t m_State[4];
+
+    static uint64_t Rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    // State after 'polynomial' steps, computed from the characteristic polynomial of the generator
+    void JumpBy(const uint64_t (&polynomial)[4])
+    {
+        uint64_t state[4] = { 0, 0, 0, 0 };
+        for (uint64_t word : polynomial)
+        {
+            for (int bit = 0; bit < 64; ++bit)
+            {
+                if (word & (uint64_t(1) << bit))
+                {
+                    for (int i = 0; i < 4; ++i)
+						state[i] ^= m_State[i];
+                }
+                (*this)();
+            }
+        }
+        for (int i = 0; i < 4; ++i)
+			m_State[i] = state[i];
+    }
+
+public:
+    using result_type = uint64_t;
+
+    // The state comes from SplitMix64, so similar seeds still give unrelated streams (and never all zeros)
+    explicit Xoshiro256StarStar(uint64_t seed = 0)
+    {
+        SplitMix64 seeder(seed);
+        for (uint64_t& word : m_State)
+			word = seeder();
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+
+    result_type operator()()
+    {
+        const uint64_t result = Rotl(m_State[1] * 5, 7) * 9;
+        const uint64_t t = m_State[1] << 17;
+        m_State[2] ^= m_State[0];
+        m_State[3] ^= m_State[1];
+        m_State[1] ^= m_State[2];
+        m_State[0] ^= m_State[3];
+        m_State[2] ^= t;
+        m_State[3] = Rotl(m_State[3], 45);
+        return result;
+    }
+
+    // The four state words, e.g. to run several streams side by side in SIMD lanes (Simd_random.h)
+    std::array<uint64_t, 4> State() const { return { m_State[0], m_State[1], m_State[2], m_State[3] }; }
+
+    // Skip 2^128 numbers: one stream per thread or task
+    void Jump()
+    {
+        static constexpr uint64_t s_Jump[4] = { 0x180EC6D33CFD0ABA, 0xD5A61266F0C9392C, 0xA9582618E03FC9AA,
+                                                0x39ABDC4529B1661C };
+        JumpBy(s_Jump);
+    }
+
+    // Skip 2^192 numbers: one group of 2^64 Jump() streams per process or machine
+    void LongJump()
+    {
+        static constexpr uint64_t s_LongJump[4] = { 0x76E15D3EFEFDCBBF, 0xC5004E441C522FB3, 0x77710069854EE241,
+                                                    0x39109BB02ACBE635 };
+        JumpBy(s_LongJump);
+    }
+};
+
+class Pcg64
+{
+    using t_Uint128 = unsigned __int128;
+
+    static constexpr t_Uint128 s_Multiplier = (t_Uint128(0x2360ED051FC65DA4) << 64) | 0x4385DF649FCCF645;
+
+    t_Uint128 m_State = 0;
+    t_Uint128 m_Increment; // Odd; picks the stream
+
+    void Step() { m_State = m_State * s_Multiplier + m_Increment; }
+
+public:
+    using result_type = uint64_t;
+
+    explicit Pcg64(uint64_t seed = 0, uint64_t stream = 0)
+        : m_Increment((t_Uint128(stream) << 1) | 1)
+    {
+        Step();
+        m_State += SplitMix64(seed)();
+        Step();
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+
+    // XSL RR output: fold the 128 bit state to 64 bits, rotate by its top 6 bits
+    result_type operator()()
+    {
+        Step();
+        const uint64_t folded = uint64_t(m_State >> 64) ^ uint64_t(m_State);
+        const unsigned rotation = unsigned(m_State >> 122);
+        return (folded >> rotation) | (folded << ((64 - rotation) & 63));
+    }
+
+    // Skip 'delta' numbers by squaring the LCG step, O(log delta)
+    void Advance(t_Uint128 delta)
+    {
+        t_Uint128 multiplier = 1, increment = 0;
+        t_Uint128 step_multiplier = s_Multiplier, step_increment = m_Increment;
+        for (; delta; delta >>= 1)
+        {
+            if (delta & 1)
+            {
+                multiplier *= step_multiplier;
+                increment = increment * step_multiplier + step_increment;
+            }
+            step_increment = (step_multiplier + 1) * step_increment;
+            step_multiplier *= step_multiplier;
+        }
+        m_State = m_State * multiplier + increment;
+    }
+};
+
+template<typename Engine>
+concept Random64 = Engine::min() == 0 && Engine::max() == std::numeric_limits<uint64_t>::max();
+
+// Uniform in [0, bound), bound > 0. Lemire's nearly divisionless method
+template<Random64 Engine>
+inline uint64_t RandomBelow(Engine& engine, uint64_t bound)
+{
+    unsigned __int128 product = (unsigned __int128)engine() * bound;
+    uint64_t low = uint64_t(product);
+    if (low < bound)
+    {
+        // 2^64 mod bound values of 'low' would favour some results: draw again for those
+        const uint64_t threshold = -bound % bound;
+        while (low < threshold)
+        {
+            product = (unsigned __int128)engine() * bound;
+            low = uint64_t(product);
+        }
+    }
+    return uint64_t(product >> 64);
+}
+
+// Uniform in [low, high], both included, like std::uniform_int_distribution<Int>(low, high)
+template<typename Int, Random64 Engine>
+inline Int RandomInt(Engine& engine, Int low, Int high)
+{
+    const uint64_t span = uint64_t(high) - uint64_t(low) + 1; // Wraps to 0 for the full 64 bit range
+    const uint64_t offset = span ? RandomBelow(engine, span) : engine();
+    return Int(uint64_t(low) + offset);
+}
+
+// Uniform in [0, 1): the top 53 bits, exactly representable
+template<Random64 Engine>
+inline double RandomDouble(Engine& engine)
+{
+    return double(engine() >> 11) * 0x1.0p-53;
+}
+
+/*
+	One Xoshiro256StarStar per thread, created the first time the thread
+	asks for it. Thread number k (in order of first use) gets the seed's
+	stream jumped k times, so no two threads ever produce overlapping
+	sequences and no locking is involved after that.
+
+	Seed() makes runs reproducible; call it before starting the workers.
+	Without it the seed is taken once from std::random_device. Stream(k)
+	builds stream k directly, for workers that need a fixed stream each
+	whatever order they start in.
+*/
+class ThreadRandom
+{
+    static inline std::atomic<uint64_t> s_Seed{ 0 }; // 0: not chosen yet
+    static inline std::atomic<size_t> s_NextStream{ 0 };
+
+    static uint64_t BaseSeed()
+    {
+        uint64_t seed = s_Seed.load(std::memory_order_acquire);
+        if (seed == 0)
+        {
+            std::random_device device;
+            uint64_t fresh = (uint64_t(device()) << 32) | device() | 1;
+            seed = s_Seed.compare_exchange_strong(seed, fresh, std::memory_order_acq_rel) ? fresh : seed;
+        }
+        return seed;
+    }
+
+public:
+    static void Seed(uint64_t seed)
+    {
+        s_Seed.store(seed ? seed : 1, std::memory_order_release);
+        s_NextStream.store(0, std::memory_order_relaxed);
+    }
+
+    static Xoshiro256StarStar Stream(size_t index)
+    {
+        Xoshiro256StarStar engine(BaseSeed());
+        for (size_t i = 0; i < index; ++i)
+			engine.Jump();
+        return engine;
+    }
+
+    // The calling thread's engine
+    static Xoshiro256StarStar& Local()
+    {
+        thread_local Xoshiro256StarStar engine = Stream(s_NextStream.fetch_add(1, std::memory_order_relaxed));
+        return engine;
+    }
+};
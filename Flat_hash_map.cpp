@@ -0,0 +1,155 @@
+// Insert, lookup and erase of a million keys: FlatHashMap (heap and Arena storage) against std::unordered_map and std::map
+#include <iostream>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include "Allocator_adapters.h"
+#include "Arena.h"
+#include "Auto_array.h"
+#include "Benchmark.h"
+#include "Fast_random.h"
+#include "Flat_hash_map.h"
+
+constexpr size_t COUNT = 1'000'000;
+
+using Entry = std::pair<uint64_t, uint64_t>;
+using ArenaMap = FlatHashMap<uint64_t, uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>, ArenaAllocator<Entry>>;
+
+// Random keys: 'keys' are inserted, 'misses' are never in the map
+struct Keys
+{
+    AutoArray<uint64_t> keys;
+    AutoArray<uint64_t> misses;
+    AutoArray<Entry> entries;
+
+    Keys()
+    {
+        Xoshiro256StarStar engine(42);
+        keys.reserve(COUNT);
+        misses.reserve(COUNT);
+        entries.reserve(COUNT);
+        for (size_t i = 0; i < COUNT; i++)
+		{
+			uint64_t key = engine() | 1; // Odd keys hit, even keys miss
+			keys.push_back(key);
+			misses.push_back(key & ~uint64_t(1));
+			entries.push_back({ key, i });
+		}
+    }
+};
+
+// The same four cases for every container: 'make' returns an empty one
+template<typename Map, typename Make>
+void BenchmarkMap(Benchmark& bench, const std::string& name, const Keys& keys, Make&& make)
+{
+    bench.Run(name + ": insert", [&]()
+    {
+        Map map = make();
+        for (size_t i = 0; i < COUNT; i++)
+			map.emplace(keys.keys[i], i);
+        DoNotOptimize(map);
+    }, COUNT);
+
+    Map map = make();
+    for (size_t i = 0; i < COUNT; i++)
+		map.emplace(keys.keys[i], i);
+
+    bench.Run(name + ": lookup hit", [&]()
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < COUNT; i++)
+			total += map.find(keys.keys[i])->second;
+        DoNotOptimize(total);
+    }, COUNT);
+
+    bench.Run(name + ": lookup miss", [&]()
+    {
+        size_t found = 0;
+        for (size_t i = 0; i < COUNT; i++)
+			found += map.find(keys.misses[i]) != map.end();
+        DoNotOptimize(found);
+    }, COUNT);
+
+    // A full map is rebuilt untimed before every run
+    bench.RunWithSetup(name + ": erase", [&]()
+    {
+        map = make();
+        for (size_t i = 0; i < COUNT; i++)
+			map.emplace(keys.keys[i], i);
+    }, [&]()
+    {
+        for (size_t i = 0; i < COUNT; i++)
+			map.erase(keys.keys[i]);
+        DoNotOptimize(map);
+    }, COUNT);
+}
+
+int main(int argc, char** argv)
+{
+    Keys keys;
+    BenchmarkOptions defaults;
+    defaults.repetitions = 5;
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv, defaults));
+
+    BenchmarkMap<std::map<uint64_t, uint64_t>>(bench, "std::map", keys, []() { return std::map<uint64_t, uint64_t>(); });
+    BenchmarkMap<std::unordered_map<uint64_t, uint64_t>>(bench, "std::unordered_map", keys,
+                                                          []() { return std::unordered_map<uint64_t, uint64_t>(); });
+    BenchmarkMap<FlatHashMap<uint64_t, uint64_t>>(bench, "FlatHashMap", keys, []() { return FlatHashMap<uint64_t, uint64_t>(); });
+
+    // Known size: one allocation, no rehash, and the bulk path prefetches the groups of 16 keys ahead
+    bench.Run("std::unordered_map: reserve + insert", [&]()
+    {
+        std::unordered_map<uint64_t, uint64_t> map;
+        map.reserve(COUNT);
+        for (size_t i = 0; i < COUNT; i++)
+			map.emplace(keys.keys[i], i);
+        DoNotOptimize(map);
+    }, COUNT);
+
+    bench.Run("FlatHashMap: reserve + insert", [&]()
+    {
+        FlatHashMap<uint64_t, uint64_t> map;
+        map.reserve(COUNT);
+        for (size_t i = 0; i < COUNT; i++)
+			map.emplace(keys.keys[i], i);
+        DoNotOptimize(map);
+    }, COUNT);
+
+    bench.Run("FlatHashMap: bulk insert(first, last)", [&]()
+    {
+        FlatHashMap<uint64_t, uint64_t> map;
+        map.insert(keys.entries.begin(), keys.entries.end());
+        DoNotOptimize(map);
+    }, COUNT);
+
+    // Rebuilt per request: after the first run the table is reused and nothing is allocated
+    FlatHashMap<uint64_t, uint64_t> reused;
+    bench.Run("FlatHashMap: reset() + bulk insert", [&]()
+    {
+        reused.reset();
+        reused.insert(keys.entries.begin(), keys.entries.end());
+        DoNotOptimize(reused);
+    }, COUNT);
+
+    // The table lives in an arena that is rewound per run: no heap call at all once it has grown
+    Arena arena(64 * 1024 * 1024);
+    bench.Run("FlatHashMap on Arena: bulk insert, arena.reset()", [&]()
+    {
+        {
+            ArenaMap map{ ArenaAllocator<Entry>(arena) };
+            map.insert(keys.entries.begin(), keys.entries.end());
+            DoNotOptimize(map);
+        }
+        arena.reset();
+    }, COUNT);
+
+    ArenaMap arena_map{ ArenaAllocator<Entry>(arena) };
+    arena_map.insert(keys.entries.begin(), keys.entries.end());
+    std::cout << "FlatHashMap: " << arena_map.size() << " keys in " << arena_map.capacity() << " slots (load "
+              << arena_map.load_factor() << "), arena holds " << arena.capacity() / (1024 * 1024) << " MB\n\n";
+
+    bench.Report();
+    return 0;
+}
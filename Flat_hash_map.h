@@ -0,0 +1,629 @@
+// Flat open addressing hash map: SwissTable control bytes, 16 slot SIMD group probing, storage from any allocator
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "Asm_kernels.h"
+#include "Bit_tricks.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/*
+	FlatHashMap<Key, Value, Hash, Equal, Allocator>
+
+	std::unordered_map allocates one node per element and a lookup follows
+	a bucket pointer, then a node pointer: two cache misses and one call to
+	the allocator per insert. FlatHashMap keeps every element in one array
+	of slots (open addressing) with one control byte per slot in front of it:
+
+		control  [h2|h2|--|h2|xx|--|...]   --: empty, xx: deleted, h2: 7 hash bits
+		slots    [kv|kv|  |kv|  |  |...]
+
+	- the hash is split into h1, which picks the first group of 16 slots to
+	  look at, and h2, the 7 bits stored in the control byte of a full slot
+	- a lookup compares the 16 control bytes of a group with h2 in one SIMD
+	  compare (SSE2 on x86-64, NEON on AArch64, a loop elsewhere), and only
+	  the slots whose byte matches have their key compared: usually exactly
+	  one. A group with an empty slot ends the search, otherwise the next
+	  group is probed (triangular steps, which visit every group)
+	- erase leaves a 'deleted' tombstone only when the group has no empty
+	  slot (some lookup may have passed through it); tombstones are dropped
+	  when the table is rehashed
+	- the table grows to twice its size at 7/8 load. Growth rehashes every
+	  element and invalidates all iterators and references; reserve() or the
+	  bulk insert(first, last) avoid it
+	- reset() destroys the elements but keeps the storage, so a map that is
+	  refilled per request or per frame stops allocating once it has seen
+	  its peak size (like Arena::reset()); clear() gives the storage back
+
+	The control bytes and the slots are one allocation from 'Allocator'
+	(rebound to 16 byte chunks): ArenaAllocator and PoolAllocator from
+	Allocator_adapters.h work. On an arena the storage of a table that grew
+	is only reclaimed by resetting the arena, so reserve() up front there.
+
+	Unlike std::unordered_map the elements are std::pair<Key, Value>, the
+	key is not const: don't change it through an iterator. The map is move
+	only, like SoAArray.
+*/
+
+// One probe step: 16 control bytes at a 16 byte boundary, match results one bit per slot
+class FlatHashGroup
+{
+public:
+    static constexpr size_t s_Width = 16;
+    static constexpr int8_t s_Empty = -128; // 0b1000'0000
+    static constexpr int8_t s_Deleted = -2; // 0b1111'1110, full slots hold 0...127: the top bit is clear
+
+#if defined(__SSE2__)
+    static uint32_t Match(const int8_t* control, int8_t h2)
+    {
+        __m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i*>(control));
+        return unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(h2))));
+    }
+
+    // Empty or deleted: the top bit of the byte
+    static uint32_t MatchFree(const int8_t* control)
+    {
+        return unsigned(_mm_movemask_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(control))));
+    }
+#elif defined(__aarch64__)
+    // NEON has no movemask: keep one weighted bit per byte and add neighbours pairwise down to 16 bits
+    static uint32_t Mask(uint8x16_t compare)
+    {
+        static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+        uint8x16_t sum = vandq_u8(compare, vld1q_u8(weights));
+        sum = vpaddq_u8(sum, sum);
+        sum = vpaddq_u8(sum, sum);
+        sum = vpaddq_u8(sum, sum);
+        return vgetq_lane_u16(vreinterpretq_u16_u8(sum), 0);
+    }
+
+    static uint32_t Match(const int8_t* control, int8_t h2)
+    {
+        return Mask(vceqq_s8(vld1q_s8(control), vdupq_n_s8(h2)));
+    }
+
+    static uint32_t MatchFree(const int8_t* control)
+    {
+        return Mask(vcltzq_s8(vld1q_s8(control)));
+    }
+#else
+    static uint32_t Match(const int8_t* control, int8_t h2)
+    {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < s_Width; ++i)
+			mask |= uint32_t(control[i] == h2) << i;
+        return mask;
+    }
+
+    static uint32_t MatchFree(const int8_t* control)
+    {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < s_Width; ++i)
+			mask |= uint32_t(control[i] < 0) << i;
+        return mask;
+    }
+#endif
+
+    static uint32_t MatchEmpty(const int8_t* control) { return Match(control, s_Empty); }
+};
+
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>,
+         typename Allocator = std::allocator<std::pair<Key, Value>>>
+class FlatHashMap
+{
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using size_type = size_t;
+    using hasher = Hash;
+    using key_equal = Equal;
+    using allocator_type = Allocator;
+
+private:
+    static constexpr size_t s_Width = FlatHashGroup::s_Width;
+    static constexpr size_t s_MinCapacity = s_Width;
+    static constexpr size_t s_BulkBatch = 16; // Keys hashed and prefetched ahead by insert(first, last)
+
+    struct alignas(s_Width) t_Chunk
+    {
+        unsigned char bytes[s_Width];
+    };
+
+    static_assert(alignof(value_type) <= alignof(t_Chunk), "FlatHashMap: over-aligned key or value");
+
+    using t_ChunkAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<t_Chunk>;
+    using t_Traits = std::allocator_traits<t_ChunkAllocator>;
+
+    // Triangular probing over the groups: offsets h1, h1 + 1, h1 + 3, h1 + 6, ... modulo a power of two
+    struct t_Probe
+    {
+        size_t group;
+        size_t mask;
+        size_t step = 0;
+
+        t_Probe(size_t hash, size_t groups) : group((hash >> 7) & (groups - 1)), mask(groups - 1) {}
+
+        size_t Offset() const { return group * s_Width; }
+        void Next() { group = (group + ++step) & mask; }
+    };
+
+    template<bool Const>
+    class t_Iterator
+    {
+        friend class FlatHashMap;
+        template<bool>
+        friend class t_Iterator;
+        using t_Slot = std::conditional_t<Const, const std::pair<Key, Value>, std::pair<Key, Value>>;
+
+        const int8_t* m_Control = nullptr;
+        const int8_t* m_End = nullptr;
+        t_Slot* m_Slot = nullptr;
+
+        t_Iterator(const int8_t* control, const int8_t* end, t_Slot* slot) : m_Control(control), m_End(end), m_Slot(slot)
+        {
+        }
+
+        void SkipFree()
+        {
+            for (; m_Control != m_End && *m_Control < 0; ++m_Control, ++m_Slot)
+            {
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<Key, Value>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = t_Slot*;
+        using reference = t_Slot&;
+
+        t_Iterator() = default;
+
+        // iterator -> const_iterator
+        template<bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+        t_Iterator(const t_Iterator<OtherConst>& other) : m_Control(other.m_Control), m_End(other.m_End), m_Slot(other.m_Slot)
+        {
+        }
+
+        reference operator*() const { return *m_Slot; }
+        pointer operator->() const { return m_Slot; }
+
+        t_Iterator& operator++()
+        {
+            ++m_Control;
+            ++m_Slot;
+            SkipFree();
+            return *this;
+        }
+
+        t_Iterator operator++(int)
+        {
+            t_Iterator copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        bool operator==(const t_Iterator& other) const { return m_Control == other.m_Control; }
+    };
+
+public:
+    using iterator = t_Iterator<false>;
+    using const_iterator = t_Iterator<true>;
+
+private:
+    [[no_unique_address]] Hash m_Hash;
+    [[no_unique_address]] Equal m_Equal;
+    [[no_unique_address]] t_ChunkAllocator m_Allocator;
+    int8_t* m_Control = nullptr;   // m_Capacity control bytes, the slots right after them
+    value_type* m_Slots = nullptr;
+    size_t m_Capacity = 0;         // 0, or a power of two >= s_MinCapacity
+    size_t m_Size = 0;
+    size_t m_GrowthLeft = 0;       // Empty slots that can still be filled before the table must grow
+
+    // Full slots plus tombstones stay at or below 7/8 of the table, so every probe reaches an empty slot
+    static size_t MaxLoad(size_t capacity) { return capacity - capacity / 8; }
+
+    static size_t ChunksFor(size_t capacity) { return (capacity + capacity * sizeof(value_type) + s_Width - 1) / s_Width; }
+
+    // Smallest table that holds 'count' elements without growing
+    static size_t CapacityFor(size_t count)
+    {
+        size_t capacity = NextPowerOfTwo(count + count / 7 + 1);
+        capacity = capacity < s_MinCapacity ? s_MinCapacity : capacity;
+        return MaxLoad(capacity) < count ? capacity * 2 : capacity;
+    }
+
+    /*
+		std::hash of an integer is the integer itself on libstdc++ and libc++,
+		which would put consecutive keys in the same group with the same h2.
+		A 64x64 -> 128 bit multiply by the golden ratio, folded, spreads every
+		input bit over the whole word.
+	*/
+    size_t HashOf(const Key& key) const
+    {
+        unsigned __int128 product = (unsigned __int128)uint64_t(m_Hash(key)) * 0x9E3779B97F4A7C15;
+        return size_t(uint64_t(product) ^ uint64_t(product >> 64));
+    }
+
+    static int8_t H2(size_t hash) { return int8_t(hash & 0x7F); }
+
+    const int8_t* GroupOf(size_t hash) const { return m_Control + t_Probe(hash, m_Capacity / s_Width).Offset(); }
+
+    // Slot holding 'key', m_Capacity if there is none
+    size_t FindIndex(const Key& key, size_t hash) const
+    {
+        if (m_Capacity == 0)
+			return 0;
+
+        const int8_t h2 = H2(hash);
+        for (t_Probe probe(hash, m_Capacity / s_Width);; probe.Next())
+        {
+            const int8_t* group = m_Control + probe.Offset();
+            for (uint32_t match = FlatHashGroup::Match(group, h2); match; match &= match - 1)
+            {
+                size_t index = probe.Offset() + size_t(std::countr_zero(match));
+                if (m_Equal(m_Slots[index].first, key))
+					return index;
+            }
+            if (FlatHashGroup::MatchEmpty(group))
+				return m_Capacity;
+        }
+    }
+
+    // First empty or deleted slot on the probe sequence of 'hash'
+    size_t FindFreeSlot(size_t hash) const
+    {
+        for (t_Probe probe(hash, m_Capacity / s_Width);; probe.Next())
+        {
+            uint32_t free = FlatHashGroup::MatchFree(m_Control + probe.Offset());
+            if (free)
+				return probe.Offset() + size_t(std::countr_zero(free));
+        }
+    }
+
+    // A free slot for a new element of 'hash', growing the table first if only an empty slot is left and it's at its load limit
+    size_t PrepareInsert(size_t hash)
+    {
+        if (m_Capacity == 0)
+			Rehash(s_MinCapacity);
+        size_t index = FindFreeSlot(hash);
+        if (m_GrowthLeft == 0 && m_Control[index] == FlatHashGroup::s_Empty)
+        {
+            // Mostly tombstones: rehash at the same size to drop them, otherwise double
+            Rehash(m_Size * 16 <= m_Capacity * 7 ? m_Capacity : m_Capacity * 2);
+            index = FindFreeSlot(hash);
+        }
+        return index;
+    }
+
+    // Called once the element is constructed in the slot, so a throwing constructor leaves the map unchanged
+    void Occupy(size_t index, size_t hash)
+    {
+        m_GrowthLeft -= m_Control[index] == FlatHashGroup::s_Empty;
+        m_Control[index] = H2(hash);
+        ++m_Size;
+    }
+
+    template<typename K, typename... Args>
+    std::pair<iterator, bool> EmplaceHashed(size_t hash, K&& key, Args&&... args)
+    {
+        size_t index = FindIndex(key, hash);
+        if (index != m_Capacity)
+			return { IteratorAt(index), false };
+
+        index = PrepareInsert(hash);
+        ::new (static_cast<void*>(m_Slots + index)) value_type(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                                                            std::forward_as_tuple(std::forward<Args>(args)...));
+        Occupy(index, hash);
+        return { IteratorAt(index), true };
+    }
+
+    void EraseAt(size_t index)
+    {
+        std::destroy_at(m_Slots + index);
+        --m_Size;
+
+        // A group that still has an empty slot never sent a probe further, so no tombstone is needed
+        if (FlatHashGroup::MatchEmpty(m_Control + (index & ~(s_Width - 1))))
+        {
+            m_Control[index] = FlatHashGroup::s_Empty;
+            ++m_GrowthLeft;
+        }
+        else
+        {
+            m_Control[index] = FlatHashGroup::s_Deleted;
+        }
+    }
+
+    void DestroyAll()
+    {
+        if constexpr (!std::is_trivially_destructible_v<value_type>)
+        {
+            for (size_t i = 0; i < m_Capacity; ++i)
+            {
+                if (m_Control[i] >= 0)
+					std::destroy_at(m_Slots + i);
+            }
+        }
+    }
+
+    void Deallocate()
+    {
+        if (m_Control)
+			t_Traits::deallocate(m_Allocator, reinterpret_cast<t_Chunk*>(m_Control), ChunksFor(m_Capacity));
+        m_Control = nullptr;
+        m_Slots = nullptr;
+        m_Capacity = 0;
+        m_GrowthLeft = 0;
+    }
+
+    // Move every element into a fresh table of 'capacity' slots; tombstones are left behind
+    void Rehash(size_t capacity)
+    {
+        int8_t* control = reinterpret_cast<int8_t*>(t_Traits::allocate(m_Allocator, ChunksFor(capacity)));
+        value_type* slots = reinterpret_cast<value_type*>(control + capacity);
+        std::memset(control, FlatHashGroup::s_Empty, capacity);
+
+        int8_t* old_control = m_Control;
+        value_type* old_slots = m_Slots;
+        size_t old_capacity = m_Capacity;
+        m_Control = control;
+        m_Slots = slots;
+        m_Capacity = capacity;
+
+        // A new table has no tombstones and no duplicates: the first free slot is the one, no key compares
+        for (size_t i = 0; i < old_capacity; ++i)
+        {
+            if (old_control[i] < 0)
+				continue;
+            size_t hash = HashOf(old_slots[i].first);
+            size_t index = FindFreeSlot(hash);
+            ::new (static_cast<void*>(slots + index)) value_type(std::move(old_slots[i]));
+            std::destroy_at(old_slots + i);
+            control[index] = H2(hash);
+        }
+        m_GrowthLeft = MaxLoad(capacity) - m_Size;
+
+        if (old_control)
+			t_Traits::deallocate(m_Allocator, reinterpret_cast<t_Chunk*>(old_control), ChunksFor(old_capacity));
+    }
+
+    iterator IteratorAt(size_t index) { return iterator(m_Control + index, m_Control + m_Capacity, m_Slots + index); }
+
+    const_iterator IteratorAt(size_t index) const
+    {
+        return const_iterator(m_Control + index, m_Control + m_Capacity, m_Slots + index);
+    }
+
+    void Release(FlatHashMap& other)
+    {
+        other.m_Control = nullptr;
+        other.m_Slots = nullptr;
+        other.m_Capacity = 0;
+        other.m_Size = 0;
+        other.m_GrowthLeft = 0;
+    }
+
+    void Steal(FlatHashMap& other)
+    {
+        m_Control = other.m_Control;
+        m_Slots = other.m_Slots;
+        m_Capacity = other.m_Capacity;
+        m_Size = other.m_Size;
+        m_GrowthLeft = other.m_GrowthLeft;
+        Release(other);
+    }
+
+public:
+    FlatHashMap() = default;
+
+    explicit FlatHashMap(const Allocator& allocator, const Hash& hash = Hash(), const Equal& equal = Equal())
+        : m_Hash(hash), m_Equal(equal), m_Allocator(t_ChunkAllocator(allocator))
+    {
+    }
+
+    FlatHashMap(const FlatHashMap&) = delete;
+    FlatHashMap& operator=(const FlatHashMap&) = delete;
+
+    FlatHashMap(FlatHashMap&& other) noexcept
+        : m_Hash(std::move(other.m_Hash)), m_Equal(std::move(other.m_Equal)), m_Allocator(std::move(other.m_Allocator))
+    {
+        Steal(other);
+    }
+
+    FlatHashMap& operator=(FlatHashMap&& other)
+    {
+        if (this == &other)
+			return *this;
+
+        m_Hash = std::move(other.m_Hash);
+        m_Equal = std::move(other.m_Equal);
+        if (t_Traits::propagate_on_container_move_assignment::value || m_Allocator == other.m_Allocator)
+        {
+            clear();
+            if constexpr (t_Traits::propagate_on_container_move_assignment::value)
+				m_Allocator = std::move(other.m_Allocator);
+            Steal(other);
+        }
+        else
+        {
+            // Other memory source: keep ours and move the elements over
+            reset();
+            reserve(other.m_Size);
+            for (value_type& element : other)
+				EmplaceHashed(HashOf(element.first), std::move(element.first), std::move(element.second));
+            other.clear();
+        }
+        return *this;
+    }
+
+    ~FlatHashMap()
+    {
+        DestroyAll();
+        Deallocate();
+    }
+
+    allocator_type get_allocator() const { return allocator_type(m_Allocator); }
+
+    size_t size() const { return m_Size; }
+    bool empty() const { return m_Size == 0; }
+    size_t capacity() const { return m_Capacity; }
+    double load_factor() const { return m_Capacity ? double(m_Size) / double(m_Capacity) : 0.0; }
+
+    iterator begin()
+    {
+        iterator it = IteratorAt(0);
+        it.SkipFree();
+        return it;
+    }
+
+    const_iterator begin() const
+    {
+        const_iterator it = IteratorAt(0);
+        it.SkipFree();
+        return it;
+    }
+
+    iterator end() { return IteratorAt(m_Capacity); }
+    const_iterator end() const { return IteratorAt(m_Capacity); }
+
+    // Room for 'count' elements without growing
+    void reserve(size_t count)
+    {
+        if (count > m_Size + m_GrowthLeft)
+        {
+            size_t capacity = CapacityFor(count);
+            Rehash(capacity > m_Capacity ? capacity : m_Capacity);
+        }
+    }
+
+    iterator find(const Key& key)
+    {
+        size_t index = FindIndex(key, HashOf(key));
+        return IteratorAt(index);
+    }
+
+    const_iterator find(const Key& key) const
+    {
+        size_t index = FindIndex(key, HashOf(key));
+        return IteratorAt(index);
+    }
+
+    bool contains(const Key& key) const { return FindIndex(key, HashOf(key)) != m_Capacity; }
+    size_t count(const Key& key) const { return contains(key) ? 1 : 0; }
+
+    // Constructs the value from 'args' only if the key is new
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args)
+    {
+        return EmplaceHashed(HashOf(key), key, std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args)
+    {
+        size_t hash = HashOf(key);
+        return EmplaceHashed(hash, std::move(key), std::forward<Args>(args)...);
+    }
+
+    template<typename K, typename V>
+    std::pair<iterator, bool> emplace(K&& key, V&& value)
+    {
+        return try_emplace(Key(std::forward<K>(key)), std::forward<V>(value));
+    }
+
+    std::pair<iterator, bool> insert(const value_type& element) { return try_emplace(element.first, element.second); }
+    std::pair<iterator, bool> insert(value_type&& element) { return try_emplace(std::move(element.first), std::move(element.second)); }
+
+    /*
+		Bulk insert: one reserve() for the whole range when its length is
+		known, then batches of 16 keys are hashed first and their groups
+		prefetched, so the cache misses of a batch overlap instead of each
+		insert waiting for its own. Keys already in the map keep their value.
+		A single pass range can't be walked twice, so it is inserted one by one
+	*/
+    template<typename Iterator>
+    void insert(Iterator first, Iterator last)
+    {
+        if constexpr (!std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>)
+        {
+            for (; first != last; ++first)
+				insert(*first);
+        }
+        else
+        {
+            reserve(m_Size + size_t(std::distance(first, last)));
+
+            size_t hashes[s_BulkBatch];
+            while (first != last)
+            {
+                Iterator batch = first;
+                size_t count = 0;
+                for (; count < s_BulkBatch && first != last; ++count, ++first)
+                {
+                    hashes[count] = HashOf((*first).first);
+                    if (m_Capacity)
+						Prefetch(GroupOf(hashes[count]));
+                }
+                for (size_t i = 0; i < count; ++i, ++batch)
+					EmplaceHashed(hashes[i], (*batch).first, (*batch).second);
+            }
+        }
+    }
+
+    Value& operator[](const Key& key) { return try_emplace(key).first->second; }
+    Value& operator[](Key&& key) { return try_emplace(std::move(key)).first->second; }
+
+    size_t erase(const Key& key)
+    {
+        size_t index = FindIndex(key, HashOf(key));
+        if (index == m_Capacity)
+			return 0;
+        EraseAt(index);
+        return 1;
+    }
+
+    // Elements don't move on erase: the iterator after the erased one stays valid
+    iterator erase(const_iterator position)
+    {
+        size_t index = size_t(position.m_Control - m_Control);
+        EraseAt(index);
+        iterator next = IteratorAt(index);
+        next.SkipFree();
+        return next;
+    }
+
+    iterator erase(iterator position) { return erase(const_iterator(position)); }
+
+    // Destroy every element, keep the table: refilling up to the same size allocates nothing
+    void reset()
+    {
+        DestroyAll();
+        if (m_Capacity)
+			std::memset(m_Control, FlatHashGroup::s_Empty, m_Capacity);
+        m_Size = 0;
+        m_GrowthLeft = MaxLoad(m_Capacity);
+    }
+
+    // Destroy every element and give the table back to the allocator
+    void clear()
+    {
+        DestroyAll();
+        Deallocate();
+        m_Size = 0;
+    }
+};
@@ -1,14 +1,165 @@
 // Get ultra fast input and output
-#include <bits/stdc++.h>
-using namespace std;
+// ( note: the classic trick below still formats every token through iostreams; FastInput / FastOutput don't )
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include "Benchmark.h"
+#include "Fast_io.h"
+#include "Simd_integer_parser.h"
 
-int main()
+constexpr size_t COUNT = 5'000'000;
+
+// Reads every number of stdin with one of the methods below
+long long SumWithCin()
+{
+    long long sum = 0;
+    long long value;
+    while (std::cin >> value)
+		sum += value;
+    return sum;
+}
+
+long long SumWithScanf()
+{
+    long long sum = 0;
+    long long value;
+    while (std::scanf("%lld", &value) == 1)
+		sum += value;
+    return sum;
+}
+
+long long SumWithGetcharUnlocked()
+{
+    long long sum = 0;
+    int c = getchar_unlocked();
+    for (;;)
+    {
+        while (c != EOF && c <= ' ')
+			c = getchar_unlocked();
+        if (c == EOF)
+			break;
+        bool negative = c == '-';
+        if (negative)
+			c = getchar_unlocked();
+        long long value = 0;
+        for (; c >= '0' && c <= '9'; c = getchar_unlocked())
+			value = value * 10 + (c - '0');
+        sum += negative ? -value : value;
+    }
+    return sum;
+}
+
+long long SumWithFastInput(FastInput& in)
+{
+    long long sum = 0;
+    int64_t value;
+    while (in.Read(value))
+		sum += value;
+    return sum;
+}
+
+int main(int argc, char** argv)
 {
-	ios_base::sync_with_stdio(false); // Disable synchronization
-	cin.tie(NULL);	// Fast input
-	cout.tie(NULL); // Fast output
+	std::ios_base::sync_with_stdio(false); // Disable synchronization
+	std::cin.tie(NULL);	// Fast input
+	std::cout.tie(NULL); // Fast output
+
+    // Five million numbers of up to ten digits, written with FastOutput
+    std::string path = (std::filesystem::temp_directory_path() / "fast_io_numbers.txt").string();
+    {
+        std::mt19937_64 random(42);
+        std::uniform_int_distribution<int64_t> numbers(-1'000'000'000, 1'000'000'000);
+        FastOutput out(path.c_str());
+        for (size_t i = 0; i < COUNT; i++)
+			out << numbers(random) << (i % 10 == 9 ? '\n' : ' ');
+    }
+    std::cout << "Input: " << COUNT << " numbers, " << std::filesystem::file_size(path) / (1024 * 1024) << " MiB\n\n";
+
+    BenchmarkOptions defaults;
+    defaults.repetitions = 3;
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv, defaults));
+
+    long long expected = 0;
+    {
+        FastInput in(path.c_str());
+        expected = SumWithFastInput(in);
+    }
+
+    // stdin is reopened on the file before every run
+    auto check = [&](long long sum)
+    {
+        if (sum != expected)
+			std::cerr << "wrong sum: " << sum << " instead of " << expected << "\n";
+    };
+    auto rewind_stdin = [&]()
+    {
+        if (!std::freopen(path.c_str(), "r", stdin))
+			std::perror("freopen");
+        std::cin.clear();
+    };
+
+    bench.RunWithSetup("cin >> (sync off, untied)", rewind_stdin, [&]() { check(SumWithCin()); }, COUNT);
+    bench.RunWithSetup("scanf", rewind_stdin, [&]() { check(SumWithScanf()); }, COUNT);
+    bench.RunWithSetup("getchar_unlocked", rewind_stdin, [&]() { check(SumWithGetcharUnlocked()); }, COUNT);
+    bench.RunWithSetup("FastInput (stdin, read)", rewind_stdin, [&]()
+    {
+        FastInput in(STDIN_FILENO);
+        check(SumWithFastInput(in));
+    }, COUNT);
+
+    bench.Run("FastInput (file, read)", [&]()
+    {
+        FastInput in(path.c_str(), InputMode::Read);
+        check(SumWithFastInput(in));
+    }, COUNT);
+
+    bench.Run("FastInput (file, mmap)", [&]()
+    {
+        FastInput in(path.c_str(), InputMode::Map);
+        check(SumWithFastInput(in));
+    }, COUNT);
+
+    // Bulk parsing into an array instead of one Read() per number (Simd_integer_parser.h)
+    bench.Run("ParseIntegers (file, mmap)", [&]()
+    {
+        FastInput in(path.c_str(), InputMode::Map);
+        AutoArray<int64_t> values;
+        ParseIntegers(in, values);
+        long long sum = 0;
+        for (int64_t value : values)
+			sum += value;
+        check(sum);
+    }, COUNT);
+
+    // Output: the same numbers to /dev/null, so only formatting and buffering are measured
+    bench.Run("ofstream <<", [&]()
+    {
+        std::ofstream out("/dev/null");
+        for (size_t i = 0; i < COUNT; i++)
+			out << int64_t(i * 2654435761u % 2'000'000'000) - 1'000'000'000 << '\n';
+    }, COUNT);
+
+    bench.Run("fprintf", [&]()
+    {
+        FILE* out = std::fopen("/dev/null", "w");
+        for (size_t i = 0; i < COUNT; i++)
+			std::fprintf(out, "%lld\n", (long long)(int64_t(i * 2654435761u % 2'000'000'000) - 1'000'000'000));
+        std::fclose(out);
+    }, COUNT);
+
+    bench.Run("FastOutput", [&]()
+    {
+        FastOutput out("/dev/null");
+        for (size_t i = 0; i < COUNT; i++)
+			out << int64_t(i * 2654435761u % 2'000'000'000) - 1'000'000'000 << '\n';
+    }, COUNT);
+
+    bench.Report();
 
-	int n;
-	cin >> n;
-	cout << n << "\n";
+    std::filesystem::remove(path);
+    return 0;
 }
@@ -0,0 +1,1115 @@
+// Fixed size block pools used by the allocator examples
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Allocator_stats.h"
+#include "Asm_kernels.h"
+#include "Backing_memory.h"
+#include "Pool_checks.h"
+
+// What MemoryPool does once every block is in use
+enum class PoolGrowth
+{
+    None,       // Throw std::bad_alloc (the original behaviour)
+    Geometric,  // Add a slab as large as the whole pool, doubling capacity
+    FixedChunk  // Add a slab of 'chunk_blocks' blocks
+};
+
+/*
+	How a pool places its blocks inside a slab.
+
+	Alignment  minimum alignment of every block (0 = just what T needs)
+	Padding    extra bytes after every block
+	Colors     number of different start offsets for consecutive slabs;
+	           slab n starts (n % Colors) cache lines in, so the same block
+	           index in different slabs doesn't land on the same cache set
+
+	The stride is always a multiple of the alignment, so with Alignment = 64
+	no two blocks ever share a cache line (no false sharing between threads
+	that own neighbouring blocks).
+*/
+template<size_t Alignment = 0, size_t Padding = 0, size_t Colors = 1>
+struct PoolLayout
+{
+    static constexpr size_t s_CacheLine = 64;
+    static constexpr size_t s_Colors = Colors ? Colors : 1;
+
+    // 'Header' is the free list node the pool writes into free blocks
+    template<typename T, typename Header>
+    static constexpr size_t Align()
+    {
+        size_t align = alignof(T) > alignof(Header) ? alignof(T) : alignof(Header);
+        return Alignment > align ? Alignment : align;
+    }
+
+    template<typename T, typename Header>
+    static constexpr size_t Stride()
+    {
+        size_t size = (sizeof(T) > sizeof(Header) ? sizeof(T) : sizeof(Header)) + Padding;
+        return (size + Align<T, Header>() - 1) / Align<T, Header>() * Align<T, Header>();
+    }
+
+    // Offset of the first block of slab number 'slab'
+    template<typename T, typename Header>
+    static constexpr size_t ColorOffset(size_t slab)
+    {
+        size_t step = Align<T, Header>() > s_CacheLine ? Align<T, Header>() : s_CacheLine;
+        return (slab % s_Colors) * step;
+    }
+};
+
+using DefaultLayout = PoolLayout<>;
+using CacheLineLayout = PoolLayout<PoolLayout<>::s_CacheLine>;
+
+template<typename T, typename Layout = DefaultLayout>
+class MemoryPool
+{
+    struct t_FreeBlock
+    {
+        t_FreeBlock* next;
+    };
+
+    static constexpr bool s_Checked = PoolChecks::s_Enabled;
+    static constexpr bool s_Hooked = PoolChecks::s_Enabled || PoolChecks::s_Asan;
+    static constexpr size_t s_Align = Layout::template Align<T, t_FreeBlock>();
+
+    // Checked builds make room for the canary after the object
+    static constexpr size_t s_GuardBytes = s_Checked ? (PoolChecks::s_CanarySize + s_Align - 1) / s_Align * s_Align : 0;
+    static constexpr size_t s_BlockSize = Layout::template Stride<T, t_FreeBlock>() + s_GuardBytes;
+
+    // One contiguous piece of memory carved into blocks
+    struct t_Slab
+    {
+        char* memory;
+        size_t blockCount;
+        size_t bytes;
+        char* blocks;                 // First block, after the color offset
+        std::vector<uint64_t> free;   // Checked builds: one bit per block, set while it is free
+    };
+
+    std::vector<t_Slab> m_Slabs;
+    t_FreeBlock* m_FreeList;
+    char* m_BumpCursor; // Next never used block of the newest slab
+    char* m_BumpEnd;
+    size_t m_BlockCount;
+    PoolGrowth m_Growth;
+    size_t m_ChunkBlocks;
+    BackingProvider* m_Backing;
+    [[no_unique_address]] AllocatorStats<false> m_Stats;
+
+    // Get a new slab and make it the bump region
+    void AddSlab(size_t block_count)
+    {
+        size_t color = Layout::template ColorOffset<T, t_FreeBlock>(m_Slabs.size());
+        size_t bytes = 0;
+        char* memory = static_cast<char*>(m_Backing->AcquireBlock(color + s_BlockSize * block_count, s_Align, bytes));
+        block_count = (bytes - color) / s_BlockSize; // Huge pages may round the slab up, use all of it
+        m_Slabs.push_back({ memory, block_count, bytes, memory + color, {} });
+        m_BlockCount += block_count;
+
+        if constexpr (s_Checked)
+        {
+            m_Slabs.back().free.assign((block_count + 63) / 64, ~uint64_t(0));
+        }
+        PoolChecks::Poison(memory, bytes);
+
+        /* 
+			The free list is built lazily: blocks that were never handed out
+			are carved from the [m_BumpCursor, m_BumpEnd) region on demand,
+			and only blocks given back by Deallocate() go on the free list.
+			So the constructor doesn't touch the slab at all, and pages are
+			faulted in when the program actually uses them.
+		*/
+        m_BumpCursor = memory + color;
+        m_BumpEnd = m_BumpCursor + block_count * s_BlockSize;
+    }
+
+    // Slow path of Allocate(), only reached when the free list is empty
+    T* AllocateFromBump()
+    {
+        if (m_BumpCursor == m_BumpEnd)
+        {
+            Grow();
+        }
+
+        T* p = reinterpret_cast<T*>(m_BumpCursor);
+        m_BumpCursor += s_BlockSize;
+        if constexpr (s_Hooked)
+        {
+            HandOut(p);
+        }
+        return p;
+    }
+
+    // Checked builds: the slab 'p' belongs to and its block index there, abort if there is none
+    std::pair<t_Slab*, size_t> Locate(const void* p, const char* what)
+    {
+        const char* address = static_cast<const char*>(p);
+        for (t_Slab& slab : m_Slabs)
+        {
+            if (!std::less<const char*>()(address, slab.blocks)
+                && std::less<const char*>()(address, slab.blocks + slab.blockCount * s_BlockSize))
+            {
+                size_t offset = size_t(address - slab.blocks);
+                if (offset % s_BlockSize)
+                {
+                    PoolChecks::Fail("MemoryPool", "pointer is not the start of a block", p);
+                }
+                return { &slab, offset / s_BlockSize };
+            }
+        }
+        PoolChecks::Fail("MemoryPool", what, p);
+    }
+
+    static bool IsFree(const t_Slab& slab, size_t index)
+    {
+        return (slab.free[index / 64] >> (index % 64)) & 1;
+    }
+
+    static void MarkFree(t_Slab& slab, size_t index, bool free)
+    {
+        uint64_t bit = uint64_t(1) << (index % 64);
+        slab.free[index / 64] = free ? slab.free[index / 64] | bit : slab.free[index / 64] & ~bit;
+    }
+
+    // Checked builds: the head of the free list really is a free block, before its link is followed
+    void CheckFreeBlock(const t_FreeBlock* block)
+    {
+        auto [slab, index] = Locate(block, "free list corrupted (link points outside the pool)");
+        if (!IsFree(*slab, index))
+        {
+            PoolChecks::Fail("MemoryPool", "free list corrupted (block is already in use)", block);
+        }
+
+        const char* bytes = reinterpret_cast<const char*>(block);
+        PoolChecks::Unpoison(bytes, s_BlockSize);
+        if (!PoolChecks::Holds(bytes + sizeof(t_FreeBlock), PoolChecks::s_FreePattern, s_BlockSize - sizeof(t_FreeBlock)))
+        {
+            PoolChecks::Fail("MemoryPool", "block was written to while free (use after free)", block);
+        }
+    }
+
+    // Block leaves the pool, either off the free list or fresh from the bump region
+    void HandOut(void* p)
+    {
+        char* bytes = static_cast<char*>(p);
+        if constexpr (s_Checked)
+        {
+            auto [slab, index] = Locate(p, "block outside the pool");
+            PoolChecks::Unpoison(bytes, s_BlockSize);
+            MarkFree(*slab, index, false);
+            std::memset(bytes, PoolChecks::s_FreshPattern, sizeof(T));
+            std::memset(bytes + sizeof(T), PoolChecks::s_CanaryPattern, PoolChecks::s_CanarySize);
+        }
+
+        // Only the object itself is accessible, ASan flags anything past it
+        PoolChecks::Unpoison(bytes, sizeof(T));
+        PoolChecks::Poison(bytes + sizeof(T), s_BlockSize - sizeof(T));
+    }
+
+    // Block comes back through Deallocate(), before the free list link is written
+    void TakeBack(T* p)
+    {
+        char* bytes = reinterpret_cast<char*>(p);
+        if constexpr (s_Checked)
+        {
+            auto [slab, index] = Locate(p, "pointer does not belong to this pool");
+            if (IsFree(*slab, index))
+            {
+                PoolChecks::Fail("MemoryPool", "double free (or block was never allocated)", p);
+            }
+            PoolChecks::Unpoison(bytes, s_BlockSize);
+            if (!PoolChecks::Holds(bytes + sizeof(T), PoolChecks::s_CanaryPattern, PoolChecks::s_CanarySize))
+            {
+                PoolChecks::Fail("MemoryPool", "canary overwritten (write past the end of the object)", p);
+            }
+            MarkFree(*slab, index, true);
+            std::memset(bytes + sizeof(t_FreeBlock), PoolChecks::s_FreePattern, s_BlockSize - sizeof(t_FreeBlock));
+        }
+
+        // The link stays accessible, the pool itself reads it
+        PoolChecks::Unpoison(bytes, sizeof(t_FreeBlock));
+        PoolChecks::Poison(bytes + sizeof(t_FreeBlock), s_BlockSize - sizeof(t_FreeBlock));
+    }
+
+    // Only called once both the free list and the bump region are empty
+    void Grow()
+    {
+        switch (m_Growth)
+        {
+        case PoolGrowth::Geometric:
+            AddSlab(m_BlockCount ? m_BlockCount : 1);
+            break;
+        case PoolGrowth::FixedChunk:
+            AddSlab(m_ChunkBlocks);
+            break;
+        default:
+            m_Stats.CountFailure();
+            throw std::bad_alloc();
+        }
+    }
+
+public:
+    // 'backing' defaults to operator new and must outlive the pool
+    MemoryPool(const size_t block_count,
+               const PoolGrowth growth = PoolGrowth::None,
+               const size_t chunk_blocks = 0,
+               BackingProvider* backing = nullptr)
+        : m_FreeList(nullptr),
+          m_BumpCursor(nullptr),
+          m_BumpEnd(nullptr),
+          m_BlockCount(0),
+          m_Growth(growth),
+          m_ChunkBlocks(chunk_blocks ? chunk_blocks : (block_count ? block_count : 1)),
+          m_Backing(backing ? backing : &HeapBacking::Instance())
+    {
+        if (block_count)
+        {
+            AddSlab(block_count);
+        }
+    }
+
+    ~MemoryPool()
+    {
+        m_Stats.ReportLeaks("MemoryPool");
+        for (const t_Slab& slab : m_Slabs)
+        {
+            PoolChecks::Unpoison(slab.memory, slab.bytes);
+            m_Backing->ReleaseBlock(slab.memory, slab.bytes, s_Align);
+        }
+    }
+
+    MemoryPool(const MemoryPool&) = delete;
+    MemoryPool& operator=(const MemoryPool&) = delete;
+
+    // Allocate a block of type T ('site' is only recorded in debug builds with ALLOCATOR_STATS)
+    T* Allocate(AllocationSite site = AllocationSite::current())
+    {
+        if (!m_FreeList)
+		{
+			T* p = AllocateFromBump();
+			m_Stats.OnAllocate(p, site);
+			return p;
+		}
+
+        t_FreeBlock* block = m_FreeList;
+        if constexpr (s_Checked)
+        {
+            CheckFreeBlock(block);
+        }
+        m_FreeList = m_FreeList->next;
+        if constexpr (s_Hooked)
+        {
+            HandOut(block);
+        }
+        m_Stats.OnAllocate(block, site);
+        return reinterpret_cast<T*>(block);
+    }
+
+    // Deallocate a block of type T
+    void Deallocate(T* p)
+    {
+        m_Stats.OnDeallocate(p);
+        if constexpr (s_Hooked)
+        {
+            TakeBack(p);
+        }
+        t_FreeBlock* block = reinterpret_cast<t_FreeBlock*>(p);
+        block->next = m_FreeList;
+        m_FreeList = block;
+    }
+
+    // Allocate and construct in place, the block goes back to the pool if the constructor throws
+    template<typename... Args>
+    T* Make(Args&&... args)
+    {
+        T* p = Allocate();
+        try
+        {
+            return ::new (static_cast<void*>(p)) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            Deallocate(p);
+            throw;
+        }
+    }
+
+    // Destroy and deallocate an object created by Make(), nullptr is ignored
+    void Destroy(T* p)
+    {
+        if (p)
+        {
+            p->~T();
+            Deallocate(p);
+        }
+    }
+
+    // unique_ptr deleter that hands the object back to its pool (the pool must outlive the pointer)
+    class Deleter
+    {
+        MemoryPool* m_Pool = nullptr;
+
+    public:
+        Deleter() = default;
+        explicit Deleter(MemoryPool& pool) : m_Pool(&pool) {}
+
+        void operator()(T* p) const { m_Pool->Destroy(p); }
+    };
+
+    using UniquePtr = std::unique_ptr<T, Deleter>;
+
+    template<typename... Args>
+    UniquePtr MakeUnique(Args&&... args)
+    {
+        return UniquePtr(Make(std::forward<Args>(args)...), Deleter(*this));
+    }
+
+    /*
+		Fill 'out' with 'n' blocks. The free list is walked once and cut at
+		the n-th node, and blocks that come from the bump region are carved
+		in one run without going through the list at all. If the pool runs
+		out halfway, the blocks already taken go back before bad_alloc is
+		rethrown.
+	*/
+    void AllocateBulk(T** out, const size_t n, AllocationSite site = AllocationSite::current())
+    {
+        if constexpr (s_Hooked || AllocatorStats<false>::s_Enabled)
+        {
+            // Checks and counters are per block anyway
+            size_t i = 0;
+            try
+            {
+                for (; i < n; ++i)
+				{
+					out[i] = Allocate(site);
+				}
+            }
+            catch (const std::bad_alloc&)
+            {
+                DeallocateBulk(out, i);
+                throw;
+            }
+            return;
+        }
+
+        size_t i = 0;
+        t_FreeBlock* block = m_FreeList;
+        for (; i < n && block; ++i)
+		{
+			out[i] = reinterpret_cast<T*>(block);
+			block = block->next;
+		}
+        m_FreeList = block;
+
+        while (i < n)
+		{
+			if (m_BumpCursor == m_BumpEnd)
+			{
+				try
+				{
+					Grow();
+				}
+				catch (const std::bad_alloc&)
+				{
+					DeallocateBulk(out, i);
+					throw;
+				}
+			}
+
+			size_t run = std::min(n - i, size_t(m_BumpEnd - m_BumpCursor) / s_BlockSize);
+			for (size_t j = 0; j < run; ++j)
+			{
+				out[i++] = reinterpret_cast<T*>(m_BumpCursor);
+				m_BumpCursor += s_BlockSize;
+			}
+		}
+    }
+
+    // Give back 'n' blocks as one segment spliced onto the free list; they come out again in the same order
+    void DeallocateBulk(T* const* in, const size_t n)
+    {
+        if constexpr (s_Hooked || AllocatorStats<false>::s_Enabled)
+        {
+            for (size_t i = n; i > 0; --i)
+			{
+				Deallocate(in[i - 1]);
+			}
+            return;
+        }
+
+        if (!n)
+        {
+            return;
+        }
+        for (size_t i = 0; i + 1 < n; ++i)
+		{
+			reinterpret_cast<t_FreeBlock*>(in[i])->next = reinterpret_cast<t_FreeBlock*>(in[i + 1]);
+		}
+        reinterpret_cast<t_FreeBlock*>(in[n - 1])->next = m_FreeList;
+        m_FreeList = reinterpret_cast<t_FreeBlock*>(in[0]);
+    }
+
+    /*
+		Give slabs that are completely free back to the system.
+		The first slab (the one sized in the constructor) is always kept.
+		This walks the whole free list, so call it after a burst, not per
+		operation. Returns the number of blocks released.
+	*/
+    size_t ShrinkToFit()
+    {
+        if (m_Slabs.size() < 2)
+        {
+            return 0;
+        }
+
+        // Slab indices sorted by address, so a block finds its slab by binary search
+        std::vector<size_t> by_address(m_Slabs.size());
+        for (size_t i = 0; i < by_address.size(); ++i)
+        {
+            by_address[i] = i;
+        }
+        std::sort(by_address.begin(), by_address.end(), [&](size_t a, size_t b)
+        {
+            return std::less<char*>()(m_Slabs[a].memory, m_Slabs[b].memory);
+        });
+
+        auto slab_of = [&](const t_FreeBlock* block)
+        {
+            const char* address = reinterpret_cast<const char*>(block);
+            auto it = std::upper_bound(by_address.begin(), by_address.end(), address, [&](const char* a, size_t slab)
+            {
+                return std::less<const char*>()(a, m_Slabs[slab].memory);
+            });
+            return *(it - 1);
+        };
+
+        std::vector<size_t> free_blocks(m_Slabs.size(), 0);
+        for (t_FreeBlock* block = m_FreeList; block; block = block->next)
+        {
+            ++free_blocks[slab_of(block)];
+        }
+
+        // Blocks that were never carved out are free too
+        size_t bump_slab = m_Slabs.size();
+        if (m_BumpCursor != m_BumpEnd)
+        {
+            bump_slab = slab_of(reinterpret_cast<t_FreeBlock*>(m_BumpCursor));
+            free_blocks[bump_slab] += size_t(m_BumpEnd - m_BumpCursor) / s_BlockSize;
+        }
+
+        std::vector<char> release(m_Slabs.size(), 0);
+        size_t released = 0;
+        for (size_t i = 1; i < m_Slabs.size(); ++i)
+        {
+            if (free_blocks[i] == m_Slabs[i].blockCount)
+            {
+                release[i] = 1;
+                released += m_Slabs[i].blockCount;
+            }
+        }
+        if (!released)
+        {
+            return 0;
+        }
+
+        // Unlink the blocks of released slabs, keeping the order of the rest
+        t_FreeBlock** link = &m_FreeList;
+        for (t_FreeBlock* block = m_FreeList; block; block = block->next)
+        {
+            if (!release[slab_of(block)])
+            {
+                *link = block;
+                link = &block->next;
+            }
+        }
+        *link = nullptr;
+
+        if (bump_slab < m_Slabs.size() && release[bump_slab])
+        {
+            m_BumpCursor = nullptr;
+            m_BumpEnd = nullptr;
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < m_Slabs.size(); ++i)
+        {
+            if (release[i])
+            {
+                PoolChecks::Unpoison(m_Slabs[i].memory, m_Slabs[i].bytes);
+                m_Backing->ReleaseBlock(m_Slabs[i].memory, m_Slabs[i].bytes, s_Align);
+            }
+            else
+            {
+                m_Slabs[kept++] = std::move(m_Slabs[i]);
+            }
+        }
+        m_Slabs.resize(kept);
+        m_BlockCount -= released;
+        return released;
+    }
+
+    size_t BlockCount() const { return m_BlockCount; }
+    size_t SlabCount() const { return m_Slabs.size(); }
+
+    // All zero unless built with ALLOCATOR_STATS
+    AllocatorStatsSnapshot Stats() const { return m_Stats.Snapshot(); }
+};
+
+/*
+	shared_ptr objects without a heap allocation per object.
+
+	std::allocate_shared puts the control block and the object into one
+	allocation, of a type only the standard library knows. The blocks of
+	this pool are sized for T plus a few words of control block, and the
+	allocator checks at compile time that the real node fits.
+
+	The object is destroyed when the last shared_ptr goes away, its block
+	comes back when the last weak_ptr does; the pool must outlive both.
+*/
+template<typename T, typename Layout = DefaultLayout>
+class SharedObjectPool
+{
+    static constexpr size_t RoundUp(size_t bytes) { return (bytes + alignof(T) - 1) / alignof(T) * alignof(T); }
+
+    // Vtable pointer and two counts, then the allocator next to the object, each padded to T's alignment
+    static constexpr size_t s_ControlBytes = RoundUp(2 * sizeof(void*)) + RoundUp(sizeof(void*));
+
+    struct alignas(alignof(T) > alignof(void*) ? alignof(T) : alignof(void*)) t_Node
+    {
+        unsigned char bytes[s_ControlBytes + sizeof(T)];
+    };
+
+    using t_Nodes = MemoryPool<t_Node, Layout>;
+
+    template<typename U>
+    class t_NodeAllocator
+    {
+        template<typename V>
+        friend class t_NodeAllocator;
+
+        t_Nodes* m_Nodes;
+
+    public:
+        using value_type = U;
+
+        explicit t_NodeAllocator(t_Nodes& nodes) noexcept : m_Nodes(&nodes) {}
+
+        template<typename V>
+        t_NodeAllocator(const t_NodeAllocator<V>& other) noexcept : m_Nodes(other.m_Nodes) {}
+
+        U* allocate(size_t n)
+        {
+            static_assert(sizeof(U) <= sizeof(t_Node) && alignof(U) <= alignof(t_Node),
+                          "SharedObjectPool: the shared_ptr node doesn't fit, raise s_ControlBytes");
+            if (n != 1)
+            {
+                throw std::bad_alloc();
+            }
+            return reinterpret_cast<U*>(m_Nodes->Allocate());
+        }
+
+        void deallocate(U* p, size_t) noexcept
+        {
+            m_Nodes->Deallocate(reinterpret_cast<t_Node*>(p));
+        }
+
+        template<typename V>
+        bool operator==(const t_NodeAllocator<V>& other) const noexcept
+        {
+            return m_Nodes == other.m_Nodes;
+        }
+    };
+
+    t_Nodes m_Nodes;
+
+public:
+    explicit SharedObjectPool(const size_t block_count,
+                              const PoolGrowth growth = PoolGrowth::Geometric,
+                              const size_t chunk_blocks = 0,
+                              BackingProvider* backing = nullptr)
+        : m_Nodes(block_count, growth, chunk_blocks, backing)
+    {
+    }
+
+    template<typename... Args>
+    std::shared_ptr<T> Make(Args&&... args)
+    {
+        return std::allocate_shared<T>(t_NodeAllocator<T>(m_Nodes), std::forward<Args>(args)...);
+    }
+
+    size_t BlockCount() const { return m_Nodes.BlockCount(); }
+    AllocatorStatsSnapshot Stats() const { return m_Nodes.Stats(); }
+};
+
+/*
+	Thread safe variant of MemoryPool.
+
+	Free blocks are grouped into magazines (small batches of blocks).
+	The pool keeps a lock-free stack of full magazines, and every thread
+	owns a ThreadCache holding up to two magazines of its own. Allocating
+	and freeing through a ThreadCache only touches thread local state;
+	the shared stack is hit once per magazine, to refill or to drain.
+
+	The stack head packs a 32 bit block index together with a 32 bit tag
+	that is bumped on every push and pop, so a block that is popped and
+	pushed back between our load and our CAS can't fool the CAS (ABA).
+*/
+template<typename T, typename Layout = DefaultLayout>
+class ConcurrentMemoryPool
+{
+    static constexpr uint32_t s_Nil = UINT32_MAX;
+
+    struct t_FreeBlock
+    {
+        uint32_t next;      // Next block inside the same magazine
+        uint32_t nextBatch; // Next magazine on the shared stack (read racily, see PopMagazine)
+        uint32_t count;     // Blocks in this magazine (head block only)
+    };
+
+    static constexpr size_t s_Align = Layout::template Align<T, t_FreeBlock>();
+    static constexpr size_t s_BlockSize = Layout::template Stride<T, t_FreeBlock>();
+
+    struct t_Magazine
+    {
+        uint32_t head = s_Nil;
+        uint32_t count = 0;
+    };
+
+    BackingProvider* m_Backing;
+    size_t m_PoolBytes;
+    char* m_Pool;
+    size_t m_BlockCount;
+    uint32_t m_MagazineSize;
+    alignas(64) std::atomic<uint64_t> m_Head; // [ tag : 32 | index : 32 ]
+    [[no_unique_address]] AllocatorStats<true> m_Stats;
+    // Blocks freed and allocated without a ThreadCache, at most one magazine: the stack only sees full ones
+    alignas(64) std::mutex m_SpillLock;
+    t_Magazine m_Spill;
+
+    static uint64_t Pack(uint32_t index, uint32_t tag) { return (uint64_t(tag) << 32) | index; }
+    static uint32_t IndexOf(uint64_t head) { return uint32_t(head); }
+    static uint32_t TagOf(uint64_t head) { return uint32_t(head >> 32); }
+
+    t_FreeBlock* BlockAt(uint32_t index) const
+    {
+        return reinterpret_cast<t_FreeBlock*>(m_Pool + size_t(index) * s_BlockSize);
+    }
+
+    uint32_t IndexOf(const void* p) const
+    {
+        return uint32_t((static_cast<const char*>(p) - m_Pool) / s_BlockSize);
+    }
+
+    // Push a whole magazine onto the shared stack with a single CAS
+    void PushMagazine(t_Magazine magazine)
+    {
+        t_FreeBlock* block = BlockAt(magazine.head);
+        block->count = magazine.count;
+
+        // A failed CAS means another thread got there first: back off before retrying the same line
+        SpinBackoff backoff;
+        uint64_t head = m_Head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            std::atomic_ref<uint32_t>(block->nextBatch).store(IndexOf(head), std::memory_order_relaxed);
+            if (m_Head.compare_exchange_weak(head, Pack(magazine.head, TagOf(head) + 1),
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed))
+            {
+                return;
+            }
+            backoff.Pause();
+        }
+    }
+
+    // Pop a whole magazine from the shared stack, empty magazine if there is none
+    t_Magazine PopMagazine()
+    {
+        SpinBackoff backoff;
+        uint64_t head = m_Head.load(std::memory_order_acquire);
+        for (;;)
+        {
+            uint32_t index = IndexOf(head);
+            if (index == s_Nil)
+            {
+                return {};
+            }
+
+            /*
+				If another thread pops this block while we look at it, 'nextBatch'
+				may already hold user data. That is fine: the tag in 'm_Head' has
+				moved on by then, so the CAS below fails and we retry.
+			*/
+            uint32_t next = std::atomic_ref<uint32_t>(BlockAt(index)->nextBatch).load(std::memory_order_relaxed);
+            if (m_Head.compare_exchange_weak(head, Pack(next, TagOf(head) + 1),
+                                             std::memory_order_acquire,
+                                             std::memory_order_acquire))
+            {
+                return { index, BlockAt(index)->count };
+            }
+            backoff.Pause();
+        }
+    }
+
+    // A magazine for a ThreadCache; once the stack is empty, whatever the spill holds
+    t_Magazine Refill()
+    {
+        t_Magazine magazine = PopMagazine();
+        if (!magazine.count)
+        {
+            std::lock_guard<std::mutex> guard(m_SpillLock);
+            std::swap(magazine, m_Spill);
+        }
+        return magazine;
+    }
+
+public:
+    // Per thread front end. Keep one per worker thread, never share it.
+    class ThreadCache
+    {
+        // With ALLOCATOR_STATS, counted locally and added to the pool's counters once per magazine
+        struct t_NoCounts
+        {
+        };
+        struct t_Counts
+        {
+            uint64_t allocations = 0;
+            uint64_t deallocations = 0;
+        };
+        using t_LocalCounts = std::conditional_t<AllocatorStats<true>::s_Enabled, t_Counts, t_NoCounts>;
+
+        ConcurrentMemoryPool& m_Owner;
+        t_Magazine m_Loaded;   // Magazine we allocate from and free into
+        t_Magazine m_Previous; // Spare magazine, either full or empty
+        [[no_unique_address]] t_LocalCounts m_Counts;
+
+        void PublishCounts()
+        {
+            if constexpr (AllocatorStats<true>::s_Enabled)
+            {
+                m_Owner.m_Stats.CountAllocations(m_Counts.allocations);
+                m_Owner.m_Stats.CountDeallocations(m_Counts.deallocations);
+                m_Owner.m_Stats.RaisePeak(m_Owner.m_Stats.Live());
+                m_Counts = {};
+            }
+        }
+
+    public:
+        explicit ThreadCache(ConcurrentMemoryPool& pool) : m_Owner(pool) {}
+
+        ~ThreadCache()
+        {
+            Flush();
+        }
+
+        ThreadCache(const ThreadCache&) = delete;
+        ThreadCache& operator=(const ThreadCache&) = delete;
+
+        T* Allocate(AllocationSite site = AllocationSite::current())
+        {
+            T* p = TryAllocate(site);
+            if (!p)
+            {
+                throw std::bad_alloc();
+            }
+            return p;
+        }
+
+        // Same as Allocate() but returns nullptr when this cache and the shared stack are both empty
+        T* TryAllocate(AllocationSite site = AllocationSite::current())
+        {
+            if (!m_Loaded.count)
+            {
+                if (m_Previous.count)
+                {
+                    std::swap(m_Loaded, m_Previous);
+                }
+                else
+                {
+                    PublishCounts();
+                    m_Loaded = m_Owner.Refill();
+                    if (!m_Loaded.count)
+                    {
+                        m_Owner.m_Stats.CountFailure();
+                        return nullptr;
+                    }
+                }
+            }
+
+            t_FreeBlock* block = m_Owner.BlockAt(m_Loaded.head);
+            m_Loaded.head = block->next;
+            --m_Loaded.count;
+            if constexpr (AllocatorStats<true>::s_Enabled)
+            {
+                ++m_Counts.allocations;
+                m_Owner.m_Stats.TrackSite(block, site);
+            }
+            return reinterpret_cast<T*>(block);
+        }
+
+        void Deallocate(T* p)
+        {
+            if constexpr (AllocatorStats<true>::s_Enabled)
+            {
+                ++m_Counts.deallocations;
+                m_Owner.m_Stats.ForgetSite(p);
+            }
+
+            if (m_Loaded.count == m_Owner.m_MagazineSize)
+            {
+                // Both magazines full: hand one to the other threads
+                if (m_Previous.count)
+                {
+                    PublishCounts();
+                    m_Owner.PushMagazine(m_Previous);
+                }
+                m_Previous = m_Loaded;
+                m_Loaded = {};
+            }
+
+            t_FreeBlock* block = reinterpret_cast<t_FreeBlock*>(p);
+            block->next = m_Loaded.head;
+            m_Loaded.head = m_Owner.IndexOf(p);
+            ++m_Loaded.count;
+        }
+
+        // 'n' blocks at once: whole runs are taken from a magazine, refills are one pop each
+        void AllocateBulk(T** out, const size_t n, AllocationSite site = AllocationSite::current())
+        {
+            size_t i = 0;
+            while (i < n)
+            {
+                if (!m_Loaded.count)
+                {
+                    if (m_Previous.count)
+                    {
+                        std::swap(m_Loaded, m_Previous);
+                    }
+                    else
+                    {
+                        PublishCounts();
+                        m_Loaded = m_Owner.Refill();
+                        if (!m_Loaded.count)
+                        {
+                            m_Owner.m_Stats.CountFailure();
+                            if constexpr (AllocatorStats<true>::s_Enabled)
+                            {
+                                m_Counts.allocations += i;
+                            }
+                            DeallocateBulk(out, i);
+                            throw std::bad_alloc();
+                        }
+                    }
+                }
+
+                size_t run = std::min<size_t>(n - i, m_Loaded.count);
+                uint32_t index = m_Loaded.head;
+                for (size_t j = 0; j < run; ++j)
+                {
+                    t_FreeBlock* block = m_Owner.BlockAt(index);
+                    out[i++] = reinterpret_cast<T*>(block);
+                    index = block->next;
+                }
+                m_Loaded.head = index;
+                m_Loaded.count -= uint32_t(run);
+            }
+
+            if constexpr (AllocatorStats<true>::s_Enabled)
+            {
+                m_Counts.allocations += n;
+                for (size_t j = 0; j < n; ++j)
+                {
+                    m_Owner.m_Stats.TrackSite(out[j], site);
+                }
+            }
+        }
+
+        // 'n' blocks at once: each run is linked into the loaded magazine in one go, full magazines are pushed whole
+        void DeallocateBulk(T* const* in, const size_t n)
+        {
+            if constexpr (AllocatorStats<true>::s_Enabled)
+            {
+                m_Counts.deallocations += n;
+                for (size_t j = 0; j < n; ++j)
+                {
+                    m_Owner.m_Stats.ForgetSite(in[j]);
+                }
+            }
+
+            size_t i = 0;
+            while (i < n)
+            {
+                if (m_Loaded.count == m_Owner.m_MagazineSize)
+                {
+                    if (m_Previous.count)
+                    {
+                        PublishCounts();
+                        m_Owner.PushMagazine(m_Previous);
+                    }
+                    m_Previous = m_Loaded;
+                    m_Loaded = {};
+                }
+
+                size_t run = std::min<size_t>(n - i, m_Owner.m_MagazineSize - m_Loaded.count);
+                for (size_t j = i; j + 1 < i + run; ++j)
+                {
+                    reinterpret_cast<t_FreeBlock*>(in[j])->next = m_Owner.IndexOf(in[j + 1]);
+                }
+                reinterpret_cast<t_FreeBlock*>(in[i + run - 1])->next = m_Loaded.head;
+                m_Loaded.head = m_Owner.IndexOf(in[i]);
+                m_Loaded.count += uint32_t(run);
+                i += run;
+            }
+        }
+
+        // Return every cached block to the shared stack
+        void Flush()
+        {
+            PublishCounts();
+            if (m_Loaded.count)
+            {
+                m_Owner.PushMagazine(m_Loaded);
+            }
+            if (m_Previous.count)
+            {
+                m_Owner.PushMagazine(m_Previous);
+            }
+            m_Loaded = {};
+            m_Previous = {};
+        }
+    };
+
+    // 'backing' defaults to operator new and must outlive the pool
+    ConcurrentMemoryPool(const size_t block_count, const uint32_t magazine_size = 64, BackingProvider* backing = nullptr)
+        : m_Backing(backing ? backing : &HeapBacking::Instance()),
+          m_PoolBytes(0),
+          m_Pool(nullptr),
+          m_BlockCount(block_count),
+          m_MagazineSize(magazine_size ? magazine_size : 1),
+          m_Head(Pack(s_Nil, 0))
+    {
+        if (block_count >= s_Nil)
+        {
+            throw std::bad_alloc();
+        }
+
+        m_Pool = static_cast<char*>(m_Backing->AcquireBlock(s_BlockSize * block_count, s_Align, m_PoolBytes));
+        m_BlockCount = m_PoolBytes / s_BlockSize < s_Nil ? m_PoolBytes / s_BlockSize : s_Nil - 1;
+
+        // Cut the slab into full magazines and stack them up
+        for (size_t first = 0; first < m_BlockCount; first += m_MagazineSize)
+        {
+            size_t last = first + m_MagazineSize < m_BlockCount ? first + m_MagazineSize : m_BlockCount;
+            for (size_t i = first; i < last; ++i)
+            {
+                BlockAt(uint32_t(i))->next = i + 1 < last ? uint32_t(i + 1) : s_Nil;
+            }
+            PushMagazine({ uint32_t(first), uint32_t(last - first) });
+        }
+    }
+
+    ~ConcurrentMemoryPool()
+    {
+        m_Stats.ReportLeaks("ConcurrentMemoryPool");
+        m_Backing->ReleaseBlock(m_Pool, m_PoolBytes, s_Align);
+    }
+
+    ConcurrentMemoryPool(const ConcurrentMemoryPool&) = delete;
+    ConcurrentMemoryPool& operator=(const ConcurrentMemoryPool&) = delete;
+
+    /*
+		Slow path for threads without a cache. Single blocks come from and go to
+		the spill under a lock, so mixing this path with ThreadCaches doesn't
+		leave one block magazines on the stack for their refills to pop
+	*/
+    T* Allocate(AllocationSite site = AllocationSite::current())
+    {
+        T* p = TryAllocate(site);
+        if (!p)
+        {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    // Same as Allocate() but returns nullptr when the pool is empty
+    T* TryAllocate(AllocationSite site = AllocationSite::current())
+    {
+        t_FreeBlock* block;
+        {
+            std::lock_guard<std::mutex> guard(m_SpillLock);
+            if (!m_Spill.count)
+            {
+                m_Spill = PopMagazine();
+                if (!m_Spill.count)
+                {
+                    m_Stats.CountFailure();
+                    return nullptr;
+                }
+            }
+            block = BlockAt(m_Spill.head);
+            m_Spill.head = block->next;
+            --m_Spill.count;
+        }
+        m_Stats.OnAllocate(block, site);
+        return reinterpret_cast<T*>(block);
+    }
+
+    void Deallocate(T* p)
+    {
+        m_Stats.OnDeallocate(p);
+        std::lock_guard<std::mutex> guard(m_SpillLock);
+        if (m_Spill.count == m_MagazineSize)
+        {
+            PushMagazine(m_Spill);
+            m_Spill = {};
+        }
+        t_FreeBlock* block = reinterpret_cast<t_FreeBlock*>(p);
+        block->next = m_Spill.head;
+        m_Spill.head = IndexOf(p);
+        ++m_Spill.count;
+    }
+
+    // True if 'p' points into this pool's slab
+    bool Owns(const void* p) const
+    {
+        const char* address = static_cast<const char*>(p);
+        return !std::less<const char*>()(address, m_Pool)
+            && std::less<const char*>()(address, m_Pool + m_BlockCount * s_BlockSize);
+    }
+
+    uint32_t MagazineSize() const { return m_MagazineSize; }
+
+    struct StackShape
+    {
+        size_t magazines = 0;
+        size_t blocks = 0;
+    };
+
+    // What the shared stack holds: with full magazines, blocks / magazines is MagazineSize(). Only exact while no thread uses the pool
+    StackShape SharedStack() const
+    {
+        StackShape shape;
+        for (uint32_t index = IndexOf(m_Head.load(std::memory_order_acquire)); index != s_Nil;
+             index = std::atomic_ref<uint32_t>(BlockAt(index)->nextBatch).load(std::memory_order_relaxed))
+        {
+            ++shape.magazines;
+            shape.blocks += BlockAt(index)->count;
+        }
+        return shape;
+    }
+
+    // All zero unless built with ALLOCATOR_STATS; blocks cached by live ThreadCaches are counted per magazine
+    AllocatorStatsSnapshot Stats() const { return m_Stats.Snapshot(); }
+};
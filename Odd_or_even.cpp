@@ -1,14 +1,42 @@
 // Checking if a number is even or odd (Fastest way)
+// ( parity, popcount, powers of two, PEXT / PDEP and other bit tricks: Bit_tricks.h, benchmarked in Bit_tricks.cpp )
 #include <iostream>
+#include <vector>
+#include "Benchmark.h"
 using namespace std;
 
-int main()
+int main(int argc, char** argv)
 {
 	int x = 5;
 	if (x & 1)
 		cout << "Odd";
 	else
 		cout << "Even";
+	cout << "\n\n";
+
+	// Same check over many numbers: x & 1 against x % 2 (for signed ints % also has to handle negatives)
+	vector<int> numbers(10'000'000);
+	for (size_t i = 0; i < numbers.size(); i++)
+		numbers[i] = int(i * 2654435761u);
+
+	Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+	bench.Run("x & 1", [&]()
+	{
+		size_t odd = 0;
+		for (int n : numbers)
+			odd += n & 1;
+		DoNotOptimize(odd);
+	}, numbers.size());
+
+	bench.Run("x % 2 != 0", [&]()
+	{
+		size_t odd = 0;
+		for (int n : numbers)
+			odd += n % 2 != 0;
+		DoNotOptimize(odd);
+	}, numbers.size());
+
+	bench.Report();
 
 	return 0;
 }
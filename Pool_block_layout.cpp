@@ -0,0 +1,82 @@
+// False sharing between threads that own neighbouring MemoryPool blocks, and how PoolLayout fixes it
+#include <iostream>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+#include "Memory_pool.h"
+
+// A per thread counter, 8 bytes: eight of them fit in one cache line
+struct Counter
+{
+    uint64_t value;
+};
+
+constexpr size_t INCREMENTS = 20'000'000;
+
+/*
+	Blocks are allocated back to back from one pool and block i is handed to
+	thread i, which then hammers it. With the default layout the counters of
+	up to eight threads share a cache line and the line ping-pongs between
+	cores on every write.
+*/
+template<typename Layout>
+void TestConcurrentWriters(Benchmark& bench, const std::string& name, const size_t thread_count)
+{
+    MemoryPool<Counter, Layout> pool(thread_count);
+    std::vector<Counter*> counters;
+    for (size_t t = 0; t < thread_count; t++)
+	{
+		counters.push_back(pool.Allocate());
+		counters.back()->value = 0;
+	}
+
+    bench.Run(name + " x" + std::to_string(thread_count) + " threads", [&]()
+    {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_count; t++)
+		{
+			threads.emplace_back([counter = counters[t]]()
+			{
+				// Relaxed atomic store keeps the compiler from collapsing the loop into one add
+				std::atomic_ref<uint64_t> value(counter->value);
+				for (size_t i = 0; i < INCREMENTS; i++)
+				{
+					value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				}
+			});
+		}
+        for (auto& thread : threads)
+		{
+			thread.join();
+		}
+    }, INCREMENTS * thread_count);
+
+    for (auto counter : counters)
+	{
+		pool.Deallocate(counter);
+	}
+}
+
+int main(int argc, char** argv)
+{
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+    const size_t max_threads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+
+    // Padded to 72 bytes and colored, mainly to show the knobs; 64 byte alignment is what matters here
+    using PaddedLayout = PoolLayout<64, 8, 4>;
+
+    for (size_t threads = 1; threads <= max_threads;
+         threads = (threads < max_threads && threads * 2 > max_threads) ? max_threads : threads * 2)
+    {
+        TestConcurrentWriters<DefaultLayout>(bench, "packed (8 B stride)", threads);
+        TestConcurrentWriters<CacheLineLayout>(bench, "cache line aligned", threads);
+        TestConcurrentWriters<PaddedLayout>(bench, "aligned + padded", threads);
+    }
+
+    bench.Report();
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Checked build mode for MemoryPool: byte patterns, canaries, corruption reports and ASan hooks
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+	Build with -DMEMORY_POOL_CHECKS=1 to validate every pool operation:
+
+	- Deallocate() checks that the pointer points at the start of a block
+	  of this pool, and a bitmap of free blocks catches double frees
+	- free blocks are filled with 0xDD, and the pattern is verified when
+	  the block is handed out again (writes through a dangling pointer)
+	- a 16 byte canary right after every live object catches writes past
+	  its end; it is verified on Deallocate()
+	- fresh blocks are filled with 0xCD, so reads of uninitialized memory
+	  stand out in a debugger
+
+	Any violation prints what happened and the address, then aborts.
+
+	Independently of that, builds with AddressSanitizer (-fsanitize=address)
+	poison free blocks and the space after every live object, so ASan
+	reports the bad access itself, at the instruction that made it.
+
+	Without either, all hooks compile to nothing and Allocate() / Deallocate()
+	stay a couple of instructions.
+*/
+#if !defined(MEMORY_POOL_CHECKS)
+#define MEMORY_POOL_CHECKS 0
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+#define MEMORY_POOL_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define MEMORY_POOL_ASAN 1
+#endif
+#endif
+
+#if !defined(MEMORY_POOL_ASAN)
+#define MEMORY_POOL_ASAN 0
+#endif
+
+#if MEMORY_POOL_ASAN
+#include <sanitizer/asan_interface.h>
+#endif
+
+struct PoolChecks
+{
+    static constexpr bool s_Enabled = MEMORY_POOL_CHECKS;
+    static constexpr bool s_Asan = MEMORY_POOL_ASAN;
+
+    static constexpr unsigned char s_FreePattern = 0xDD;  // Block is on the free list
+    static constexpr unsigned char s_FreshPattern = 0xCD; // Handed out, not written yet
+    static constexpr unsigned char s_CanaryPattern = 0xFD;
+    static constexpr size_t s_CanarySize = 16;
+
+    // ASan: accesses to a poisoned range are reported until it is unpoisoned
+    static void Poison([[maybe_unused]] const void* p, [[maybe_unused]] size_t bytes)
+    {
+#if MEMORY_POOL_ASAN
+        ASAN_POISON_MEMORY_REGION(p, bytes);
+#endif
+    }
+
+    static void Unpoison([[maybe_unused]] const void* p, [[maybe_unused]] size_t bytes)
+    {
+#if MEMORY_POOL_ASAN
+        ASAN_UNPOISON_MEMORY_REGION(p, bytes);
+#endif
+    }
+
+    static bool Holds(const void* p, unsigned char pattern, size_t bytes)
+    {
+        const unsigned char* bytes_ptr = static_cast<const unsigned char*>(p);
+        for (size_t i = 0; i < bytes; ++i)
+        {
+            if (bytes_ptr[i] != pattern)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    [[noreturn]] static void Fail(const char* owner, const char* what, const void* p)
+    {
+        std::fprintf(stderr, "%s: %s (block %p)\n", owner, what, p);
+        std::abort();
+    }
+};
@@ -0,0 +1,101 @@
+// Constructed objects from a MemoryPool: Make / Destroy, unique_ptr and shared_ptr instead of new
+#include <iostream>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "Memory_pool.h"
+
+// Not trivially constructible: Allocate() alone would hand out garbage here
+struct Order
+{
+    uint64_t id;
+    double price;
+    std::string symbol;
+
+    Order(uint64_t order_id, double order_price, const char* order_symbol)
+        : id(order_id), price(order_price), symbol(order_symbol)
+    {
+    }
+};
+
+constexpr size_t ORDER_COUNT = 1'000'000;
+
+// Create every order, keep them alive together, then drop them all
+template<typename Ptr, typename Factory>
+void CreateAndDrop(Factory&& make)
+{
+    std::vector<Ptr> orders;
+    orders.reserve(ORDER_COUNT);
+    for (size_t i = 0; i < ORDER_COUNT; i++)
+	{
+		orders.push_back(make(i));
+	}
+    DoNotOptimize(orders.data());
+}
+
+int main(int argc, char** argv)
+{
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+
+    bench.Run("new / delete", [&]()
+    {
+        std::vector<Order*> orders;
+        orders.reserve(ORDER_COUNT);
+        for (size_t i = 0; i < ORDER_COUNT; i++)
+		{
+			orders.push_back(new Order(i, 1.5 * i, "ABC"));
+		}
+        DoNotOptimize(orders.data());
+        for (Order* order : orders)
+		{
+			delete order;
+		}
+    }, ORDER_COUNT);
+
+    MemoryPool<Order> pool(ORDER_COUNT);
+    bench.Run("pool.Make / Destroy", [&]()
+    {
+        std::vector<Order*> orders;
+        orders.reserve(ORDER_COUNT);
+        for (size_t i = 0; i < ORDER_COUNT; i++)
+		{
+			orders.push_back(pool.Make(i, 1.5 * i, "ABC"));
+		}
+        DoNotOptimize(orders.data());
+        for (Order* order : orders)
+		{
+			pool.Destroy(order);
+		}
+    }, ORDER_COUNT);
+
+    bench.Run("std::make_unique", [&]()
+    {
+        CreateAndDrop<std::unique_ptr<Order>>([](size_t i) { return std::make_unique<Order>(i, 1.5 * i, "ABC"); });
+    }, ORDER_COUNT);
+
+    bench.Run("pool.MakeUnique", [&]()
+    {
+        CreateAndDrop<MemoryPool<Order>::UniquePtr>([&](size_t i) { return pool.MakeUnique(i, 1.5 * i, "ABC"); });
+    }, ORDER_COUNT);
+
+    // Object and control block in one allocation either way, only where it comes from changes
+    SharedObjectPool<Order> shared_pool(ORDER_COUNT);
+    bench.Run("std::make_shared", [&]()
+    {
+        CreateAndDrop<std::shared_ptr<Order>>([](size_t i) { return std::make_shared<Order>(i, 1.5 * i, "ABC"); });
+    }, ORDER_COUNT);
+
+    bench.Run("SharedObjectPool::Make", [&]()
+    {
+        CreateAndDrop<std::shared_ptr<Order>>([&](size_t i) { return shared_pool.Make(i, 1.5 * i, "ABC"); });
+    }, ORDER_COUNT);
+
+    bench.Report();
+
+    // The pools sized in the constructor were enough, nothing grew
+    std::cout << "\nPool blocks: " << pool.BlockCount() << ", shared pool blocks: " << shared_pool.BlockCount() << "\n";
+
+    return 0;
+}
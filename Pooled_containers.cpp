@@ -0,0 +1,214 @@
+// LRU cache under Zipfian access, work queue churn and list erase: pooled intrusive nodes against std::list / std::unordered_map
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Auto_array.h"
+#include "Benchmark.h"
+#include "Fast_random.h"
+#include "Pooled_containers.h"
+
+constexpr size_t KEY_COUNT = 1'000'000;
+constexpr size_t CACHE_CAPACITY = 50'000;
+constexpr size_t ACCESS_COUNT = 5'000'000;
+constexpr double ZIPF_EXPONENT = 0.99; // Like the YCSB benchmark: a few keys take most of the accesses
+
+/*
+	Key number k (1-based) is drawn with probability proportional to
+	1 / k^s. The cumulative table is searched with a uniform number; the
+	keys are then scrambled so the popular ones aren't neighbours.
+*/
+AutoArray<uint64_t> ZipfTrace(size_t keys, size_t count, double exponent, uint64_t seed)
+{
+    AutoArray<double> cumulative(keys);
+    double total = 0;
+    for (size_t k = 0; k < keys; k++)
+	{
+		total += 1.0 / std::pow(double(k + 1), exponent);
+		cumulative[k] = total;
+	}
+
+    Xoshiro256StarStar engine(seed);
+    AutoArray<uint64_t> trace(count);
+    for (uint64_t& key : trace)
+	{
+		size_t rank = size_t(std::lower_bound(cumulative.begin(), cumulative.end(), RandomDouble(engine) * total) - cumulative.begin());
+		key = uint64_t(std::min(rank, keys - 1)) * 0x9E3779B97F4A7C15;
+	}
+    return trace;
+}
+
+// The usual LRU: recency list of entries plus a map from key to list position
+class ClassicLru
+{
+    using t_Order = std::list<std::pair<uint64_t, uint64_t>>;
+
+    size_t m_Capacity;
+    t_Order m_Order;
+    std::unordered_map<uint64_t, t_Order::iterator> m_Index;
+
+public:
+    explicit ClassicLru(size_t capacity) : m_Capacity(capacity) { m_Index.reserve(capacity); }
+
+    uint64_t* Get(uint64_t key)
+    {
+        auto it = m_Index.find(key);
+        if (it == m_Index.end())
+			return nullptr;
+        m_Order.splice(m_Order.begin(), m_Order, it->second);
+        return &it->second->second;
+    }
+
+    void Put(uint64_t key, uint64_t value)
+    {
+        if (m_Order.size() == m_Capacity)
+        {
+            m_Index.erase(m_Order.back().first);
+            m_Order.pop_back();
+        }
+        m_Order.emplace_front(key, value);
+        m_Index.emplace(key, m_Order.begin());
+    }
+};
+
+// Read-through: a miss "loads" the value and puts it in the cache
+template<typename Cache>
+size_t Replay(Cache& cache, const AutoArray<uint64_t>& trace)
+{
+    size_t hits = 0;
+    for (uint64_t key : trace)
+	{
+		if (cache.Get(key))
+			++hits;
+		else
+			cache.Put(key, key >> 3);
+	}
+    return hits;
+}
+
+// A small job, moved through the queue by value
+struct Task
+{
+    uint64_t id;
+    uint64_t payload[3];
+};
+
+// Producer/consumer churn around a steady depth: bursts of pushes, then as many pops
+template<typename Queue>
+uint64_t QueueChurn(Queue& queue, const AutoArray<uint32_t>& bursts)
+{
+    uint64_t total = 0, id = 0;
+    for (uint32_t burst : bursts)
+	{
+		for (uint32_t i = 0; i < burst; i++)
+			queue.push(Task{ id++, { 1, 2, 3 } });
+		for (uint32_t i = 0; i < burst; i++)
+		{
+			total += queue.front().id;
+			queue.pop();
+		}
+	}
+    return total;
+}
+
+int main(int argc, char** argv)
+{
+    AutoArray<uint64_t> trace = ZipfTrace(KEY_COUNT, ACCESS_COUNT, ZIPF_EXPONENT, 42);
+
+    BenchmarkOptions defaults;
+    defaults.repetitions = 5;
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv, defaults));
+
+    // A fresh cache per run: the misses of the cold start are part of the workload
+    size_t classic_hits = 0, pooled_hits = 0;
+    bench.Run("LRU: std::list + std::unordered_map", [&]()
+    {
+        ClassicLru cache(CACHE_CAPACITY);
+        classic_hits = Replay(cache, trace);
+        DoNotOptimize(classic_hits);
+    }, ACCESS_COUNT);
+
+    bench.Run("LRU: LruCache (MemoryPool + FlatHashMap)", [&]()
+    {
+        LruCache<uint64_t, uint64_t> cache(CACHE_CAPACITY);
+        pooled_hits = Replay(cache, trace);
+        DoNotOptimize(pooled_hits);
+    }, ACCESS_COUNT);
+
+    std::cout << "Zipf(" << ZIPF_EXPONENT << ") over " << KEY_COUNT << " keys, " << CACHE_CAPACITY << " entries: hit rate "
+              << 100.0 * double(pooled_hits) / ACCESS_COUNT << "% (std::list version: "
+              << 100.0 * double(classic_hits) / ACCESS_COUNT << "%)\n\n";
+
+    /*
+		Work queue: 1 to 64 tasks in flight at a time. std::deque isn't node
+		based (it stores blocks of elements) and stays ahead of any linked
+		queue; PooledQueue is for tasks that must keep their address while
+		queued, or that intrusive lists elsewhere point to.
+	*/
+    constexpr size_t BURST_COUNT = 200'000;
+    AutoArray<uint32_t> bursts(BURST_COUNT);
+    Xoshiro256StarStar engine(7);
+    uint64_t tasks = 0;
+    for (uint32_t& burst : bursts)
+	{
+		burst = RandomInt(engine, 1u, 64u);
+		tasks += burst;
+	}
+
+    bench.Run("queue: std::queue<Task, std::list<Task>>", [&]()
+    {
+        std::queue<Task, std::list<Task>> queue;
+        DoNotOptimize(QueueChurn(queue, bursts));
+    }, tasks);
+
+    bench.Run("queue: std::queue<Task> (std::deque)", [&]()
+    {
+        std::queue<Task> queue;
+        DoNotOptimize(QueueChurn(queue, bursts));
+    }, tasks);
+
+    bench.Run("queue: PooledQueue<Task>", [&]()
+    {
+        PooledQueue<Task> queue(64);
+        DoNotOptimize(QueueChurn(queue, bursts));
+    }, tasks);
+
+    // List: fill, erase every other element through saved positions, refill
+    constexpr size_t LIST_COUNT = 1'000'000;
+    bench.Run("list: std::list fill, erase half, refill", [&]()
+    {
+        std::list<Task> list;
+        std::vector<std::list<Task>::iterator> positions;
+        positions.reserve(LIST_COUNT);
+        for (uint64_t i = 0; i < LIST_COUNT; i++)
+			positions.push_back(list.insert(list.end(), Task{ i, { 0, 0, 0 } }));
+        for (size_t i = 0; i < LIST_COUNT; i += 2)
+			list.erase(positions[i]);
+        for (uint64_t i = 0; i < LIST_COUNT / 2; i++)
+			list.push_front(Task{ i, { 0, 0, 0 } });
+        DoNotOptimize(list.size());
+    }, 2 * LIST_COUNT);
+
+    bench.Run("list: PooledList fill, erase half, refill", [&]()
+    {
+        PooledList<Task> list(LIST_COUNT);
+        std::vector<PooledList<Task>::iterator> positions;
+        positions.reserve(LIST_COUNT);
+        for (uint64_t i = 0; i < LIST_COUNT; i++)
+			positions.push_back(list.insert(list.end(), Task{ i, { 0, 0, 0 } }));
+        for (size_t i = 0; i < LIST_COUNT; i += 2)
+			list.erase(positions[i]);
+        for (uint64_t i = 0; i < LIST_COUNT / 2; i++)
+			list.push_front(Task{ i, { 0, 0, 0 } });
+        DoNotOptimize(list.size());
+    }, 2 * LIST_COUNT);
+
+    bench.Report();
+    return 0;
+}
@@ -0,0 +1,523 @@
+// Intrusive doubly linked list, and a list, FIFO queue and LRU cache whose nodes come from a MemoryPool
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include "Flat_hash_map.h"
+#include "Memory_pool.h"
+
+/*
+	std::list, std::queue<T, std::list<T>> and the classic LRU cache
+	(std::list of entries + std::unordered_map of list iterators) call
+	operator new for every element they add and operator delete for every
+	one they drop. These take their nodes from a MemoryPool instead, so an
+	insert or an erase is a free list pop or push.
+
+	IntrusiveList<T>   links elements that derive from ListHook: the links
+	                   live in the element, the list allocates nothing and
+	                   can unlink or move an element in O(1) given only a
+	                   reference to it. It doesn't own the elements
+	PooledList<T>      owning list, nodes (links + T) from a growable pool
+	PooledQueue<T>     FIFO on a PooledList
+	LruCache<K, V>     fixed capacity, least recently used entry evicted
+	                   first. Entries come from a pool of exactly
+	                   'capacity' blocks and are indexed by a FlatHashMap
+	                   of entry pointers, so a lookup is one probe and a
+	                   hit relinks the entry to the front
+
+	None of them are copyable or movable: the list head is a sentinel node
+	inside the object that the first and last element point to.
+*/
+
+// The two links an element needs to be in an IntrusiveList; derive from it
+struct ListHook
+{
+    ListHook* prev = nullptr;
+    ListHook* next = nullptr;
+
+    bool IsLinked() const { return next != nullptr; }
+};
+
+template<typename T>
+class IntrusiveList
+{
+    static_assert(std::is_base_of_v<ListHook, T>, "IntrusiveList: T must derive from ListHook");
+
+    ListHook m_Head; // Sentinel: m_Head.next is the front, m_Head.prev the back
+    size_t m_Size = 0;
+
+    static void LinkBefore(ListHook* position, ListHook* hook)
+    {
+        hook->prev = position->prev;
+        hook->next = position;
+        position->prev->next = hook;
+        position->prev = hook;
+    }
+
+    static void Unlink(ListHook* hook)
+    {
+        hook->prev->next = hook->next;
+        hook->next->prev = hook->prev;
+        hook->prev = nullptr;
+        hook->next = nullptr;
+    }
+
+    template<bool Const>
+    class t_Iterator
+    {
+        friend class IntrusiveList;
+        template<bool>
+        friend class t_Iterator;
+        using t_Hook = std::conditional_t<Const, const ListHook, ListHook>;
+
+        t_Hook* m_Hook = nullptr;
+
+        explicit t_Iterator(t_Hook* hook) : m_Hook(hook) {}
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+
+        t_Iterator() = default;
+
+        // iterator -> const_iterator
+        template<bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+        t_Iterator(const t_Iterator<OtherConst>& other) : m_Hook(other.m_Hook)
+        {
+        }
+
+        reference operator*() const { return static_cast<reference>(*m_Hook); }
+        pointer operator->() const { return static_cast<pointer>(m_Hook); }
+
+        t_Iterator& operator++()
+        {
+            m_Hook = m_Hook->next;
+            return *this;
+        }
+
+        t_Iterator& operator--()
+        {
+            m_Hook = m_Hook->prev;
+            return *this;
+        }
+
+        t_Iterator operator++(int)
+        {
+            t_Iterator copy = *this;
+            m_Hook = m_Hook->next;
+            return copy;
+        }
+
+        t_Iterator operator--(int)
+        {
+            t_Iterator copy = *this;
+            m_Hook = m_Hook->prev;
+            return copy;
+        }
+
+        bool operator==(const t_Iterator& other) const { return m_Hook == other.m_Hook; }
+    };
+
+public:
+    using iterator = t_Iterator<false>;
+    using const_iterator = t_Iterator<true>;
+
+    IntrusiveList()
+    {
+        m_Head.prev = &m_Head;
+        m_Head.next = &m_Head;
+    }
+
+    // The elements stay where they are, only unlinked
+    ~IntrusiveList() { clear(); }
+
+    IntrusiveList(const IntrusiveList&) = delete;
+    IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+    size_t size() const { return m_Size; }
+    bool empty() const { return m_Size == 0; }
+
+    iterator begin() { return iterator(m_Head.next); }
+    iterator end() { return iterator(&m_Head); }
+    const_iterator begin() const { return const_iterator(m_Head.next); }
+    const_iterator end() const { return const_iterator(&m_Head); }
+
+    // The list must not be empty
+    T& front() { return static_cast<T&>(*m_Head.next); }
+    T& back() { return static_cast<T&>(*m_Head.prev); }
+    const T& front() const { return static_cast<const T&>(*m_Head.next); }
+    const T& back() const { return static_cast<const T&>(*m_Head.prev); }
+
+    // 'element' must not be in a list already
+    void push_front(T& element) { insert(begin(), element); }
+    void push_back(T& element) { insert(end(), element); }
+
+    iterator insert(const_iterator position, T& element)
+    {
+        LinkBefore(const_cast<ListHook*>(position.m_Hook), &element);
+        ++m_Size;
+        return iterator(&element);
+    }
+
+    void pop_front() { erase(front()); }
+    void pop_back() { erase(back()); }
+
+    // Unlink 'element', which must be in this list; returns the element after it
+    iterator erase(T& element)
+    {
+        ListHook* next = element.next;
+        Unlink(&element);
+        --m_Size;
+        return iterator(next);
+    }
+
+    iterator erase(const_iterator position) { return erase(const_cast<T&>(*position)); }
+
+    // Relink an element of this list in O(1), e.g. on every hit of an LRU cache
+    void MoveToFront(T& element)
+    {
+        if (m_Head.next != &element)
+        {
+            Unlink(&element);
+            LinkBefore(m_Head.next, &element);
+        }
+    }
+
+    void MoveToBack(T& element)
+    {
+        if (m_Head.prev != &element)
+        {
+            Unlink(&element);
+            LinkBefore(&m_Head, &element);
+        }
+    }
+
+    void clear()
+    {
+        while (m_Size)
+			pop_front();
+    }
+};
+
+/*
+	std::list-like list whose nodes (two links + T) come from a MemoryPool.
+	The pool starts with 'initial_nodes' blocks and grows as 'growth' says
+	(Geometric by default), so after warming up to its peak size the list
+	never calls the allocator again; freed nodes go back to the pool's free
+	list and are reused by the next insert.
+*/
+template<typename T, typename Layout = DefaultLayout>
+class PooledList
+{
+    struct t_Node : ListHook
+    {
+        T value;
+
+        template<typename... Args>
+        explicit t_Node(Args&&... args) : value(std::forward<Args>(args)...)
+        {
+        }
+    };
+
+    using t_Links = IntrusiveList<t_Node>;
+
+    MemoryPool<t_Node, Layout> m_Pool;
+    t_Links m_List;
+
+    template<bool Const>
+    class t_Iterator
+    {
+        friend class PooledList;
+        template<bool>
+        friend class t_Iterator;
+        using t_Position = std::conditional_t<Const, typename t_Links::const_iterator, typename t_Links::iterator>;
+
+        t_Position m_Position;
+
+        explicit t_Iterator(t_Position position) : m_Position(position) {}
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const T*, T*>;
+        using reference = std::conditional_t<Const, const T&, T&>;
+
+        t_Iterator() = default;
+
+        template<bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+        t_Iterator(const t_Iterator<OtherConst>& other) : m_Position(other.m_Position)
+        {
+        }
+
+        reference operator*() const { return m_Position->value; }
+        pointer operator->() const { return &m_Position->value; }
+
+        t_Iterator& operator++()
+        {
+            ++m_Position;
+            return *this;
+        }
+
+        t_Iterator& operator--()
+        {
+            --m_Position;
+            return *this;
+        }
+
+        t_Iterator operator++(int) { return t_Iterator(m_Position++); }
+        t_Iterator operator--(int) { return t_Iterator(m_Position--); }
+
+        bool operator==(const t_Iterator& other) const { return m_Position == other.m_Position; }
+    };
+
+public:
+    using value_type = T;
+    using iterator = t_Iterator<false>;
+    using const_iterator = t_Iterator<true>;
+
+    // 'backing' defaults to operator new and must outlive the list
+    explicit PooledList(const size_t initial_nodes = 1024,
+                        const PoolGrowth growth = PoolGrowth::Geometric,
+                        BackingProvider* backing = nullptr)
+        : m_Pool(initial_nodes, growth, 0, backing)
+    {
+    }
+
+    ~PooledList() { clear(); }
+
+    PooledList(const PooledList&) = delete;
+    PooledList& operator=(const PooledList&) = delete;
+
+    size_t size() const { return m_List.size(); }
+    bool empty() const { return m_List.empty(); }
+
+    iterator begin() { return iterator(m_List.begin()); }
+    iterator end() { return iterator(m_List.end()); }
+    const_iterator begin() const { return const_iterator(m_List.begin()); }
+    const_iterator end() const { return const_iterator(m_List.end()); }
+
+    T& front() { return m_List.front().value; }
+    T& back() { return m_List.back().value; }
+    const T& front() const { return m_List.front().value; }
+    const T& back() const { return m_List.back().value; }
+
+    template<typename... Args>
+    iterator emplace(const_iterator position, Args&&... args)
+    {
+        t_Node* node = m_Pool.Make(std::forward<Args>(args)...);
+        return iterator(m_List.insert(position.m_Position, *node));
+    }
+
+    template<typename... Args>
+    T& emplace_back(Args&&... args)
+    {
+        return *emplace(end(), std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    T& emplace_front(Args&&... args)
+    {
+        return *emplace(begin(), std::forward<Args>(args)...);
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(std::move(value)); }
+    void push_front(const T& value) { emplace_front(value); }
+    void push_front(T&& value) { emplace_front(std::move(value)); }
+
+    iterator insert(const_iterator position, const T& value) { return emplace(position, value); }
+    iterator insert(const_iterator position, T&& value) { return emplace(position, std::move(value)); }
+
+    // The node goes back to the pool; iterators to other elements stay valid
+    iterator erase(const_iterator position)
+    {
+        t_Node& node = const_cast<t_Node&>(*position.m_Position);
+        iterator next(m_List.erase(node));
+        m_Pool.Destroy(&node);
+        return next;
+    }
+
+    void pop_front() { erase(begin()); }
+    void pop_back() { erase(const_iterator(--end())); }
+
+    // Relink without touching the pool
+    void MoveToFront(const_iterator position) { m_List.MoveToFront(const_cast<t_Node&>(*position.m_Position)); }
+    void MoveToBack(const_iterator position) { m_List.MoveToBack(const_cast<t_Node&>(*position.m_Position)); }
+
+    void clear()
+    {
+        while (!m_List.empty())
+			pop_front();
+    }
+
+    // All zero unless built with ALLOCATOR_STATS
+    AllocatorStatsSnapshot Stats() const { return m_Pool.Stats(); }
+};
+
+// First in, first out on a PooledList: a push takes a node from the pool, a pop gives it back
+template<typename T, typename Layout = DefaultLayout>
+class PooledQueue
+{
+    PooledList<T, Layout> m_List;
+
+public:
+    using value_type = T;
+
+    explicit PooledQueue(const size_t initial_nodes = 1024,
+                         const PoolGrowth growth = PoolGrowth::Geometric,
+                         BackingProvider* backing = nullptr)
+        : m_List(initial_nodes, growth, backing)
+    {
+    }
+
+    size_t size() const { return m_List.size(); }
+    bool empty() const { return m_List.empty(); }
+
+    T& front() { return m_List.front(); }
+    T& back() { return m_List.back(); }
+    const T& front() const { return m_List.front(); }
+    const T& back() const { return m_List.back(); }
+
+    void push(const T& value) { m_List.push_back(value); }
+    void push(T&& value) { m_List.push_back(std::move(value)); }
+
+    template<typename... Args>
+    T& emplace(Args&&... args)
+    {
+        return m_List.emplace_back(std::forward<Args>(args)...);
+    }
+
+    void pop() { m_List.pop_front(); }
+
+    AllocatorStatsSnapshot Stats() const { return m_List.Stats(); }
+};
+
+/*
+	LruCache<Key, Value>: at most 'capacity' entries, the least recently
+	used one is evicted when a new key is put into a full cache.
+
+	Get() and Put() are one FlatHashMap probe plus a relink to the front of
+	the recency list. The pool is sized to the capacity once and never
+	grows: an eviction hands its block back right before the new entry
+	takes it, and the index was reserved for 'capacity' keys up front.
+
+	Pointers returned by Get() / Put() stay valid until that entry is
+	evicted or erased.
+*/
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+class LruCache
+{
+    struct t_Entry : ListHook
+    {
+        Key key;
+        Value value;
+
+        template<typename K, typename V>
+        t_Entry(K&& entry_key, V&& entry_value) : key(std::forward<K>(entry_key)), value(std::forward<V>(entry_value))
+        {
+        }
+    };
+
+    size_t m_Capacity;
+    MemoryPool<t_Entry> m_Pool;
+    IntrusiveList<t_Entry> m_Order; // Front: most recently used
+    FlatHashMap<Key, t_Entry*, Hash, Equal> m_Index;
+
+    void Evict()
+    {
+        t_Entry& oldest = m_Order.back();
+        m_Index.erase(oldest.key);
+        m_Order.erase(oldest);
+        m_Pool.Destroy(&oldest);
+    }
+
+public:
+    explicit LruCache(const size_t capacity, BackingProvider* backing = nullptr)
+        : m_Capacity(capacity ? capacity : 1), m_Pool(m_Capacity, PoolGrowth::None, 0, backing)
+    {
+        m_Index.reserve(m_Capacity);
+    }
+
+    ~LruCache() { clear(); }
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+    size_t size() const { return m_Order.size(); }
+    size_t capacity() const { return m_Capacity; }
+    bool empty() const { return m_Order.empty(); }
+
+    // The cached value, now the most recently used, or nullptr
+    Value* Get(const Key& key)
+    {
+        auto it = m_Index.find(key);
+        if (it == m_Index.end())
+			return nullptr;
+        m_Order.MoveToFront(*it->second);
+        return &it->second->value;
+    }
+
+    // Same without touching the recency order
+    const Value* Peek(const Key& key) const
+    {
+        auto it = m_Index.find(key);
+        return it == m_Index.end() ? nullptr : &it->second->value;
+    }
+
+    bool Contains(const Key& key) const { return m_Index.contains(key); }
+
+    // Insert or overwrite; the entry becomes the most recently used
+    template<typename V>
+    Value& Put(const Key& key, V&& value)
+    {
+        auto it = m_Index.find(key);
+        if (it != m_Index.end())
+        {
+            it->second->value = std::forward<V>(value);
+            m_Order.MoveToFront(*it->second);
+            return it->second->value;
+        }
+
+        if (m_Order.size() == m_Capacity)
+			Evict();
+        t_Entry* entry = m_Pool.Make(key, std::forward<V>(value));
+        m_Order.push_front(*entry);
+        m_Index.try_emplace(entry->key, entry);
+        return entry->value;
+    }
+
+    bool Erase(const Key& key)
+    {
+        auto it = m_Index.find(key);
+        if (it == m_Index.end())
+			return false;
+        t_Entry* entry = it->second;
+        m_Index.erase(it);
+        m_Order.erase(*entry);
+        m_Pool.Destroy(entry);
+        return true;
+    }
+
+    // Least recently used first, e.g. to write a cache back in eviction order
+    template<typename Function>
+    void ForEachOldestFirst(Function&& f) const
+    {
+        for (auto it = m_Order.end(); it != m_Order.begin();)
+        {
+            --it;
+            f(it->key, it->value);
+        }
+    }
+
+    void clear()
+    {
+        while (!m_Order.empty())
+			Evict();
+    }
+};
@@ -0,0 +1,306 @@
+// Passing messages between threads: mutex + std::deque against SpscRing and MpmcRing, payloads from new/delete or a shared pool
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Asm_kernels.h"
+#include "Benchmark.h"
+#include "Memory_pool.h"
+#include "Ring_buffer.h"
+
+constexpr size_t MESSAGE_COUNT = 1 << 20;
+constexpr size_t RING_CAPACITY = 1024;
+constexpr size_t BATCH_SIZE = 32;
+constexpr uint64_t LATENCY_EVERY = 64; // Consumers time one message in 64
+
+// One cache line: a sequence number, the cycle counter when it was sent, and some payload
+struct Message
+{
+    uint64_t sequence;
+    uint64_t sentTicks;
+    uint64_t payload[6];
+};
+
+/*
+	Every queue below is used through the same two blocking calls:
+	SendBatch() hands over 'count' messages, ReceiveBatch() waits for at
+	least one and takes up to 'count'. A null message tells a consumer to stop.
+*/
+class LockedQueue
+{
+    std::mutex m_Mutex;
+    std::condition_variable m_NotEmpty;
+    std::deque<Message*> m_Queue;
+
+public:
+    void SendBatch(Message* const* messages, size_t count)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Queue.insert(m_Queue.end(), messages, messages + count);
+        }
+        if (count == 1)
+			m_NotEmpty.notify_one();
+        else
+			m_NotEmpty.notify_all();
+    }
+
+    size_t ReceiveBatch(Message** out, size_t count)
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_NotEmpty.wait(lock, [&]() { return !m_Queue.empty(); });
+        count = std::min(count, m_Queue.size());
+        std::copy_n(m_Queue.begin(), count, out);
+        m_Queue.erase(m_Queue.begin(), m_Queue.begin() + count);
+        return count;
+    }
+};
+
+// SpscRing or MpmcRing of message pointers: single messages go through Push / Pop, batches through PushBatch / PopBatch
+template<typename Ring>
+class RingQueue
+{
+    Ring m_Ring{ RING_CAPACITY };
+
+public:
+    void SendBatch(Message* const* messages, size_t count)
+    {
+        if (count == 1)
+		{
+			m_Ring.Push(*messages);
+			return;
+		}
+
+        SpinBackoff backoff;
+        while (count)
+		{
+			size_t sent = m_Ring.PushBatch(messages, count);
+			messages += sent;
+			count -= sent;
+			if (sent)
+				backoff.Reset();
+			else
+				backoff.Pause();
+		}
+    }
+
+    size_t ReceiveBatch(Message** out, size_t count)
+    {
+        if (count == 1)
+		{
+			*out = m_Ring.Pop();
+			return 1;
+		}
+
+        SpinBackoff backoff;
+        for (;;)
+		{
+			if (size_t received = m_Ring.PopBatch(out, count))
+				return received;
+			backoff.Pause();
+		}
+    }
+};
+
+// A heap call per message
+struct HeapMessages
+{
+    struct Local
+    {
+        explicit Local(HeapMessages&) {}
+        Message* Allocate() { return new Message; }
+        void Deallocate(Message* message) { delete message; }
+    };
+};
+
+/*
+	One pool for every thread. Producers allocate from their ThreadCache,
+	consumers free into theirs; once a consumer holds two full magazines it
+	pushes one to the shared stack, where the producers' caches pick it up:
+	one CAS per 64 messages in each direction instead of a heap call per message.
+*/
+struct PooledMessages
+{
+    ConcurrentMemoryPool<Message> pool;
+
+    explicit PooledMessages(size_t block_count) : pool(block_count) {}
+
+    struct Local
+    {
+        ConcurrentMemoryPool<Message>::ThreadCache cache;
+
+        explicit Local(PooledMessages& messages) : cache(messages.pool) {}
+        Message* Allocate() { return cache.Allocate(); }
+        void Deallocate(Message* message) { cache.Deallocate(message); }
+    };
+
+    // Enough that nobody runs dry: a full ring, plus the magazines and the batch each thread may be holding
+    static size_t BlocksFor(size_t producers, size_t consumers)
+    {
+        return RING_CAPACITY + (producers + consumers) * (3 * 64 + BATCH_SIZE);
+    }
+};
+
+// MESSAGE_COUNT messages split over the producers, 'batch' at a time; returns the sum of the sequence numbers received
+template<typename Queue, typename Memory>
+uint64_t RunPipeline(Queue& queue, Memory& memory, size_t producers, size_t consumers, size_t batch, std::vector<uint64_t>& latencies)
+{
+    std::atomic<size_t> running_producers{ producers };
+    std::atomic<uint64_t> checksum{ 0 };
+    std::mutex latency_mutex;
+    std::vector<std::thread> threads;
+    latencies.clear();
+
+    for (size_t p = 0; p < producers; p++)
+	{
+		threads.emplace_back([&, p]()
+		{
+			typename Memory::Local local(memory);
+			Message* pending[BATCH_SIZE];
+			const size_t count = MESSAGE_COUNT / producers, first = p * count;
+			for (size_t i = 0; i < count; i += batch)
+			{
+				size_t n = std::min(batch, count - i);
+				for (size_t j = 0; j < n; j++)
+				{
+					Message* message = local.Allocate();
+					message->sequence = first + i + j;
+					std::fill(std::begin(message->payload), std::end(message->payload), message->sequence);
+					message->sentTicks = ReadCycleCounter();
+					pending[j] = message;
+				}
+				queue.SendBatch(pending, n);
+			}
+
+			// The last producer to finish tells every consumer to stop
+			if (running_producers.fetch_sub(1) == 1)
+			{
+				Message* stop = nullptr;
+				for (size_t c = 0; c < consumers; c++)
+					queue.SendBatch(&stop, 1);
+			}
+		});
+	}
+
+    for (size_t c = 0; c < consumers; c++)
+	{
+		threads.emplace_back([&]()
+		{
+			typename Memory::Local local(memory);
+			std::vector<uint64_t> samples;
+			Message* received[BATCH_SIZE];
+			uint64_t sum = 0;
+			size_t stops = 0;
+			while (!stops)
+			{
+				size_t n = queue.ReceiveBatch(received, batch);
+				uint64_t now = ReadCycleCounter();
+				for (size_t i = 0; i < n; i++)
+				{
+					Message* message = received[i];
+					if (!message)
+					{
+						++stops;
+						continue;
+					}
+					if (message->sequence % LATENCY_EVERY == 0)
+						samples.push_back(now - message->sentTicks);
+					sum += message->payload[5];
+					local.Deallocate(message);
+				}
+			}
+
+			// A batch may pick up more than one stop message: pass the others on
+			Message* stop = nullptr;
+			for (; stops > 1; --stops)
+				queue.SendBatch(&stop, 1);
+
+			checksum += sum;
+			std::lock_guard<std::mutex> lock(latency_mutex);
+			latencies.insert(latencies.end(), samples.begin(), samples.end());
+		});
+	}
+
+    for (std::thread& thread : threads)
+		thread.join();
+    return checksum;
+}
+
+struct LatencyRow
+{
+    std::string name;
+    double p50Us;
+    double p99Us;
+};
+
+double PercentileUs(std::vector<uint64_t>& ticks, double fraction, double ticks_per_ns)
+{
+    if (ticks.empty())
+		return 0;
+    auto nth = ticks.begin() + ptrdiff_t(fraction * double(ticks.size() - 1));
+    std::nth_element(ticks.begin(), nth, ticks.end());
+    return double(*nth) / ticks_per_ns / 1000;
+}
+
+// One row: throughput from the harness, send-to-receive latency from the last run
+template<typename Queue, typename Memory>
+void BenchmarkPipeline(Benchmark& bench, std::vector<LatencyRow>& latency_rows, const std::string& name,
+                       Memory& memory, size_t producers, size_t consumers, size_t batch)
+{
+    Queue queue;
+    std::vector<uint64_t> latencies;
+    uint64_t checksum = 0;
+    bench.Run(name, [&]()
+    {
+        checksum = RunPipeline(queue, memory, producers, consumers, batch, latencies);
+    }, MESSAGE_COUNT);
+
+    if (checksum != uint64_t(MESSAGE_COUNT) * (MESSAGE_COUNT - 1) / 2)
+		std::cout << name << ": lost or duplicated messages\n";
+
+    static const double ticks_per_ns = CycleCounterTicksPerNs();
+    latency_rows.push_back({ name, PercentileUs(latencies, 0.50, ticks_per_ns), PercentileUs(latencies, 0.99, ticks_per_ns) });
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions defaults;
+    defaults.repetitions = 3;
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv, defaults));
+    std::vector<LatencyRow> latency_rows;
+    HeapMessages heap;
+
+    const size_t max_threads = std::max(std::thread::hardware_concurrency(), 2u);
+    std::cout << max_threads << " hardware threads: with fewer threads than producers + consumers, threads above that share cores and the timings include the scheduler\n\n";
+
+    for (size_t threads : { 1, 2, 4 })
+	{
+		const std::string prefix = std::to_string(threads) + "P/" + std::to_string(threads) + "C ";
+		PooledMessages pooled(PooledMessages::BlocksFor(threads, threads));
+
+		BenchmarkPipeline<LockedQueue>(bench, latency_rows, prefix + "mutex + std::deque, new/delete", heap, threads, threads, 1);
+		if (threads == 1)
+		{
+			BenchmarkPipeline<RingQueue<SpscRing<Message*>>>(bench, latency_rows, prefix + "SpscRing, pool", pooled, 1, 1, 1);
+			BenchmarkPipeline<RingQueue<SpscRing<Message*>>>(bench, latency_rows, prefix + "SpscRing, pool, batch 32", pooled, 1, 1, BATCH_SIZE);
+		}
+		BenchmarkPipeline<RingQueue<MpmcRing<Message*>>>(bench, latency_rows, prefix + "MpmcRing, new/delete", heap, threads, threads, 1);
+		BenchmarkPipeline<RingQueue<MpmcRing<Message*>>>(bench, latency_rows, prefix + "MpmcRing, pool", pooled, threads, threads, 1);
+		BenchmarkPipeline<RingQueue<MpmcRing<Message*>>>(bench, latency_rows, prefix + "MpmcRing, pool, batch 32", pooled, threads, threads, BATCH_SIZE);
+	}
+
+    bench.Report();
+
+    // Measured under full load: mostly the time spent waiting behind the messages already queued
+    std::cout << "\nSend to receive latency, 1 message in " << LATENCY_EVERY << " (us):\n" << std::fixed << std::setprecision(1);
+    for (const LatencyRow& row : latency_rows)
+		std::cout << "  " << row.name << ": p50 " << row.p50Us << ", p99 " << row.p99Us << '\n';
+    return 0;
+}
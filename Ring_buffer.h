@@ -0,0 +1,350 @@
+// Bounded lock-free ring buffers: single producer / single consumer, and Vyukov's multi producer / multi consumer queue
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "Asm_kernels.h"
+#include "Bit_tricks.h"
+
+/*
+	Both rings hold a power of two number of slots, allocated once, and
+	never block in the kernel: TryPush / TryPop return false when the ring is
+	full / empty, Push / Pop spin with SpinBackoff until they succeed.
+
+	SpscRing<T>  one producer thread, one consumer thread. The producer owns
+	             the tail index, the consumer the head index, each on its
+	             own cache line together with a private copy of the other
+	             side's index: the shared line is only read when the copy
+	             says the ring looks full (or empty), so in steady state
+	             a push or pop touches no line the other thread writes
+	MpmcRing<T>  any number of producers and consumers (Dmitry Vyukov's
+	             bounded queue). Every slot carries a sequence number that
+	             says whose turn it is: a producer claims position p with
+	             one CAS on the enqueue index when slot p's sequence is p,
+	             and publishes it by storing p + 1; a consumer claims it
+	             when the sequence is p + 1 and frees it with p + capacity.
+	             Threads never wait for each other except on the CAS
+
+	PushBatch / PopBatch move up to n elements at once: one index update
+	(SPSC) or one CAS (MPMC) for the whole batch instead of one per element.
+
+	To hand work between threads without a heap call per message, carry
+	pointers to blocks of a ConcurrentMemoryPool: producers allocate from
+	their ThreadCache, consumers free into theirs, and full magazines go
+	back to the producers through the pool's shared stack, one CAS per
+	magazine (Ring_buffer.cpp).
+*/
+
+namespace RingDetail
+{
+    static constexpr size_t s_CacheLine = 64;
+
+    // Uninitialized storage for one T
+    template<typename T>
+    struct t_Storage
+    {
+        alignas(T) unsigned char bytes[sizeof(T)];
+
+        T* Get() { return std::launder(reinterpret_cast<T*>(bytes)); }
+    };
+
+    inline size_t RingCapacity(size_t capacity)
+    {
+        return NextPowerOfTwo(capacity < 2 ? size_t(2) : capacity);
+    }
+}
+
+template<typename T>
+class SpscRing
+{
+    using t_Slot = RingDetail::t_Storage<T>;
+    static constexpr size_t s_CacheLine = RingDetail::s_CacheLine;
+
+    // Read only after construction
+    alignas(s_CacheLine) const size_t m_Mask;
+    const std::unique_ptr<t_Slot[]> m_Slots;
+
+    // Producer's line
+    alignas(s_CacheLine) std::atomic<size_t> m_Tail{ 0 };
+    size_t m_CachedHead = 0;
+
+    // Consumer's line
+    alignas(s_CacheLine) std::atomic<size_t> m_Head{ 0 };
+    size_t m_CachedTail = 0;
+
+    // Free slots for the producer, reading the consumer's index only when the cached one says there are fewer than 'wanted'
+    size_t FreeSlots(size_t tail, size_t wanted)
+    {
+        size_t free = m_Mask + 1 - (tail - m_CachedHead);
+        if (free < wanted)
+        {
+            m_CachedHead = m_Head.load(std::memory_order_acquire);
+            free = m_Mask + 1 - (tail - m_CachedHead);
+        }
+        return free;
+    }
+
+    size_t FilledSlots(size_t head, size_t wanted)
+    {
+        size_t filled = m_CachedTail - head;
+        if (filled < wanted)
+        {
+            m_CachedTail = m_Tail.load(std::memory_order_acquire);
+            filled = m_CachedTail - head;
+        }
+        return filled;
+    }
+
+public:
+    using value_type = T;
+
+    // Rounded up to a power of two
+    explicit SpscRing(size_t capacity)
+        : m_Mask(RingDetail::RingCapacity(capacity) - 1), m_Slots(new t_Slot[m_Mask + 1])
+    {
+    }
+
+    ~SpscRing()
+    {
+        for (size_t head = m_Head.load(std::memory_order_relaxed), tail = m_Tail.load(std::memory_order_relaxed); head != tail; ++head)
+			std::destroy_at(m_Slots[head & m_Mask].Get());
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t Capacity() const { return m_Mask + 1; }
+
+    // Exact when called from the producer or the consumer with the other one idle, a snapshot otherwise
+    size_t SizeApprox() const
+    {
+        size_t head = m_Head.load(std::memory_order_acquire);
+        return m_Tail.load(std::memory_order_acquire) - head;
+    }
+
+    // Producer side
+    template<typename... Args>
+    bool TryEmplace(Args&&... args)
+    {
+        size_t tail = m_Tail.load(std::memory_order_relaxed);
+        if (!FreeSlots(tail, 1))
+			return false;
+        ::new (static_cast<void*>(m_Slots[tail & m_Mask].bytes)) T(std::forward<Args>(args)...);
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPush(const T& value) { return TryEmplace(value); }
+    bool TryPush(T&& value) { return TryEmplace(std::move(value)); }
+
+    void Push(T value)
+    {
+        SpinBackoff backoff;
+        while (!TryEmplace(std::move(value)))
+			backoff.Pause();
+    }
+
+    // Copies up to 'count' elements of 'values' in, returns how many fit
+    size_t PushBatch(const T* values, size_t count)
+    {
+        size_t tail = m_Tail.load(std::memory_order_relaxed);
+        size_t free = FreeSlots(tail, count);
+        count = count < free ? count : free;
+        for (size_t i = 0; i < count; ++i)
+			::new (static_cast<void*>(m_Slots[(tail + i) & m_Mask].bytes)) T(values[i]);
+        m_Tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer side
+    bool TryPop(T& out)
+    {
+        size_t head = m_Head.load(std::memory_order_relaxed);
+        if (!FilledSlots(head, 1))
+			return false;
+        T* slot = m_Slots[head & m_Mask].Get();
+        out = std::move(*slot);
+        std::destroy_at(slot);
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    T Pop()
+    {
+        SpinBackoff backoff;
+        T value;
+        while (!TryPop(value))
+			backoff.Pause();
+        return value;
+    }
+
+    // Moves up to 'count' elements out into 'out', returns how many there were
+    size_t PopBatch(T* out, size_t count)
+    {
+        size_t head = m_Head.load(std::memory_order_relaxed);
+        size_t filled = FilledSlots(head, count);
+        count = count < filled ? count : filled;
+        for (size_t i = 0; i < count; ++i)
+        {
+            T* slot = m_Slots[(head + i) & m_Mask].Get();
+            out[i] = std::move(*slot);
+            std::destroy_at(slot);
+        }
+        m_Head.store(head + count, std::memory_order_release);
+        return count;
+    }
+};
+
+template<typename T>
+class MpmcRing
+{
+    struct t_Cell
+    {
+        std::atomic<size_t> sequence;
+        RingDetail::t_Storage<T> storage;
+    };
+
+    static constexpr size_t s_CacheLine = RingDetail::s_CacheLine;
+
+    alignas(s_CacheLine) const size_t m_Mask;
+    const std::unique_ptr<t_Cell[]> m_Cells;
+    alignas(s_CacheLine) std::atomic<size_t> m_EnqueuePos{ 0 };
+    alignas(s_CacheLine) std::atomic<size_t> m_DequeuePos{ 0 }; // The class is padded to a whole line after it
+
+    /*
+		Claims up to 'count' consecutive positions whose cells have sequence
+		'pos + i + offset' (offset 0: free for producers, 1: filled for
+		consumers) with one CAS on 'index'. Returns the first position and
+		how many were claimed, 0 if the ring is full / empty.
+	*/
+    std::pair<size_t, size_t> Claim(std::atomic<size_t>& index, size_t count, size_t offset)
+    {
+        SpinBackoff backoff;
+        size_t pos = index.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            size_t ready = 0;
+            for (; ready < count; ++ready)
+            {
+                size_t sequence = m_Cells[(pos + ready) & m_Mask].sequence.load(std::memory_order_acquire);
+                if (sequence != pos + ready + offset)
+                {
+                    // Behind: the cell still holds the previous lap (full / empty). Ahead: 'pos' is stale
+                    if (ready == 0 && intptr_t(sequence - (pos + offset)) < 0)
+						return { pos, 0 };
+                    break;
+                }
+            }
+
+            if (ready && index.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed))
+				return { pos, ready };
+            if (!ready)
+				pos = index.load(std::memory_order_relaxed);
+            backoff.Pause();
+        }
+    }
+
+public:
+    using value_type = T;
+
+    // Rounded up to a power of two, at least 2
+    explicit MpmcRing(size_t capacity)
+        : m_Mask(RingDetail::RingCapacity(capacity) - 1), m_Cells(new t_Cell[m_Mask + 1])
+    {
+        for (size_t i = 0; i <= m_Mask; ++i)
+			m_Cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    ~MpmcRing()
+    {
+        for (size_t pos = m_DequeuePos.load(std::memory_order_relaxed), end = m_EnqueuePos.load(std::memory_order_relaxed); pos != end; ++pos)
+			std::destroy_at(m_Cells[pos & m_Mask].storage.Get());
+    }
+
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    size_t Capacity() const { return m_Mask + 1; }
+
+    size_t SizeApprox() const
+    {
+        size_t enqueued = m_EnqueuePos.load(std::memory_order_acquire);
+        size_t dequeued = m_DequeuePos.load(std::memory_order_acquire);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    template<typename... Args>
+    bool TryEmplace(Args&&... args)
+    {
+        auto [pos, claimed] = Claim(m_EnqueuePos, 1, 0);
+        if (!claimed)
+			return false;
+        t_Cell& cell = m_Cells[pos & m_Mask];
+        ::new (static_cast<void*>(cell.storage.bytes)) T(std::forward<Args>(args)...);
+        cell.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPush(const T& value) { return TryEmplace(value); }
+    bool TryPush(T&& value) { return TryEmplace(std::move(value)); }
+
+    void Push(T value)
+    {
+        SpinBackoff backoff;
+        while (!TryEmplace(std::move(value)))
+			backoff.Pause();
+    }
+
+    // Up to 'count' (at most Capacity()) elements with one CAS; returns how many went in
+    size_t PushBatch(const T* values, size_t count)
+    {
+        auto [pos, claimed] = Claim(m_EnqueuePos, count < m_Mask + 1 ? count : m_Mask + 1, 0);
+        for (size_t i = 0; i < claimed; ++i)
+        {
+            t_Cell& cell = m_Cells[(pos + i) & m_Mask];
+            ::new (static_cast<void*>(cell.storage.bytes)) T(values[i]);
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    bool TryPop(T& out)
+    {
+        auto [pos, claimed] = Claim(m_DequeuePos, 1, 1);
+        if (!claimed)
+			return false;
+        t_Cell& cell = m_Cells[pos & m_Mask];
+        T* slot = cell.storage.Get();
+        out = std::move(*slot);
+        std::destroy_at(slot);
+        cell.sequence.store(pos + m_Mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    T Pop()
+    {
+        SpinBackoff backoff;
+        T value;
+        while (!TryPop(value))
+			backoff.Pause();
+        return value;
+    }
+
+    size_t PopBatch(T* out, size_t count)
+    {
+        auto [pos, claimed] = Claim(m_DequeuePos, count < m_Mask + 1 ? count : m_Mask + 1, 1);
+        for (size_t i = 0; i < claimed; ++i)
+        {
+            t_Cell& cell = m_Cells[(pos + i) & m_Mask];
+            T* slot = cell.storage.Get();
+            out[i] = std::move(*slot);
+            std::destroy_at(slot);
+            cell.sequence.store(pos + i + m_Mask + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+};
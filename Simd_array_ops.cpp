@@ -0,0 +1,79 @@
+// Bulk operations on AutoArray with SIMD: every level this CPU supports against the scalar loops
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include "Auto_array.h"
+#include "Benchmark.h"
+#include "Simd_array_ops.h"
+
+constexpr size_t COUNT = 1'000'000;
+
+template<typename T>
+void BenchmarkLevel(Benchmark& bench, const char* type, SimdLevel level, AlignedArray<T>& values, AlignedArray<T>& out)
+{
+    SimdOps<T> simd(level);
+    std::string suffix = std::string(" ") + type + " [" + SimdLevelName(level) + "]";
+
+    bench.Run("fill" + suffix, [&]()
+    {
+        simd.Fill(values, T(3));
+        ClobberMemory();
+    }, COUNT);
+
+    // Values for the scans: i % 1000, so min / max / count have something to find
+    for (size_t i = 0; i < COUNT; ++i)
+		values[i] = T(i % 1000);
+
+    bench.Run("sum" + suffix, [&]() { DoNotOptimize(simd.Sum(values)); }, COUNT);
+    bench.Run("min" + suffix, [&]() { DoNotOptimize(simd.Min(values)); }, COUNT);
+    bench.Run("max" + suffix, [&]() { DoNotOptimize(simd.Max(values)); }, COUNT);
+
+    // Not present: the whole array is scanned
+    bench.Run("find" + suffix, [&]() { DoNotOptimize(simd.Find(values, T(-1))); }, COUNT);
+    bench.Run("count < 250" + suffix, [&]() { DoNotOptimize(simd.Count(values, SimdCompare::Less, T(250))); }, COUNT);
+
+    bench.Run("transform" + suffix, [&]()
+    {
+        simd.Transform(out, values, T(2), T(1));
+        ClobberMemory();
+    }, COUNT);
+}
+
+template<typename T>
+void BenchmarkType(Benchmark& bench, const char* type)
+{
+    // 64 byte aligned: the kernels never have to peel elements to reach an aligned load
+    AlignedArray<T> values;
+    AlignedArray<T> out;
+    values.resize(COUNT);
+    out.resize(COUNT);
+
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::Sse4, SimdLevel::Avx2, SimdLevel::Avx512, SimdLevel::Neon })
+	{
+		if (SimdLevelSupported(level))
+			BenchmarkLevel(bench, type, level, values, out);
+	}
+}
+
+int main(int argc, char** argv)
+{
+    std::cout << "Best SIMD level on this CPU: " << SimdLevelName(DetectSimdLevel()) << "\n\n";
+
+    // Every level gives the same answers
+    AutoArray<int32_t> check;
+    for (int32_t i = 0; i < 1001; ++i)
+		check.push_back(i * 7 % 1001 - 500);
+    SimdOps<int32_t> best;
+    SimdOps<int32_t> scalar(SimdLevel::Scalar);
+    bool same = best.Sum(check) == scalar.Sum(check) && best.Min(check) == scalar.Min(check) &&
+                best.Max(check) == scalar.Max(check) && best.Find(check, 42) == scalar.Find(check, 42) &&
+                best.Count(check, SimdCompare::Greater, 100) == scalar.Count(check, SimdCompare::Greater, 100);
+    std::cout << "Results match scalar: " << (same ? "yes" : "NO") << "\n\n";
+
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+    BenchmarkType<int32_t>(bench, "int32");
+    BenchmarkType<float>(bench, "float");
+    bench.Report();
+
+    return 0;
+}
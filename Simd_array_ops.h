@@ -0,0 +1,530 @@
+// Vectorized bulk operations on arrays of numbers (fill, sum, min/max, find, count, transform), picked at runtime
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+/*
+	SimdOps<T> runs bulk operations over any contiguous array of int32_t,
+	int64_t, float or double (AutoArray, std::vector, raw buffers via span):
+
+		SimdOps<float> simd;                // best level for this CPU
+		simd.Fill(values, 1.0f);
+		double total = simd.Sum(values);
+		size_t small = simd.Count(values, SimdCompare::Less, 0.5f);
+
+	Every kernel is written once with GCC/Clang vector extensions and compiled
+	for several instruction sets through target attributes: SSE4.1 (16 byte
+	registers), AVX2 (32) and AVX-512 (64) on x86-64, NEON (16) on AArch64,
+	plus a scalar fallback. The level is chosen once from CPUID
+	(__builtin_cpu_supports), so one binary runs everywhere and still uses
+	the widest registers the machine has.
+
+	Kernels first handle a few scalar elements until the pointer is aligned
+	to the register size, so the main loop never splits a cache line. With
+	AlignedArray (Auto_array.h) the data already starts aligned and that
+	step does nothing.
+
+	Sums are accumulated in int64_t / double lanes. Float results can differ
+	from a sequential loop in the last bits, since lanes add in another order.
+*/
+
+enum class SimdLevel
+{
+    Scalar,
+    Sse4,
+    Avx2,
+    Avx512,
+    Neon
+};
+
+enum class SimdCompare
+{
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual
+};
+
+inline const char* SimdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::Sse4: return "sse4.1";
+    case SimdLevel::Avx2: return "avx2";
+    case SimdLevel::Avx512: return "avx512";
+    case SimdLevel::Neon: return "neon";
+    }
+    return "?";
+}
+
+// Was the level compiled in, and does this CPU (and OS) support it?
+inline bool SimdLevelSupported(SimdLevel level)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    switch (level)
+    {
+    case SimdLevel::Scalar: return true;
+    case SimdLevel::Sse4: return __builtin_cpu_supports("sse4.1");
+    case SimdLevel::Avx2: return __builtin_cpu_supports("avx2");
+    case SimdLevel::Avx512: return __builtin_cpu_supports("avx512f");
+    default: return false;
+    }
+#elif defined(__aarch64__)
+    return level == SimdLevel::Scalar || level == SimdLevel::Neon;
+#else
+    return level == SimdLevel::Scalar;
+#endif
+}
+
+// Widest level of this machine, probed once
+inline SimdLevel DetectSimdLevel()
+{
+    static const SimdLevel s_Level = []()
+    {
+        for (SimdLevel level : { SimdLevel::Avx512, SimdLevel::Avx2, SimdLevel::Sse4, SimdLevel::Neon })
+        {
+            if (SimdLevelSupported(level))
+            {
+                return level;
+            }
+        }
+        return SimdLevel::Scalar;
+    }();
+    return s_Level;
+}
+
+template<typename T>
+using SimdSum = std::conditional_t<std::is_floating_point_v<T>, double, int64_t>;
+
+// One level's entry points for one element type
+template<typename T>
+struct SimdKernels
+{
+    void (*fill)(T* out, size_t n, T value);
+    SimdSum<T> (*sum)(const T* in, size_t n);
+    T (*min)(const T* in, size_t n);
+    T (*max)(const T* in, size_t n);
+    size_t (*find)(const T* in, size_t n, T value);
+    size_t (*count)(const T* in, size_t n, SimdCompare compare, T value);
+    void (*transform)(T* out, const T* in, size_t n, T scale, T offset);
+};
+
+template<SimdCompare Compare, typename T>
+inline bool SimdTest(T a, T b)
+{
+    if constexpr (Compare == SimdCompare::Equal) return a == b;
+    else if constexpr (Compare == SimdCompare::NotEqual) return a != b;
+    else if constexpr (Compare == SimdCompare::Less) return a < b;
+    else if constexpr (Compare == SimdCompare::LessEqual) return a <= b;
+    else if constexpr (Compare == SimdCompare::Greater) return a > b;
+    else return a >= b;
+}
+
+// Plain loops: for CPUs without SIMD and as the baseline in benchmarks
+template<typename T>
+struct SimdScalarKernel
+{
+    static void Fill(T* out, size_t n, T value)
+    {
+        for (size_t i = 0; i < n; ++i)
+			out[i] = value;
+    }
+
+    static SimdSum<T> Sum(const T* in, size_t n)
+    {
+        SimdSum<T> total = 0;
+        for (size_t i = 0; i < n; ++i)
+			total += in[i];
+        return total;
+    }
+
+    static T Min(const T* in, size_t n)
+    {
+        T best = std::numeric_limits<T>::max();
+        for (size_t i = 0; i < n; ++i)
+			best = in[i] < best ? in[i] : best;
+        return best;
+    }
+
+    static T Max(const T* in, size_t n)
+    {
+        T best = std::numeric_limits<T>::lowest();
+        for (size_t i = 0; i < n; ++i)
+			best = in[i] > best ? in[i] : best;
+        return best;
+    }
+
+    static size_t Find(const T* in, size_t n, T value)
+    {
+        for (size_t i = 0; i < n; ++i)
+		{
+			if (in[i] == value)
+				return i;
+		}
+        return n;
+    }
+
+    template<SimdCompare Compare>
+    static size_t CountWith(const T* in, size_t n, T value)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < n; ++i)
+			count += SimdTest<Compare>(in[i], value);
+        return count;
+    }
+
+    static void Transform(T* out, const T* in, size_t n, T scale, T offset)
+    {
+        for (size_t i = 0; i < n; ++i)
+			out[i] = in[i] * scale + offset;
+    }
+};
+
+/*
+	The same algorithms on registers of 'Bytes' bytes. Everything here is
+	always_inline and compiled with the instruction set of the level that
+	calls it (SIMD_ARRAY_LEVEL below), so one source serves all widths.
+*/
+template<typename T, size_t Bytes>
+struct SimdVectorKernel
+{
+    static constexpr size_t s_Lanes = Bytes / sizeof(T);
+    static constexpr size_t s_CountBlock = size_t(1) << 24; // Lane counters are flushed before they can wrap
+
+    using t_Lane = std::conditional_t<sizeof(T) == 4, int32_t, int64_t>;
+    using t_Sum = SimdSum<T>;
+    typedef T t_Vector __attribute__((vector_size(Bytes)));
+    typedef t_Lane t_Mask __attribute__((vector_size(Bytes)));
+    static constexpr size_t s_SumLanes = Bytes / sizeof(t_Sum); // s_Lanes / 2 when the sum is wider than T
+    typedef t_Sum t_SumVector __attribute__((vector_size(Bytes)));
+
+    // Element-aligned view of a register's worth of elements, for loads and stores anywhere
+    typedef T t_Unaligned __attribute__((vector_size(Bytes), aligned(alignof(T)), may_alias));
+
+    [[gnu::always_inline]] static const t_Unaligned& At(const T* p)
+    {
+        return *reinterpret_cast<const t_Unaligned*>(p);
+    }
+
+    [[gnu::always_inline]] static t_Unaligned& At(T* p)
+    {
+        return *reinterpret_cast<t_Unaligned*>(p);
+    }
+
+    // acc += v, lanes widened to t_Sum; a wide register of int64_t holds half as many lanes
+    template<size_t... Lane>
+    [[gnu::always_inline]] static void AddWidened(t_SumVector& acc, const t_Unaligned& v, std::index_sequence<Lane...>)
+    {
+        if constexpr (s_SumLanes == s_Lanes)
+        {
+            acc += __builtin_convertvector(v, t_SumVector);
+        }
+        else
+        {
+            t_Vector full = v;
+            acc += __builtin_convertvector(__builtin_shufflevector(full, full, Lane...), t_SumVector);
+            acc += __builtin_convertvector(__builtin_shufflevector(full, full, (Lane + s_SumLanes)...), t_SumVector);
+        }
+    }
+
+    [[gnu::always_inline]] static void AddWidened(t_SumVector& acc, const t_Unaligned& v)
+    {
+        AddWidened(acc, v, std::make_index_sequence<s_SumLanes>());
+    }
+
+    // A true lane is -1, subtracting the mask counts hits per lane
+    template<SimdCompare Compare>
+    [[gnu::always_inline]] static void CountHits(t_Mask& hits, const t_Unaligned& a, const t_Vector& b)
+    {
+        if constexpr (Compare == SimdCompare::Equal) hits -= a == b;
+        else if constexpr (Compare == SimdCompare::NotEqual) hits -= a != b;
+        else if constexpr (Compare == SimdCompare::Less) hits -= a < b;
+        else if constexpr (Compare == SimdCompare::LessEqual) hits -= a <= b;
+        else if constexpr (Compare == SimdCompare::Greater) hits -= a > b;
+        else hits -= a >= b;
+    }
+
+    [[gnu::always_inline]] static bool Any(const t_Mask& mask)
+    {
+        uint64_t words[Bytes / sizeof(uint64_t)];
+        std::memcpy(words, &mask, sizeof(words));
+        uint64_t any = 0;
+        for (size_t i = 0; i < Bytes / sizeof(uint64_t); ++i)
+			any |= words[i];
+        return any != 0;
+    }
+
+    // Scalar elements before 'p' reaches a register boundary
+    [[gnu::always_inline]] static size_t Head(const T* p, size_t n)
+    {
+        size_t misalignment = reinterpret_cast<uintptr_t>(p) % Bytes;
+        size_t head = misalignment ? (Bytes - misalignment) / sizeof(T) : 0;
+        return head < n ? head : n;
+    }
+
+    [[gnu::always_inline]] static void Fill(T* out, size_t n, T value)
+    {
+        size_t i = 0;
+        for (size_t head = Head(out, n); i < head; ++i)
+			out[i] = value;
+
+        t_Vector v = t_Vector{} + value;
+        for (; i + s_Lanes <= n; i += s_Lanes)
+			At(out + i) = v;
+
+        for (; i < n; ++i)
+			out[i] = value;
+    }
+
+    [[gnu::always_inline]] static t_Sum Sum(const T* in, size_t n)
+    {
+        t_Sum total = 0;
+        size_t i = 0;
+        for (size_t head = Head(in, n); i < head; ++i)
+			total += in[i];
+
+        // Two accumulators hide the latency of the adds
+        t_SumVector acc0 = {};
+        t_SumVector acc1 = {};
+        for (; i + 2 * s_Lanes <= n; i += 2 * s_Lanes)
+		{
+			AddWidened(acc0, At(in + i));
+			AddWidened(acc1, At(in + i + s_Lanes));
+		}
+        for (; i + s_Lanes <= n; i += s_Lanes)
+			AddWidened(acc0, At(in + i));
+
+        acc0 += acc1;
+        for (size_t lane = 0; lane < s_SumLanes; ++lane)
+			total += acc0[lane];
+
+        for (; i < n; ++i)
+			total += in[i];
+        return total;
+    }
+
+    template<bool Smallest>
+    [[gnu::always_inline]] static T Extreme(const T* in, size_t n)
+    {
+        T best = Smallest ? std::numeric_limits<T>::max() : std::numeric_limits<T>::lowest();
+        size_t i = 0;
+        for (size_t head = Head(in, n); i < head; ++i)
+			best = (Smallest ? in[i] < best : in[i] > best) ? in[i] : best;
+
+        t_Vector acc0 = t_Vector{} + best;
+        t_Vector acc1 = acc0;
+        for (; i + 2 * s_Lanes <= n; i += 2 * s_Lanes)
+		{
+			t_Vector v0 = At(in + i);
+			t_Vector v1 = At(in + i + s_Lanes);
+			acc0 = (Smallest ? v0 < acc0 : v0 > acc0) ? v0 : acc0;
+			acc1 = (Smallest ? v1 < acc1 : v1 > acc1) ? v1 : acc1;
+		}
+        for (; i + s_Lanes <= n; i += s_Lanes)
+		{
+			t_Vector v0 = At(in + i);
+			acc0 = (Smallest ? v0 < acc0 : v0 > acc0) ? v0 : acc0;
+		}
+
+        acc0 = (Smallest ? acc1 < acc0 : acc1 > acc0) ? acc1 : acc0;
+        for (size_t lane = 0; lane < s_Lanes; ++lane)
+			best = (Smallest ? acc0[lane] < best : acc0[lane] > best) ? acc0[lane] : best;
+
+        for (; i < n; ++i)
+			best = (Smallest ? in[i] < best : in[i] > best) ? in[i] : best;
+        return best;
+    }
+
+    [[gnu::always_inline]] static size_t Find(const T* in, size_t n, T value)
+    {
+        size_t i = 0;
+        for (size_t head = Head(in, n); i < head; ++i)
+		{
+			if (in[i] == value)
+				return i;
+		}
+
+        t_Vector v = t_Vector{} + value;
+        for (; i + s_Lanes <= n; i += s_Lanes)
+		{
+			t_Mask hits = At(in + i) == v;
+			if (Any(hits))
+			{
+				for (size_t lane = 0; ; ++lane)
+				{
+					if (hits[lane])
+						return i + lane;
+				}
+			}
+		}
+
+        for (; i < n; ++i)
+		{
+			if (in[i] == value)
+				return i;
+		}
+        return n;
+    }
+
+    template<SimdCompare Compare>
+    [[gnu::always_inline]] static size_t CountWith(const T* in, size_t n, T value)
+    {
+        size_t count = 0;
+        size_t i = 0;
+        for (size_t head = Head(in, n); i < head; ++i)
+			count += SimdTest<Compare>(in[i], value);
+
+        t_Vector v = t_Vector{} + value;
+        while (i + s_Lanes <= n)
+        {
+            size_t block_end = n - i > s_CountBlock ? i + s_CountBlock : n;
+            t_Mask hits = {};
+            for (; i + s_Lanes <= block_end; i += s_Lanes)
+				CountHits<Compare>(hits, At(in + i), v);
+            for (size_t lane = 0; lane < s_Lanes; ++lane)
+				count += size_t(hits[lane]);
+        }
+
+        for (; i < n; ++i)
+			count += SimdTest<Compare>(in[i], value);
+        return count;
+    }
+
+    [[gnu::always_inline]] static void Transform(T* out, const T* in, size_t n, T scale, T offset)
+    {
+        size_t i = 0;
+        for (size_t head = Head(out, n); i < head; ++i)
+			out[i] = in[i] * scale + offset;
+
+        t_Vector scales = t_Vector{} + scale;
+        t_Vector offsets = t_Vector{} + offset;
+        for (; i + s_Lanes <= n; i += s_Lanes)
+			At(out + i) = At(in + i) * scales + offsets;
+
+        for (; i < n; ++i)
+			out[i] = in[i] * scale + offset;
+    }
+};
+
+template<typename Kernel, typename T>
+[[gnu::always_inline]] inline size_t SimdCount(const T* in, size_t n, SimdCompare compare, T value)
+{
+    switch (compare)
+    {
+    case SimdCompare::Equal: return Kernel::template CountWith<SimdCompare::Equal>(in, n, value);
+    case SimdCompare::NotEqual: return Kernel::template CountWith<SimdCompare::NotEqual>(in, n, value);
+    case SimdCompare::Less: return Kernel::template CountWith<SimdCompare::Less>(in, n, value);
+    case SimdCompare::LessEqual: return Kernel::template CountWith<SimdCompare::LessEqual>(in, n, value);
+    case SimdCompare::Greater: return Kernel::template CountWith<SimdCompare::Greater>(in, n, value);
+    case SimdCompare::GreaterEqual: return Kernel::template CountWith<SimdCompare::GreaterEqual>(in, n, value);
+    }
+    return 0;
+}
+
+/*
+	Entry points of one level: thin wrappers that carry the target attribute,
+	the vector kernels are inlined into them and compiled for that ISA.
+*/
+#define SIMD_ARRAY_LEVEL(Name, Target, Bytes)                                                                          \
+    template<typename T>                                                                                               \
+    struct Name                                                                                                        \
+    {                                                                                                                  \
+        using t_Kernel = SimdVectorKernel<T, Bytes>;                                                                   \
+                                                                                                                       \
+        Target static void Fill(T* out, size_t n, T value) { t_Kernel::Fill(out, n, value); }                          \
+        Target static SimdSum<T> Sum(const T* in, size_t n) { return t_Kernel::Sum(in, n); }                           \
+        Target static T Min(const T* in, size_t n) { return t_Kernel::template Extreme<true>(in, n); }                 \
+        Target static T Max(const T* in, size_t n) { return t_Kernel::template Extreme<false>(in, n); }                \
+        Target static size_t Find(const T* in, size_t n, T value) { return t_Kernel::Find(in, n, value); }             \
+        Target static size_t Count(const T* in, size_t n, SimdCompare compare, T value)                                \
+        {                                                                                                              \
+            return SimdCount<t_Kernel>(in, n, compare, value);                                                         \
+        }                                                                                                              \
+        Target static void Transform(T* out, const T* in, size_t n, T scale, T offset)                                 \
+        {                                                                                                              \
+            t_Kernel::Transform(out, in, n, scale, offset);                                                            \
+        }                                                                                                              \
+                                                                                                                       \
+        static constexpr SimdKernels<T> s_Kernels = { &Fill, &Sum, &Min, &Max, &Find, &Count, &Transform };            \
+    };
+
+#if defined(__x86_64__) || defined(__i386__)
+SIMD_ARRAY_LEVEL(SimdSse4Level, __attribute__((target("sse4.1"))), 16)
+SIMD_ARRAY_LEVEL(SimdAvx2Level, __attribute__((target("avx2"))), 32)
+SIMD_ARRAY_LEVEL(SimdAvx512Level, __attribute__((target("avx512f"))), 64)
+#elif defined(__aarch64__)
+SIMD_ARRAY_LEVEL(SimdNeonLevel, , 16) // NEON is part of the AArch64 baseline
+#endif
+
+#undef SIMD_ARRAY_LEVEL
+
+// Kernels of 'level' for T; a level that isn't compiled in falls back to scalar
+template<typename T>
+const SimdKernels<T>& GetSimdKernels(SimdLevel level)
+{
+    using t_Scalar = SimdScalarKernel<T>;
+    static constexpr SimdKernels<T> s_Scalar = {
+        &t_Scalar::Fill, &t_Scalar::Sum, &t_Scalar::Min, &t_Scalar::Max, &t_Scalar::Find,
+        &SimdCount<t_Scalar, T>, &t_Scalar::Transform
+    };
+
+    switch (level)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+    case SimdLevel::Sse4: return SimdSse4Level<T>::s_Kernels;
+    case SimdLevel::Avx2: return SimdAvx2Level<T>::s_Kernels;
+    case SimdLevel::Avx512: return SimdAvx512Level<T>::s_Kernels;
+#elif defined(__aarch64__)
+    case SimdLevel::Neon: return SimdNeonLevel<T>::s_Kernels;
+#endif
+    default: return s_Scalar;
+    }
+}
+
+template<typename T>
+class SimdOps
+{
+    static_assert(std::is_same_v<T, int32_t> || std::is_same_v<T, int64_t> || std::is_same_v<T, float> ||
+                  std::is_same_v<T, double>, "SimdOps: int32_t, int64_t, float or double");
+
+    const SimdKernels<T>* m_Kernels;
+    SimdLevel m_Level;
+
+public:
+    // 'level' must be supported by the CPU (SimdLevelSupported), the default always is
+    explicit SimdOps(SimdLevel level = DetectSimdLevel()) : m_Kernels(&GetSimdKernels<T>(level)), m_Level(level) {}
+
+    SimdLevel Level() const { return m_Level; }
+
+    void Fill(std::span<T> out, T value) const { m_Kernels->fill(out.data(), out.size(), value); }
+
+    SimdSum<T> Sum(std::span<const T> in) const { return m_Kernels->sum(in.data(), in.size()); }
+
+    // numeric_limits<T>::max() / lowest() for an empty array
+    T Min(std::span<const T> in) const { return m_Kernels->min(in.data(), in.size()); }
+    T Max(std::span<const T> in) const { return m_Kernels->max(in.data(), in.size()); }
+
+    // Index of the first element equal to 'value', in.size() if there is none
+    size_t Find(std::span<const T> in, T value) const { return m_Kernels->find(in.data(), in.size(), value); }
+
+    // How many elements satisfy 'element <compare> value'
+    size_t Count(std::span<const T> in, SimdCompare compare, T value) const
+    {
+        return m_Kernels->count(in.data(), in.size(), compare, value);
+    }
+
+    // out[i] = in[i] * scale + offset; 'out' may be 'in', otherwise they must not overlap
+    void Transform(std::span<T> out, std::span<const T> in, T scale, T offset) const
+    {
+        m_Kernels->transform(out.data(), in.data(), out.size() < in.size() ? out.size() : in.size(), scale, offset);
+    }
+};
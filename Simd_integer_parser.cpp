@@ -0,0 +1,122 @@
+// Parsing big files of integers: FastInput::Read() one number at a time against the SIMD / SWAR bulk parser
+#include <iostream>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include "Auto_array.h"
+#include "Benchmark.h"
+#include "Fast_io.h"
+#include "Simd_integer_parser.h"
+
+constexpr size_t COUNT = 5'000'000;
+
+struct InputShape
+{
+    const char* name;
+    int64_t low;
+    int64_t high;
+};
+
+int main(int argc, char** argv)
+{
+    const InputShape shapes[] = {
+        { "1-3 digits", 0, 999 },
+        { "signed, up to 10 digits", -2'000'000'000, 2'000'000'000 },
+        { "16 digits", 1'000'000'000'000'000, 9'999'999'999'999'999 },
+    };
+
+    BenchmarkOptions defaults;
+    defaults.repetitions = 5;
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv, defaults));
+    std::string path = (std::filesystem::temp_directory_path() / "simd_integer_parser.txt").string();
+
+    // True only when every token was a number, the last one included
+    const std::pair<const char*, bool> checks[] = {
+        { "1 2 3", true }, { "1 2 3 \n", true }, { "", true },
+        { "1 2 abc\n", false }, { "1 2 3x", false }, { "5 -", false },
+    };
+    for (auto [text, valid] : checks)
+	{
+		{
+			FastOutput out(path.c_str());
+			out << text;
+		}
+		FastInput in(path.c_str());
+		AutoArray<int64_t> values;
+		if (ParseIntegers(in, values) != valid)
+			std::cerr << "ParseIntegers(\"" << text << "\") should return " << (valid ? "true" : "false") << "\n";
+	}
+
+    for (const InputShape& shape : shapes)
+	{
+		uint64_t expected = 0; // Sums wrap: the full range shape overflows any signed type
+		{
+			std::mt19937_64 random(7);
+			std::uniform_int_distribution<int64_t> numbers(shape.low, shape.high);
+			FastOutput out(path.c_str());
+			for (size_t i = 0; i < COUNT; i++)
+			{
+				int64_t value = numbers(random);
+				expected += uint64_t(value);
+				out << value << (i % 16 == 15 ? '\n' : ' ');
+			}
+		}
+		std::cout << shape.name << ": " << std::filesystem::file_size(path) / (1024 * 1024) << " MiB\n";
+
+		auto check = [&](uint64_t sum, size_t count)
+		{
+			if (sum != expected || count != COUNT)
+				std::cerr << "wrong result for " << shape.name << "\n";
+		};
+		std::string suffix = std::string(" (") + shape.name + ")";
+
+		bench.Run("FastInput::Read loop" + suffix, [&]()
+		{
+			FastInput in(path.c_str());
+			uint64_t sum = 0;
+			size_t count = 0;
+			int64_t value;
+			while (in.Read(value))
+			{
+				sum += uint64_t(value);
+				count++;
+			}
+			check(sum, count);
+		}, COUNT);
+
+		bench.Run("ParseIntegers -> AutoArray" + suffix, [&]()
+		{
+			FastInput in(path.c_str());
+			AutoArray<int64_t> values;
+			ParseIntegers(in, values);
+			uint64_t sum = 0;
+			for (int64_t value : values)
+				sum += uint64_t(value);
+			check(sum, values.size());
+		}, COUNT);
+
+		// The caller's memory, refilled a chunk at a time
+		std::vector<int64_t> chunk(4096);
+		bench.Run("ParseIntegers -> span" + suffix, [&]()
+		{
+			FastInput in(path.c_str(), InputMode::Read);
+			uint64_t sum = 0;
+			size_t count = 0;
+			while (size_t got = ParseIntegers(in, std::span<int64_t>(chunk)))
+			{
+				for (size_t i = 0; i < got; i++)
+					sum += uint64_t(chunk[i]);
+				count += got;
+			}
+			check(sum, count);
+		}, COUNT);
+	}
+
+    std::cout << "\n";
+    bench.Report();
+
+    std::filesystem::remove(path);
+    return 0;
+}
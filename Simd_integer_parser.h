@@ -0,0 +1,274 @@
+// Bulk integer parsing: SIMD delimiter search and SWAR digit conversion on top of FastInput
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include "Auto_array.h"
+#include "Fast_io.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/*
+	ParseIntegers() reads every whitespace separated integer of a FastInput
+	straight into an AutoArray<int64_t> or a caller's span:
+
+	1. 64 bytes are classified at once (SSE2 / AVX2 on x86-64, NEON on
+	   AArch64) into two 64 bit masks: bytes that aren't separators and
+	   digit bytes. From the first one, 'token & ~(token << 1)' marks where
+	   every number of the block starts and 'token & ~(token >> 1)' where
+	   it ends, so the numbers come out of the block by counting trailing
+	   zeros, without a byte-by-byte loop or a dependency from one number
+	   on the next.
+	2. Up to 16 digits are converted with SWAR arithmetic: 8 ASCII digits
+	   loaded as one uint64_t become their value in three multiplications,
+	   so 16 digits take two such steps and one multiply by 10^8.
+
+	The last bytes of the input, numbers of 17 digits or more and anything
+	that isn't a plain integer (a '.', a letter) go through FastInput::Read(),
+	which checks overflow and handles tokens split across refills. The
+	scanner stops at the first token that isn't an integer; FastInput has
+	skipped it.
+
+	SSE2 and NEON are part of the x86-64 and AArch64 baselines, so there is
+	nothing to dispatch at runtime; a build with -mavx2 classifies with two
+	32 byte loads instead of four 16 byte ones. Other CPUs use a loop.
+*/
+class SimdIntegerScanner
+{
+    static constexpr size_t s_Block = 64;                         // One bit per byte in a uint64_t
+    static constexpr size_t s_Lookahead = s_Block + sizeof(uint64_t); // A block, plus the 8 byte load of a number that ends in it
+    static constexpr size_t s_MaxFastDigits = 16;
+
+    struct t_Masks
+    {
+        uint64_t token;  // Bytes > ' '
+        uint64_t digits; // '0'...'9'
+    };
+
+#if defined(__AVX2__)
+    static uint64_t Mask(__m256i low, __m256i high)
+    {
+        return uint64_t(unsigned(_mm256_movemask_epi8(low))) | uint64_t(unsigned(_mm256_movemask_epi8(high))) << 32;
+    }
+
+    static t_Masks Classify(const char* p)
+    {
+        __m256i token[2], digits[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * i));
+            token[i] = _mm256_cmpeq_epi8(_mm256_max_epu8(bytes, _mm256_set1_epi8(' ' + 1)), bytes);
+            __m256i offset = _mm256_sub_epi8(bytes, _mm256_set1_epi8('0'));
+            digits[i] = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(9)), offset);
+        }
+        return { Mask(token[0], token[1]), Mask(digits[0], digits[1]) };
+    }
+#elif defined(__SSE2__)
+    static t_Masks Classify(const char* p)
+    {
+        t_Masks masks = { 0, 0 };
+        for (int i = 0; i < 4; ++i)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+            __m128i token = _mm_cmpeq_epi8(_mm_max_epu8(bytes, _mm_set1_epi8(' ' + 1)), bytes);
+            __m128i offset = _mm_sub_epi8(bytes, _mm_set1_epi8('0'));
+            __m128i digits = _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(9)), offset);
+            masks.token |= uint64_t(unsigned(_mm_movemask_epi8(token))) << (16 * i);
+            masks.digits |= uint64_t(unsigned(_mm_movemask_epi8(digits))) << (16 * i);
+        }
+        return masks;
+    }
+#elif defined(__aarch64__)
+    // NEON has no movemask: keep one weighted bit per byte and add neighbours pairwise down to 64 bits
+    static uint64_t Mask(const uint8x16_t (&compare)[4])
+    {
+        static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+        uint8x16_t bits = vld1q_u8(weights);
+        uint8x16_t sum01 = vpaddq_u8(vandq_u8(compare[0], bits), vandq_u8(compare[1], bits));
+        uint8x16_t sum23 = vpaddq_u8(vandq_u8(compare[2], bits), vandq_u8(compare[3], bits));
+        uint8x16_t sum = vpaddq_u8(sum01, sum23);
+        sum = vpaddq_u8(sum, sum);
+        return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+    }
+
+    static t_Masks Classify(const char* p)
+    {
+        uint8x16_t token[4], digits[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t*>(p + 16 * i));
+            token[i] = vcgtq_u8(bytes, vdupq_n_u8(' '));
+            digits[i] = vcleq_u8(vsubq_u8(bytes, vdupq_n_u8('0')), vdupq_n_u8(9));
+        }
+        return { Mask(token), Mask(digits) };
+    }
+#else
+    static t_Masks Classify(const char* p)
+    {
+        t_Masks masks = { 0, 0 };
+        for (size_t i = 0; i < s_Block; ++i)
+		{
+			unsigned char c = static_cast<unsigned char>(p[i]);
+			masks.token |= uint64_t(c > ' ') << i;
+			masks.digits |= uint64_t(unsigned(c) - '0' <= 9) << i;
+		}
+        return masks;
+    }
+#endif
+
+    static uint64_t Load8(const char* p)
+    {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        return word;
+    }
+
+    // 8 ASCII digits, the first one in the lowest byte (little endian load)
+    static uint64_t EightDigits(uint64_t word)
+    {
+        word = (word & 0x0F0F0F0F0F0F0F0F) * 2561 >> 8;              // Pairs:  d0*10 + d1
+        word = (word & 0x00FF00FF00FF00FF) * 6553601 >> 16;          // Quads:  pair0*100 + pair1
+        return (word & 0x0000FFFF0000FFFF) * 42949672960001 >> 32;   // Eight:  quad0*10000 + quad1
+    }
+
+    // 1 to 8 digits at 'p': shifted up so the missing leading digits read as zeros
+    static uint64_t FewDigits(const char* p, size_t count)
+    {
+        return EightDigits(Load8(p) << (8 * (8 - count)));
+    }
+
+public:
+    /*
+		Fast path over [p, end), 'p' at a token boundary: parses numbers
+		while at least s_Lookahead bytes follow and calls emit(value) for
+		each, until emit returns false. Returns where it stopped: after the
+		last number it took, or at the start of a token it can't take.
+	*/
+    template<typename Emit>
+    static const char* Scan(const char* p, const char* end, Emit&& emit)
+    {
+        while (size_t(end - p) >= s_Lookahead)
+        {
+            t_Masks masks = Classify(p);
+            uint64_t starts = masks.token & ~(masks.token << 1);
+            uint64_t ends = masks.token & ~(masks.token >> 1);
+            const char* next = p + s_Block;
+
+            if (masks.token >> (s_Block - 1))
+            {
+                // The last token may go on in the next block: that block starts with it
+                size_t last = s_Block - 1 - size_t(__builtin_clzll(starts));
+                if (last == 0)
+                {
+                    return p; // 64 bytes without a separator
+                }
+                starts ^= uint64_t(1) << last;
+                ends ^= uint64_t(1) << (s_Block - 1);
+                next = p + last;
+            }
+
+            // Matching start and end bits are one token each
+            for (; starts; starts &= starts - 1, ends &= ends - 1)
+            {
+                size_t first = size_t(__builtin_ctzll(starts));
+                size_t last = size_t(__builtin_ctzll(ends));
+                const char* token = p + first;
+                bool negative = *token == '-';
+                size_t sign = negative || *token == '+';
+                size_t count = last + 1 - first - sign;
+                uint64_t run = masks.digits >> (first + sign);
+                if (count - 1 >= s_MaxFastDigits || (~run & ((uint64_t(1) << count) - 1)))
+                {
+                    return token; // Not a plain integer, or too long to be sure it fits
+                }
+
+                const char* digits = token + sign;
+                uint64_t magnitude = count <= 8 ? FewDigits(digits, count)
+                                                : FewDigits(digits, count - 8) * 100000000 + EightDigits(Load8(digits + count - 8));
+                if (!emit(negative ? -int64_t(magnitude) : int64_t(magnitude)))
+                {
+                    return p + last + 1;
+                }
+            }
+            p = next;
+        }
+        return p;
+    }
+};
+
+/*
+	Appends every integer of 'in' to 'out'. True when the input ended,
+	false when it stopped at a token that isn't an int64_t.
+*/
+inline bool ParseIntegers(FastInput& in, AutoArray<int64_t>& out)
+{
+    // A number takes at least 2 bytes: room for all of a mapped file at once. Pages that
+    // end up unused are never touched, so over-reserving costs address space, not memory
+    in.Fetch(FastInput::s_MinBufferSize);
+    out.reserve(out.size() + in.Window().size() / 2 + 1);
+    for (;;)
+    {
+        in.Fetch(FastInput::s_MinBufferSize);
+        std::string_view window = in.Window();
+        const char* stop = SimdIntegerScanner::Scan(window.data(), window.data() + window.size(), [&](int64_t value)
+        {
+            out.push_back(value);
+            return true;
+        });
+        in.Consume(size_t(stop - window.data()));
+
+        // Near the end of the window, or a token the fast path leaves alone. Only spaces
+        // left is the end; a token that Read() refuses isn't, even as the last one
+        while (in.Fetch(1) && static_cast<unsigned char>(in.Window()[0]) <= ' ')
+			in.Consume(1);
+        if (in.Window().empty())
+        {
+            return true;
+        }
+        int64_t value;
+        if (!in.Read(value))
+        {
+            return false;
+        }
+        out.push_back(value);
+    }
+}
+
+// Fills 'out' with the next integers of 'in'; returns how many were read (fewer at the end, or at a non-integer)
+inline size_t ParseIntegers(FastInput& in, std::span<int64_t> out)
+{
+    size_t count = 0;
+    while (count < out.size())
+    {
+        in.Fetch(FastInput::s_MinBufferSize);
+        std::string_view window = in.Window();
+        const char* stop = SimdIntegerScanner::Scan(window.data(), window.data() + window.size(), [&](int64_t value)
+        {
+            out[count++] = value;
+            return count < out.size();
+        });
+        in.Consume(size_t(stop - window.data()));
+        if (count == out.size())
+        {
+            break;
+        }
+
+        int64_t value;
+        if (!in.Read(value))
+        {
+            break;
+        }
+        out[count++] = value;
+    }
+    return count;
+}
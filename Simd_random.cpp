@@ -0,0 +1,110 @@
+// Millions of random numbers at once: SimdRandom on every level this CPU supports against one call per number
+#include <iostream>
+#include <cstdint>
+#include <random>
+#include <string>
+#include "Allocator_adapters.h"
+#include "Arena.h"
+#include "Auto_array.h"
+#include "Benchmark.h"
+#include "Fast_random.h"
+#include "Simd_random.h"
+
+constexpr size_t COUNT = 1'000'000;
+
+void BenchmarkLevel(Benchmark& bench, SimdLevel level, AlignedArray<uint32_t>& integers, AlignedArray<float>& floats,
+                    AlignedArray<double>& doubles)
+{
+    SimdRandom<> random(42, level);
+    std::string suffix = std::string(" [") + SimdLevelName(level) + "]";
+
+    bench.Run("SimdRandom uint32 [1, 50]" + suffix, [&]()
+    {
+        random.Fill(integers, 1, 50);
+        ClobberMemory();
+    }, COUNT);
+
+    bench.Run("SimdRandom float [0, 1)" + suffix, [&]()
+    {
+        random.Fill(floats, 0.0f, 1.0f);
+        ClobberMemory();
+    }, COUNT);
+
+    bench.Run("SimdRandom double [0, 1)" + suffix, [&]()
+    {
+        random.Fill(doubles, 0.0, 1.0);
+        ClobberMemory();
+    }, COUNT);
+}
+
+int main(int argc, char** argv)
+{
+    std::cout << "Best SIMD level on this CPU: " << SimdLevelName(DetectSimdLevel()) << "\n";
+
+    // A fixed seed and lane count give the same numbers on every level
+    AutoArray<uint32_t> expected(1001);
+    SimdRandom<>(7, SimdLevel::Scalar).Fill(expected, 0, 999);
+    bool same = true;
+    for (SimdLevel level : { SimdLevel::Sse4, SimdLevel::Avx2, SimdLevel::Avx512, SimdLevel::Neon })
+	{
+		if (!SimdLevelSupported(level))
+			continue;
+		AutoArray<uint32_t> values(1001);
+		SimdRandom<>(7, level).Fill(values, 0, 999);
+		for (size_t i = 0; i < values.size(); ++i)
+			same = same && values[i] == expected[i];
+	}
+    std::cout << "Same numbers on every level: " << (same ? "yes" : "NO") << "\n\n";
+
+    AlignedArray<uint32_t> integers(COUNT);
+    AlignedArray<float> floats(COUNT);
+    AlignedArray<double> doubles(COUNT);
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+
+    // One number per call, as RandomNumGen(a, z) does
+    Xoshiro256StarStar engine(42);
+    bench.Run("loop: RandomInt(xoshiro256**) uint32 [1, 50]", [&]()
+    {
+        for (size_t i = 0; i < COUNT; ++i)
+			integers[i] = RandomInt(engine, 1u, 50u);
+        ClobberMemory();
+    }, COUNT);
+
+    std::mt19937 mt(42);
+    bench.Run("loop: mt19937 + uniform_int_distribution", [&]()
+    {
+        std::uniform_int_distribution<uint32_t> dist(1, 50);
+        for (size_t i = 0; i < COUNT; ++i)
+			integers[i] = dist(mt);
+        ClobberMemory();
+    }, COUNT);
+
+    bench.Run("loop: mt19937 + uniform_real_distribution<float>", [&]()
+    {
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        for (size_t i = 0; i < COUNT; ++i)
+			floats[i] = dist(mt);
+        ClobberMemory();
+    }, COUNT);
+
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::Sse4, SimdLevel::Avx2, SimdLevel::Avx512, SimdLevel::Neon })
+	{
+		if (SimdLevelSupported(level))
+			BenchmarkLevel(bench, level, integers, floats, doubles);
+	}
+
+    // Scratch noise straight into arena memory: no heap call, dropped with the savepoint
+    Arena arena(8 * 1024 * 1024);
+    SimdRandom<> random(42);
+    bench.Run("SimdRandom float into an Arena AutoArray", [&]()
+    {
+        Arena::Savepoint scratch(arena);
+        AutoArray<float, 0, ArenaAllocator<float>> noise{ ArenaAllocator<float>(arena) };
+        noise.resize(COUNT);
+        random.Fill(noise, -1.0f, 1.0f);
+        DoNotOptimize(noise.data());
+    }, COUNT);
+
+    bench.Report();
+    return 0;
+}
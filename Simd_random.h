@@ -0,0 +1,347 @@
+// Bulk random numbers: several xoshiro256** streams stepped side by side in SIMD lanes, written straight into arrays
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include "Fast_random.h"
+#include "Simd_array_ops.h"
+
+/*
+	SimdRandom<Lanes> fills whole buffers (AutoArray, pool or arena memory,
+	std::vector, ... through std::span) with random numbers:
+
+		SimdRandom<> random(seed);
+		AlignedArray<float> noise(1 << 20);
+		random.Fill(noise, -1.0f, 1.0f);             // uniform in [-1, 1)
+		random.Fill(std::span<uint32_t>(dice), 1, 6); // uniform in [1, 6]
+
+	One xoshiro256** step depends on the previous one, so a single engine
+	can't go faster than its dependency chain. SimdRandom runs 'Lanes'
+	independent engines instead (lane k is the seed's stream jumped k
+	times, like ThreadRandom::Stream(k)) and steps them together: xoshiro
+	only needs shifts, xors and adds (the *5 and *9 are a shift and an add),
+	so every instruction set from SSE2 to AVX-512 and NEON runs them in
+	64 bit lanes. The level is picked at runtime like SimdOps.
+
+	Reproducible: the numbers depend only on the seed, the lane count and the
+	sizes of the Fill() calls, never on the SIMD level. Narrow registers
+	simply handle the lanes in several groups, and the scalar level is the
+	same code with one lane per group. Each Fill() draws whole rounds (one
+	number from every lane); the unused part of the last round is dropped.
+
+	Per 64 bit output:
+	- uint32_t in [low, high]: the top 32 bits of the 96 bit product of
+	  the output and the range size, Lemire's mapping without the rejection
+	  step; the bias that step removes is below range / 2^64 <= 2^-32
+	- float in [low, high): two values, 23 random mantissa bits each
+	- double in [low, high): one value, 52 random mantissa bits
+	The floating point ones build a number in [1, 2) from the mantissa bits
+	and subtract 1, which needs no int-to-float conversion instructions.
+	low + (high - low) * u can round up to 'high' when the range is wide
+	compared to its endpoints.
+*/
+
+// One level's entry points for generators of 'Lanes' lanes; 'state' is state[word][lane]
+template<size_t Lanes>
+struct SimdRandomKernels
+{
+    using t_State = uint64_t[4][Lanes];
+
+    void (*bits)(t_State& state, uint64_t* out, size_t n);
+    void (*integers)(t_State& state, uint32_t* out, size_t n, uint32_t low, uint64_t range);
+    void (*floats)(t_State& state, float* out, size_t n, float low, float scale);
+    void (*doubles)(t_State& state, double* out, size_t n, double low, double scale);
+};
+
+// GCC drops vector_size on a non-dependent element type inside a template: go through a dependent one
+template<typename T, size_t Bytes>
+struct SimdRandomVector
+{
+    typedef T type __attribute__((vector_size(Bytes)));
+};
+
+/*
+	The same numbers on every level includes the floating point ones: a
+	level with FMA (AVX-512, NEON) would otherwise fuse u * scale + low
+	into one rounding while the others round twice.
+*/
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+
+/*
+	xoshiro256** with its lanes in registers of 'Bytes' bytes. A level whose
+	registers are wider than the generator uses registers of Lanes * 8 bytes.
+*/
+template<size_t Lanes, size_t Bytes>
+struct SimdRandomKernel
+{
+    static constexpr size_t s_Width = Bytes / 8 < Lanes ? Bytes / 8 : Lanes; // Lanes per register
+    static constexpr size_t s_Groups = Lanes / s_Width;
+    static constexpr size_t s_VectorBytes = s_Width * 8;
+
+    using t_State = uint64_t[4][Lanes];
+    using t_Vector = typename SimdRandomVector<uint64_t, s_VectorBytes>::type;
+    using t_Halves = typename SimdRandomVector<uint32_t, s_VectorBytes>::type;
+    using t_Narrow = typename SimdRandomVector<uint32_t, s_VectorBytes / 2>::type;
+    using t_Floats = typename SimdRandomVector<float, s_VectorBytes>::type;
+    using t_Doubles = typename SimdRandomVector<double, s_VectorBytes>::type;
+
+    // One round of outputs, group by group
+    struct t_Round
+    {
+        t_Vector group[s_Groups];
+    };
+
+    struct t_Engine
+    {
+        t_Vector s[4][s_Groups];
+    };
+
+    template<typename T, size_t VectorBytes>
+    [[gnu::always_inline]] static void Store(T* out, const void* from)
+    {
+        typedef T t_Unaligned __attribute__((vector_size(VectorBytes), aligned(alignof(T)), may_alias));
+        *reinterpret_cast<t_Unaligned*>(out) = *static_cast<const t_Unaligned*>(from);
+    }
+
+    // Low 32 bits of every lane
+    [[gnu::always_inline]] static void Narrow(t_Narrow& to, const t_Vector& from)
+    {
+        to = __builtin_convertvector(from, t_Narrow);
+    }
+
+    template<int K>
+    [[gnu::always_inline]] static void Rotate(t_Vector& x)
+    {
+        x = (x << K) | (x >> (64 - K));
+    }
+
+    [[gnu::always_inline]] static void Load(t_Engine& engine, const t_State& state)
+    {
+        for (size_t word = 0; word < 4; ++word)
+		{
+			for (size_t g = 0; g < s_Groups; ++g)
+				std::memcpy(&engine.s[word][g], &state[word][g * s_Width], s_VectorBytes);
+		}
+    }
+
+    [[gnu::always_inline]] static void Save(t_State& state, const t_Engine& engine)
+    {
+        for (size_t word = 0; word < 4; ++word)
+		{
+			for (size_t g = 0; g < s_Groups; ++g)
+				std::memcpy(&state[word][g * s_Width], &engine.s[word][g], s_VectorBytes);
+		}
+    }
+
+    // Every lane steps once
+    [[gnu::always_inline]] static void Next(t_Engine& engine, t_Round& round)
+    {
+        for (size_t g = 0; g < s_Groups; ++g)
+        {
+            t_Vector& s0 = engine.s[0][g];
+            t_Vector& s1 = engine.s[1][g];
+            t_Vector& s2 = engine.s[2][g];
+            t_Vector& s3 = engine.s[3][g];
+
+            t_Vector rotated = (s1 << 2) + s1;
+            Rotate<7>(rotated);
+            round.group[g] = (rotated << 3) + rotated;
+
+            t_Vector t = s1 << 17;
+            s2 ^= s0;
+            s3 ^= s1;
+            s1 ^= s2;
+            s0 ^= s3;
+            s2 ^= t;
+            Rotate<45>(s3);
+        }
+    }
+
+    /*
+		Runs whole rounds over 'out': convert(group, to) writes one group's
+		'PerGroup' values of T. The last, partial round goes through a
+		buffer, so writes never pass out + n.
+	*/
+    template<typename T, size_t PerGroup, typename Convert>
+    [[gnu::always_inline]] static void Generate(t_State& state, T* out, size_t n, Convert convert)
+    {
+        constexpr size_t s_PerRound = PerGroup * s_Groups;
+        t_Engine engine;
+        Load(engine, state);
+
+        t_Round round;
+        size_t i = 0;
+        for (; i + s_PerRound <= n; i += s_PerRound)
+        {
+            Next(engine, round);
+            for (size_t g = 0; g < s_Groups; ++g)
+				convert(round.group[g], out + i + g * PerGroup);
+        }
+
+        if (i < n)
+        {
+            T rest[s_PerRound];
+            Next(engine, round);
+            for (size_t g = 0; g < s_Groups; ++g)
+				convert(round.group[g], rest + g * PerGroup);
+            std::memcpy(out + i, rest, (n - i) * sizeof(T));
+        }
+        Save(state, engine);
+    }
+
+    [[gnu::always_inline]] static void Bits(t_State& state, uint64_t* out, size_t n)
+    {
+        Generate<uint64_t, s_Width>(state, out, n, [](const t_Vector& x, uint64_t* to)
+        {
+            Store<uint64_t, s_VectorBytes>(to, &x);
+        });
+    }
+
+    // low + (x * range) >> 64 for range <= 2^32, from two 32 x 32 bit products
+    [[gnu::always_inline]] static void Integers(t_State& state, uint32_t* out, size_t n, uint32_t low, uint64_t range)
+    {
+        const t_Vector ranges = t_Vector{} + range;
+        const t_Narrow lows = t_Narrow{} + low;
+        Generate<uint32_t, s_Width>(state, out, n, [&](const t_Vector& x, uint32_t* to)
+        {
+            t_Vector high = (x >> 32) * ranges;
+            t_Vector low_part = ((x & 0xFFFFFFFF) * ranges) >> 32;
+            t_Vector result = (high + low_part) >> 32;
+            t_Narrow values;
+            Narrow(values, result);
+            values += lows;
+            Store<uint32_t, s_VectorBytes / 2>(to, &values);
+        });
+    }
+
+    [[gnu::always_inline]] static void Floats(t_State& state, float* out, size_t n, float low, float scale)
+    {
+        const t_Floats lows = t_Floats{} + low;
+        const t_Floats scales = t_Floats{} + scale;
+        Generate<float, 2 * s_Width>(state, out, n, [&](const t_Vector& x, float* to)
+        {
+            t_Halves bits = (t_Halves(x) >> 9) | 0x3F800000; // 1.mantissa, vector casts keep the bits
+            t_Floats values = (t_Floats(bits) - 1.0f) * scales + lows;
+            Store<float, s_VectorBytes>(to, &values);
+        });
+    }
+
+    [[gnu::always_inline]] static void Doubles(t_State& state, double* out, size_t n, double low, double scale)
+    {
+        const t_Doubles lows = t_Doubles{} + low;
+        const t_Doubles scales = t_Doubles{} + scale;
+        Generate<double, s_Width>(state, out, n, [&](const t_Vector& x, double* to)
+        {
+            t_Vector bits = (x >> 12) | 0x3FF0000000000000;
+            t_Doubles values = (t_Doubles(bits) - 1.0) * scales + lows;
+            Store<double, s_VectorBytes>(to, &values);
+        });
+    }
+};
+
+// Entry points of one level, see SIMD_ARRAY_LEVEL in Simd_array_ops.h
+#define SIMD_RANDOM_LEVEL(Name, Target, Bytes)                                                                        \
+    template<size_t Lanes>                                                                                             \
+    struct Name                                                                                                        \
+    {                                                                                                                  \
+        using t_Kernel = SimdRandomKernel<Lanes, Bytes>;                                                               \
+        using t_State = uint64_t[4][Lanes];                                                                            \
+                                                                                                                       \
+        Target static void Bits(t_State& state, uint64_t* out, size_t n) { t_Kernel::Bits(state, out, n); }            \
+        Target static void Integers(t_State& state, uint32_t* out, size_t n, uint32_t low, uint64_t range)             \
+        {                                                                                                              \
+            t_Kernel::Integers(state, out, n, low, range);                                                             \
+        }                                                                                                              \
+        Target static void Floats(t_State& state, float* out, size_t n, float low, float scale)                        \
+        {                                                                                                              \
+            t_Kernel::Floats(state, out, n, low, scale);                                                               \
+        }                                                                                                              \
+        Target static void Doubles(t_State& state, double* out, size_t n, double low, double scale)                    \
+        {                                                                                                              \
+            t_Kernel::Doubles(state, out, n, low, scale);                                                              \
+        }                                                                                                              \
+                                                                                                                       \
+        static constexpr SimdRandomKernels<Lanes> s_Kernels = { &Bits, &Integers, &Floats, &Doubles };                 \
+    };
+
+// The scalar level is the vector code with one lane per register: same operations, same numbers
+SIMD_RANDOM_LEVEL(SimdRandomScalarLevel, , 8)
+#if defined(__x86_64__) || defined(__i386__)
+SIMD_RANDOM_LEVEL(SimdRandomSse4Level, __attribute__((target("sse4.1"))), 16)
+SIMD_RANDOM_LEVEL(SimdRandomAvx2Level, __attribute__((target("avx2"))), 32)
+SIMD_RANDOM_LEVEL(SimdRandomAvx512Level, __attribute__((target("avx512f"))), 64)
+#elif defined(__aarch64__)
+SIMD_RANDOM_LEVEL(SimdRandomNeonLevel, , 16)
+#endif
+
+#undef SIMD_RANDOM_LEVEL
+#pragma GCC pop_options
+
+template<size_t Lanes>
+const SimdRandomKernels<Lanes>& GetSimdRandomKernels(SimdLevel level)
+{
+    switch (level)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+    case SimdLevel::Sse4: return SimdRandomSse4Level<Lanes>::s_Kernels;
+    case SimdLevel::Avx2: return SimdRandomAvx2Level<Lanes>::s_Kernels;
+    case SimdLevel::Avx512: return SimdRandomAvx512Level<Lanes>::s_Kernels;
+#elif defined(__aarch64__)
+    case SimdLevel::Neon: return SimdRandomNeonLevel<Lanes>::s_Kernels;
+#endif
+    default: return SimdRandomScalarLevel<Lanes>::s_Kernels;
+    }
+}
+
+// 8 lanes: one AVX-512 register, two AVX2 ones, and enough independent chains to keep narrower CPUs busy
+template<size_t Lanes = 8>
+class SimdRandom
+{
+    static_assert(Lanes >= 1 && Lanes <= 32 && (Lanes & (Lanes - 1)) == 0, "SimdRandom: lanes must be a power of two");
+
+    alignas(64) uint64_t m_State[4][Lanes];
+    const SimdRandomKernels<Lanes>* m_Kernels;
+    SimdLevel m_Level;
+
+public:
+    static constexpr size_t s_Lanes = Lanes;
+
+    // 'level' must be supported by the CPU (SimdLevelSupported), the default always is
+    explicit SimdRandom(uint64_t seed, SimdLevel level = DetectSimdLevel())
+        : m_Kernels(&GetSimdRandomKernels<Lanes>(level)), m_Level(level)
+    {
+        Xoshiro256StarStar stream(seed);
+        for (size_t lane = 0; lane < Lanes; ++lane)
+        {
+            std::array<uint64_t, 4> words = stream.State();
+            for (size_t word = 0; word < 4; ++word)
+				m_State[word][lane] = words[word];
+            stream.Jump();
+        }
+    }
+
+    SimdLevel Level() const { return m_Level; }
+
+    // Raw 64 bit outputs
+    void Fill(std::span<uint64_t> out) { m_Kernels->bits(m_State, out.data(), out.size()); }
+
+    // Uniform in [low, high], both included
+    void Fill(std::span<uint32_t> out, uint32_t low, uint32_t high)
+    {
+        m_Kernels->integers(m_State, out.data(), out.size(), low, uint64_t(high - low) + 1);
+    }
+
+    // Uniform in [low, high)
+    void Fill(std::span<float> out, float low, float high)
+    {
+        m_Kernels->floats(m_State, out.data(), out.size(), low, high - low);
+    }
+
+    void Fill(std::span<double> out, double low, double high)
+    {
+        m_Kernels->doubles(m_State, out.data(), out.size(), low, high - low);
+    }
+};
@@ -1,41 +1,68 @@
 // Creating a simple memory arena
 #include <iostream>
+#include "Arena.h"
+#include "Benchmark.h"
 
-struct Arena
+struct Particle
 {
-	char *memory;
-	size_t capacity;
-	size_t offset;
+	double x, y, z;
+	float life;
+};
 
-	Arena(size_t size) : capacity(size), offset(0)
-	{
-		memory = new char[size];
-	}
+int main(int argc, char **argv)
+{
+	Arena arena(1024); // 1 KB arena, grows when it runs out
 
-	void *allocate(size_t size)
-	{
-		if (offset + size > capacity)
-			throw std::bad_alloc();
+	int *arr = (int *)arena.allocate(sizeof(int) * 100); // allocate array of 100 ints
 
-		void *ptr = memory + offset;
-		offset += size;
-		return ptr;
-	}
+	// Typed allocation is aligned for the type
+	double *weights = arena.allocate<double>(16);
 
-	void reset()
+	// Savepoint: everything allocated inside the scope is freed at its end
 	{
-		offset = 0;
+		Arena::Savepoint scratch(arena);
+		Particle *particles = arena.allocate<Particle>(1000); // bigger than the first block
+		particles[999].life = 1.0f;
 	}
 
-	~Arena()
+	// Per request use: reset() keeps the blocks, so the next round allocates nothing
+	for (int request = 0; request < 3; ++request)
 	{
-		delete[] memory;
+		arena.reset();
+		arr = arena.allocate<int>(100);
+		weights = arena.allocate<double>(4000);
+		arr[0] = request;
+		weights[0] = request;
 	}
-};
 
-int main()
-{
-	Arena arena(1024); // 1 KB arena
+	std::cout << "Blocks: " << arena.block_count() << ", capacity: " << arena.capacity() << " bytes\n\n";
 
-	int *arr = (int *)arena.allocate(sizeof(int) * 100); // allocate array of 100 ints
+	// Many small objects: one bump per object and one reset, against a new/delete pair each
+	constexpr int COUNT = 100'000;
+	Particle *particles[COUNT];
+	Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+	bench.Run("arena allocate + reset", [&]()
+	{
+		for (int i = 0; i < COUNT; ++i)
+		{
+			particles[i] = arena.allocate<Particle>();
+			DoNotOptimize(particles[i]);
+		}
+		arena.reset();
+	}, COUNT);
+
+	bench.Run("new / delete", [&]()
+	{
+		for (int i = 0; i < COUNT; ++i)
+		{
+			particles[i] = new Particle;
+			DoNotOptimize(particles[i]);
+		}
+		for (int i = 0; i < COUNT; ++i)
+		{
+			delete particles[i];
+		}
+	}, COUNT);
+
+	bench.Report();
 }
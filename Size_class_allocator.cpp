@@ -0,0 +1,130 @@
+// Small object allocator (size classes on top of MemoryPool) vs new/delete and malloc
+#include <iostream>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "Size_class_allocator.h"
+
+// Mixed size allocation testing
+class MixedSizeTester
+{
+    Benchmark& m_Bench;
+    std::vector<size_t> m_Sizes;
+
+public:
+	// Sizes are drawn once with a fixed seed, so every allocator sees the same requests
+    MixedSizeTester(Benchmark& bench, const size_t block_count, const size_t min_size, const size_t max_size)
+        : m_Bench(bench)
+    {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<size_t> dist(min_size, max_size);
+
+        m_Sizes.reserve(block_count);
+        for (size_t i = 0; i < block_count; i++)
+		{
+			m_Sizes.push_back(dist(rng));
+		}
+    }
+
+    const BenchmarkResult& TestStdNewDelete(const std::string& name)
+    {
+        return m_Bench.Run(name, [&]()
+        {
+            std::vector<void*> ptrs;
+            ptrs.reserve(m_Sizes.size());
+
+            for (size_t size : m_Sizes)
+			{
+				ptrs.push_back(::operator new(size));
+				DoNotOptimize(ptrs.back());
+			}
+
+            for (size_t i = 0; i < ptrs.size(); i++)
+			{
+				::operator delete(ptrs[i], m_Sizes[i]);
+			}
+        }, m_Sizes.size());
+    }
+
+    const BenchmarkResult& TestMalloc(const std::string& name)
+    {
+        return m_Bench.Run(name, [&]()
+        {
+            std::vector<void*> ptrs;
+            ptrs.reserve(m_Sizes.size());
+
+            for (size_t size : m_Sizes)
+			{
+				ptrs.push_back(std::malloc(size));
+				DoNotOptimize(ptrs.back());
+			}
+
+            for (auto p : ptrs)
+			{
+				std::free(p);
+			}
+        }, m_Sizes.size());
+    }
+
+    const BenchmarkResult& TestSizeClassAllocator(const std::string& name, SizeClassAllocator& allocator)
+    {
+        return m_Bench.Run(name, [&]() { AllocateAndFree(allocator); }, m_Sizes.size());
+    }
+
+	// A fresh allocator for every run shows the cost of growing the pools
+    const BenchmarkResult& TestColdSizeClassAllocator(const std::string& name)
+    {
+        std::unique_ptr<SizeClassAllocator> allocator;
+        return m_Bench.RunWithSetup(name,
+            [&]() { allocator = std::make_unique<SizeClassAllocator>(); },
+            [&]() { AllocateAndFree(*allocator); }, m_Sizes.size());
+    }
+
+private:
+    void AllocateAndFree(SizeClassAllocator& allocator)
+    {
+        std::vector<void*> ptrs;
+        ptrs.reserve(m_Sizes.size());
+
+        for (size_t size : m_Sizes)
+		{
+			ptrs.push_back(allocator.Allocate(size));
+			DoNotOptimize(ptrs.back());
+		}
+
+        for (size_t i = 0; i < ptrs.size(); i++)
+		{
+			allocator.Deallocate(ptrs[i], m_Sizes[i]);
+		}
+    }
+};
+
+int main(int argc, char** argv)
+{
+    constexpr size_t BLOCK_COUNT = 1'000'000;
+
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+
+    // Small objects only, then with 10% of the requests above the small object limit
+    MixedSizeTester small_tester(bench, BLOCK_COUNT, 16, SizeClassAllocator::s_MaxSmallSize);
+    MixedSizeTester mixed_tester(bench, BLOCK_COUNT, 16, SizeClassAllocator::s_MaxSmallSize * 11 / 10);
+
+    // First with empty pools every run, then the steady state
+    SizeClassAllocator allocator;
+    small_tester.TestColdSizeClassAllocator("16..512 size classes (cold)");
+    small_tester.TestSizeClassAllocator("16..512 size classes (warm)", allocator);
+    small_tester.TestStdNewDelete("16..512 new/delete");
+    small_tester.TestMalloc("16..512 malloc/free");
+
+    // Large requests fall back to new
+    mixed_tester.TestSizeClassAllocator("16..563 size classes", allocator);
+    mixed_tester.TestStdNewDelete("16..563 new/delete");
+    mixed_tester.TestMalloc("16..563 malloc/free");
+
+    bench.Report();
+
+    return 0;
+}
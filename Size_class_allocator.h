@@ -0,0 +1,146 @@
+// General purpose small object allocator built from one MemoryPool per size class
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <tuple>
+#include <utility>
+#include "Memory_pool.h"
+
+/*
+	Requests up to 512 bytes are rounded up to one of the size classes
+	below and served from the MemoryPool of that class. Anything bigger
+	goes to the system allocator.
+
+	Classes are spaced 16 bytes apart up to 128, then roughly 25% apart,
+	so the internal waste per block stays small without needing dozens
+	of pools. Every class is a multiple of 16, which keeps all returned
+	blocks aligned like 'operator new' would.
+*/
+class SizeClassAllocator
+{
+public:
+    static constexpr size_t s_MaxSmallSize = 512;
+    static constexpr size_t s_Granularity = 16;
+
+private:
+    static constexpr std::array<size_t, 14> s_ClassSizes =
+    {
+        16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 256, 320, 384, 512
+    };
+    static constexpr size_t s_ClassCount = s_ClassSizes.size();
+
+    // Storage type of one block of a class, MemoryPool only knows about types
+    template<size_t Size>
+    struct alignas(s_Granularity) t_Chunk
+    {
+        unsigned char bytes[Size];
+    };
+
+    // Pool of one class, always growable so small requests never hit bad_alloc
+    template<size_t I>
+    struct t_ClassPool : MemoryPool<t_Chunk<s_ClassSizes[I]>>
+    {
+        t_ClassPool(const size_t block_count)
+            : MemoryPool<t_Chunk<s_ClassSizes[I]>>(block_count, PoolGrowth::Geometric)
+        {
+        }
+    };
+
+    template<size_t... I>
+    static auto MakePools(std::index_sequence<I...>) -> std::tuple<t_ClassPool<I>...>;
+
+    using t_Pools = decltype(MakePools(std::make_index_sequence<s_ClassCount>()));
+
+    // size -> class, one entry per 16 byte step, so the lookup is a shift and a load
+    static constexpr std::array<uint8_t, s_MaxSmallSize / s_Granularity + 1> s_ClassOf = []()
+    {
+        std::array<uint8_t, s_MaxSmallSize / s_Granularity + 1> table{};
+        size_t cls = 0;
+        for (size_t step = 0; step < table.size(); ++step)
+        {
+            while (s_ClassSizes[cls] < step * s_Granularity)
+            {
+                ++cls;
+            }
+            table[step] = uint8_t(cls);
+        }
+        return table;
+    }();
+
+    t_Pools m_Pools;
+
+    // One table entry per class, so the pool is picked with a single indirect call
+    template<size_t... I>
+    void* AllocateFromClass(const size_t cls, std::index_sequence<I...>)
+    {
+        using t_AllocateFn = void* (*)(t_Pools&);
+        static constexpr t_AllocateFn s_Table[] =
+        {
+            [](t_Pools& pools) -> void* { return std::get<I>(pools).Allocate(); }...
+        };
+        return s_Table[cls](m_Pools);
+    }
+
+    template<size_t... I>
+    void DeallocateToClass(void* p, const size_t cls, std::index_sequence<I...>)
+    {
+        using t_DeallocateFn = void (*)(t_Pools&, void*);
+        static constexpr t_DeallocateFn s_Table[] =
+        {
+            [](t_Pools& pools, void* block)
+            {
+                std::get<I>(pools).Deallocate(static_cast<t_Chunk<s_ClassSizes[I]>*>(block));
+            }...
+        };
+        s_Table[cls](m_Pools, p);
+    }
+
+    template<size_t... I>
+    SizeClassAllocator(const size_t blocks_per_class, std::index_sequence<I...>)
+        : m_Pools(((void)I, blocks_per_class)...)
+    {
+    }
+
+public:
+    // 'blocks_per_class' is the size of the first slab of every pool, they grow from there
+    explicit SizeClassAllocator(const size_t blocks_per_class = 1024)
+        : SizeClassAllocator(blocks_per_class, std::make_index_sequence<s_ClassCount>())
+    {
+    }
+
+    SizeClassAllocator(const SizeClassAllocator&) = delete;
+    SizeClassAllocator& operator=(const SizeClassAllocator&) = delete;
+
+    static constexpr size_t ClassOf(const size_t size)
+    {
+        return s_ClassOf[(size + s_Granularity - 1) / s_Granularity];
+    }
+
+    // Bytes actually reserved for a request of 'size' bytes
+    static constexpr size_t RoundedSize(const size_t size)
+    {
+        return size <= s_MaxSmallSize ? s_ClassSizes[ClassOf(size)] : size;
+    }
+
+    void* Allocate(const size_t size)
+    {
+        if (size > s_MaxSmallSize)
+        {
+            return ::operator new(size);
+        }
+        return AllocateFromClass(ClassOf(size), std::make_index_sequence<s_ClassCount>());
+    }
+
+    // Sized deallocation: 'size' must be the value passed to Allocate()
+    void Deallocate(void* p, const size_t size)
+    {
+        if (size > s_MaxSmallSize)
+        {
+            ::operator delete(p);
+            return;
+        }
+        DeallocateToClass(p, ClassOf(size), std::make_index_sequence<s_ClassCount>());
+    }
+};
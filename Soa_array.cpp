@@ -0,0 +1,130 @@
+// Scanning one field of millions of structs: array of structs (AutoArray) against structure of arrays (SoAArray)
+#include <iostream>
+#include <cstdint>
+#include "Allocator_adapters.h"
+#include "Arena.h"
+#include "Auto_array.h"
+#include "Benchmark.h"
+#include "Simd_array_ops.h"
+#include "Soa_array.h"
+
+// 32 bytes: a scan of 'mass' uses 4 of every 32 bytes it loads
+struct Particle
+{
+    float x, y, z;
+    float vx, vy, vz;
+    float mass;
+    int32_t id;
+};
+
+// Same fields, one column each
+enum ParticleField { X, Y, Z, VX, VY, VZ, MASS, ID };
+using Particles = SoAArray<float, float, float, float, float, float, float, int32_t>;
+
+constexpr size_t COUNT = 4'000'000;
+
+int main(int argc, char** argv)
+{
+    AutoArray<Particle> aos;
+    Particles soa;
+    aos.reserve(COUNT);
+    soa.reserve(COUNT);
+    for (size_t i = 0; i < COUNT; i++)
+	{
+		float f = float(i % 1000);
+		aos.push_back({ f, f, f, 1.0f, 0.5f, 0.25f, f * 0.01f, int32_t(i) });
+		soa.push_back(f, f, f, 1.0f, 0.5f, 0.25f, f * 0.01f, int32_t(i));
+	}
+
+    // Element access still looks like a struct
+    auto [x, y, z, vx, vy, vz, mass, id] = soa[42];
+    std::cout << "soa[42]: x " << x << ", mass " << mass << ", id " << id << "\n";
+    mass = 2.0f;
+    std::cout << "after 'mass = 2': " << soa.Column<MASS>()[42] << "\n\n";
+    soa.Column<MASS>()[42] = aos[42].mass;
+
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+
+    bench.Run("AutoArray<Particle>: sum mass", [&]()
+    {
+        double total = 0;
+        for (const Particle& particle : aos)
+			total += particle.mass;
+        DoNotOptimize(total);
+    }, COUNT);
+
+    bench.Run("SoAArray: sum mass", [&]()
+    {
+        double total = 0;
+        for (float m : soa.Column<MASS>())
+			total += m;
+        DoNotOptimize(total);
+    }, COUNT);
+
+    SimdOps<float> simd;
+    bench.Run(std::string("SoAArray: sum mass, SimdOps [") + SimdLevelName(simd.Level()) + "]", [&]()
+    {
+        DoNotOptimize(simd.Sum(soa.Column<MASS>()));
+    }, COUNT);
+
+    bench.Run("AutoArray<Particle>: count mass < 2.5", [&]()
+    {
+        size_t light = 0;
+        for (const Particle& particle : aos)
+			light += particle.mass < 2.5f;
+        DoNotOptimize(light);
+    }, COUNT);
+
+    bench.Run("SoAArray: count mass < 2.5, SimdOps", [&]()
+    {
+        DoNotOptimize(simd.Count(soa.Column<MASS>(), SimdCompare::Less, 2.5f));
+    }, COUNT);
+
+    // Two fields: x += vx
+    bench.Run("AutoArray<Particle>: x += vx", [&]()
+    {
+        for (Particle& particle : aos)
+			particle.x += particle.vx;
+        ClobberMemory();
+    }, COUNT);
+
+    bench.Run("SoAArray: x += vx", [&]()
+    {
+        float* px = soa.Column<X>().data();
+        const float* pvx = soa.Column<VX>().data();
+        for (size_t i = 0; i < soa.size(); i++)
+			px[i] += pvx[i];
+        ClobberMemory();
+    }, COUNT);
+
+    // Building one from scratch, columns in an arena
+    Arena arena(64 * 1024 * 1024);
+    bench.Run("SoAArray on Arena: push_back", [&]()
+    {
+        Arena::Savepoint scratch(arena);
+        BasicSoAArray<ArenaAllocator<char>, float, float, float, float, float, float, float, int32_t> built{ ArenaAllocator<char>(arena) };
+        for (size_t i = 0; i < COUNT; i++)
+			built.push_back(1.0f, 2.0f, 3.0f, 1.0f, 0.5f, 0.25f, 0.1f, int32_t(i));
+        DoNotOptimize(built.Column<ID>().data());
+    }, COUNT);
+
+    bench.Run("SoAArray: push_back", [&]()
+    {
+        Particles built;
+        for (size_t i = 0; i < COUNT; i++)
+			built.push_back(1.0f, 2.0f, 3.0f, 1.0f, 0.5f, 0.25f, 0.1f, int32_t(i));
+        DoNotOptimize(built.Column<ID>().data());
+    }, COUNT);
+
+    bench.Run("AutoArray<Particle>: push_back", [&]()
+    {
+        AutoArray<Particle> built;
+        for (size_t i = 0; i < COUNT; i++)
+			built.push_back({ 1.0f, 2.0f, 3.0f, 1.0f, 0.5f, 0.25f, 0.1f, int32_t(i) });
+        DoNotOptimize(built.data());
+    }, COUNT);
+
+    bench.Report();
+
+    return 0;
+}
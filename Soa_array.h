@@ -0,0 +1,252 @@
+// Structure-of-arrays container: every field in its own aligned column, element access like an array of structs
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "Auto_array.h"
+#include "Bit_tricks.h"
+
+/*
+	SoAArray<Fields...>
+
+	An AutoArray<Particle> puts x, y, z, mass, ... of one particle next to
+	each other, so a loop that only reads 'mass' drags every other field
+	through the cache with it. SoAArray<float, float, float, float> keeps
+	one contiguous column per field instead:
+
+		x[0] x[1] x[2] ...  | y[0] y[1] y[2] ...  | ...  | mass[0] mass[1] ...
+
+	- all columns share one allocation (an AutoArray of bytes), every column
+	  starts on a 64 byte boundary, so SIMD loads (Simd_array_ops.h) are
+	  aligned and columns never share a cache line
+	- Column<I>() is a std::span<T> of field I: plain loops over it
+	  vectorize, and SimdOps<T> takes it directly
+	- soa[i] gives an AoS-style proxy, a std::tuple of references:
+		auto [x, y, z, mass] = soa[i];  // references into the columns
+		soa[i] = std::tuple(1.0f, 2.0f, 3.0f, 0.5f);
+	- fields must be trivially copyable: growth moves columns with memcpy,
+	  and new elements start zeroed
+
+	BasicSoAArray<Allocator, Fields...> takes the memory from any allocator
+	(rebound to bytes), e.g. ArenaAllocator<char> or PoolAllocator<char> from
+	Allocator_adapters.h. The columns are aligned by SoAArray itself, the
+	allocator only has to provide bytes.
+*/
+template<typename Allocator, typename... Fields>
+class BasicSoAArray
+{
+    static_assert(sizeof...(Fields) > 0, "SoAArray: needs at least one field");
+    static_assert((std::is_trivially_copyable_v<Fields> && ...), "SoAArray: fields must be trivially copyable");
+
+    using t_ByteAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<unsigned char>;
+    using t_Storage = AutoArray<unsigned char, 0, t_ByteAllocator>;
+    using t_Columns = std::tuple<Fields*...>;
+    using t_Indices = std::index_sequence_for<Fields...>;
+
+public:
+    static constexpr size_t s_Alignment = 64;
+
+    template<size_t I>
+    using Field = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+    using Value = std::tuple<Fields...>;
+    using Reference = std::tuple<Fields&...>;
+    using ConstReference = std::tuple<const Fields&...>;
+
+private:
+    t_Storage m_Storage; // Only its capacity is used: the columns live in its buffer
+    t_Columns m_Columns{};
+    size_t m_Size = 0;
+    size_t m_Capacity = 0;
+
+    static size_t RoundUp(size_t bytes)
+    {
+        return AlignUp(bytes, s_Alignment);
+    }
+
+    // Columns for 'capacity' elements, plus room to align the first one
+    static size_t StorageBytes(size_t capacity)
+    {
+        return (RoundUp(capacity * sizeof(Fields)) + ...) + s_Alignment - 1;
+    }
+
+    template<typename T>
+    static T* CarveColumn(unsigned char*& next, size_t capacity)
+    {
+        T* column = reinterpret_cast<T*>(next);
+        next += RoundUp(capacity * sizeof(T));
+        return column;
+    }
+
+    // Lay out the columns of 'capacity' elements in 'storage'
+    static t_Columns Carve(unsigned char* storage, size_t capacity)
+    {
+        uintptr_t address = reinterpret_cast<uintptr_t>(storage);
+        unsigned char* next = storage + (RoundUp(address) - address);
+        return t_Columns{ CarveColumn<Fields>(next, capacity)... }; // Braced lists evaluate left to right
+    }
+
+    template<size_t... I>
+    static void CopyColumns(const t_Columns& to, const t_Columns& from, size_t begin, size_t count, std::index_sequence<I...>)
+    {
+        if (count)
+        {
+            (std::memcpy(std::get<I>(to) + begin, std::get<I>(from) + begin, count * sizeof(Fields)), ...);
+        }
+    }
+
+    template<size_t... I>
+    void ZeroColumns(size_t begin, size_t count, std::index_sequence<I...>)
+    {
+        if (count)
+        {
+            (std::memset(static_cast<void*>(std::get<I>(m_Columns) + begin), 0, count * sizeof(Fields)), ...);
+        }
+    }
+
+    void Reallocate(size_t capacity)
+    {
+        t_Storage storage(m_Storage.get_allocator());
+        storage.reserve(StorageBytes(capacity));
+        t_Columns columns = Carve(storage.data(), capacity);
+        CopyColumns(columns, m_Columns, 0, m_Size, t_Indices());
+
+        m_Storage = std::move(storage); // Same allocator: the buffer changes hands, nothing is copied
+        m_Columns = columns;
+        m_Capacity = capacity;
+    }
+
+    size_t GrownCapacity(size_t needed) const
+    {
+        size_t grown = m_Capacity ? m_Capacity * 2 : 16;
+        return grown > needed ? grown : needed;
+    }
+
+    template<size_t... I>
+    Reference At(size_t index, std::index_sequence<I...>) { return Reference(std::get<I>(m_Columns)[index]...); }
+
+    template<size_t... I>
+    ConstReference At(size_t index, std::index_sequence<I...>) const
+    {
+        return ConstReference(std::get<I>(m_Columns)[index]...);
+    }
+
+    void Release(BasicSoAArray& other)
+    {
+        other.m_Columns = {};
+        other.m_Size = 0;
+        other.m_Capacity = 0;
+    }
+
+public:
+    BasicSoAArray() = default;
+
+    explicit BasicSoAArray(const Allocator& allocator) : m_Storage(t_ByteAllocator(allocator)) {}
+
+    BasicSoAArray(const BasicSoAArray&) = delete;
+    BasicSoAArray& operator=(const BasicSoAArray&) = delete;
+
+    BasicSoAArray(BasicSoAArray&& other) noexcept
+        : m_Storage(std::move(other.m_Storage)), m_Columns(other.m_Columns), m_Size(other.m_Size),
+          m_Capacity(other.m_Capacity)
+    {
+        Release(other);
+    }
+
+    BasicSoAArray& operator=(BasicSoAArray&& other)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+
+        if (std::allocator_traits<t_ByteAllocator>::propagate_on_container_move_assignment::value ||
+            m_Storage.get_allocator() == other.m_Storage.get_allocator())
+        {
+            m_Storage = std::move(other.m_Storage);
+            m_Columns = other.m_Columns;
+            m_Size = other.m_Size;
+            m_Capacity = other.m_Capacity;
+            Release(other);
+        }
+        else
+        {
+            // Other memory source: keep ours and copy the columns over
+            m_Size = 0;
+            reserve(other.m_Size);
+            CopyColumns(m_Columns, other.m_Columns, 0, other.m_Size, t_Indices());
+            m_Size = other.m_Size;
+            other.m_Size = 0;
+        }
+        return *this;
+    }
+
+    size_t size() const { return m_Size; }
+    size_t capacity() const { return m_Capacity; }
+    bool empty() const { return m_Size == 0; }
+
+    void reserve(size_t capacity)
+    {
+        if (capacity > m_Capacity)
+        {
+            Reallocate(capacity);
+        }
+    }
+
+    // New elements are zeroed
+    void resize(size_t count)
+    {
+        reserve(count);
+        if (count > m_Size)
+        {
+            ZeroColumns(m_Size, count - m_Size, t_Indices());
+        }
+        m_Size = count;
+    }
+
+    void push_back(const Fields&... values)
+    {
+        if (m_Size == m_Capacity)
+        {
+            // The values may point into the columns that are about to move
+            Value copy(values...);
+            Reallocate(GrownCapacity(m_Size + 1));
+            At(m_Size++, t_Indices()) = copy;
+            return;
+        }
+        At(m_Size++, t_Indices()) = std::tie(values...);
+    }
+
+    void push_back(const Value& value)
+    {
+        std::apply([this](const Fields&... values) { push_back(values...); }, value);
+    }
+
+    void pop_back() { --m_Size; }
+    void clear() { m_Size = 0; }
+
+    // AoS view of element 'index': a tuple of references into the columns
+    Reference operator[](size_t index) { return At(index, t_Indices()); }
+    ConstReference operator[](size_t index) const { return At(index, t_Indices()); }
+
+    // Field I of every element, contiguous and 64 byte aligned
+    template<size_t I>
+    std::span<Field<I>> Column()
+    {
+        return { static_cast<Field<I>*>(__builtin_assume_aligned(std::get<I>(m_Columns), s_Alignment)), m_Size };
+    }
+
+    template<size_t I>
+    std::span<const Field<I>> Column() const
+    {
+        return { static_cast<const Field<I>*>(__builtin_assume_aligned(std::get<I>(m_Columns), s_Alignment)), m_Size };
+    }
+};
+
+template<typename... Fields>
+using SoAArray = BasicSoAArray<std::allocator<unsigned char>, Fields...>;
@@ -0,0 +1,161 @@
+// Parsing several files of integers: FastInput one file after another against StreamingReader (io_uring or mmap) keeping reads in flight
+#include <iostream>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "Fast_io.h"
+#include "Simd_integer_parser.h"
+#include "Streaming_reader.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+constexpr size_t FILE_COUNT = 4;
+constexpr size_t COUNT_PER_FILE = 4'000'000; // About 40 MiB per file
+
+// Drops the files from the page cache, so the next read comes from the device
+void Evict(const std::vector<std::string>& paths)
+{
+    for (const std::string& path : paths)
+	{
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			continue;
+		fdatasync(fd);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		::close(fd);
+	}
+}
+
+const char* BackendName(StreamBackend backend)
+{
+    return backend == StreamBackend::IoUring ? "io_uring" : "mmap";
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions defaults;
+    defaults.repetitions = 5;
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv, defaults));
+
+    std::vector<std::string> paths;
+    long long expected = 0;
+    {
+        std::mt19937_64 random(7);
+        std::uniform_int_distribution<int64_t> numbers(-2'000'000'000, 2'000'000'000);
+        for (size_t file = 0; file < FILE_COUNT; file++)
+		{
+			paths.push_back((std::filesystem::temp_directory_path() / ("streaming_reader_" + std::to_string(file) + ".txt")).string());
+			FastOutput out(paths.back().c_str());
+			for (size_t i = 0; i < COUNT_PER_FILE; i++)
+			{
+				int64_t value = numbers(random);
+				expected += value;
+				out << value << (i % 16 == 15 ? '\n' : ' ');
+			}
+		}
+    }
+    uint64_t total_bytes = 0;
+    for (const std::string& path : paths)
+		total_bytes += std::filesystem::file_size(path);
+    std::cout << FILE_COUNT << " files, " << total_bytes / (1024 * 1024) << " MiB\n";
+
+    const size_t total_count = FILE_COUNT * COUNT_PER_FILE;
+    auto check = [&](const std::string& name, long long sum, size_t count)
+    {
+        if (sum != expected || count != total_count)
+			std::cerr << "wrong result for " << name << "\n";
+    };
+
+    StreamBackend picked;
+    {
+        StreamingReader probe(paths);
+        picked = probe.Backend();
+        std::cout << "StreamingReader picks " << BackendName(picked)
+                  << (probe.FixedBuffers() ? " with registered buffers" : "") << "\n\n";
+    }
+
+    struct Reader
+    {
+        std::string name;
+        StreamOptions options;
+    };
+    std::vector<Reader> readers;
+    // Without io_uring (old kernel, seccomp, io_uring_disabled) only the mmap row is measured
+    if (picked == StreamBackend::IoUring)
+    {
+        for (uint32_t files : { 1u, 4u })
+		{
+			StreamOptions options;
+			options.backend = StreamBackend::IoUring;
+			options.filesInFlight = files;
+			readers.push_back({ "StreamingReader, io_uring, " + std::to_string(files) + (files == 1 ? " file" : " files") + " in flight", options });
+		}
+    }
+    {
+        StreamOptions options;
+        options.backend = StreamBackend::Map;
+        readers.push_back({ "StreamingReader, mmap + MADV_SEQUENTIAL", options });
+    }
+
+    // Page cache hot: the cost of the parse and of handing chunks around. Cold: the device, and how much of it overlaps the parse
+    for (bool cold : { false, true })
+	{
+		const std::string suffix = cold ? " (cold)" : " (cached)";
+		auto setup = [&]()
+		{
+			if (cold)
+				Evict(paths);
+		};
+
+		for (InputMode mode : { InputMode::Map, InputMode::Read })
+		{
+			const std::string name = std::string("FastInput ") + (mode == InputMode::Map ? "mmap" : "read") + ", one file after another" + suffix;
+			bench.RunWithSetup(name, setup, [&]()
+			{
+				long long sum = 0;
+				size_t count = 0;
+				for (const std::string& path : paths)
+				{
+					FastInput in(path.c_str(), mode);
+					AutoArray<int64_t> values;
+					ParseIntegers(in, values);
+					for (int64_t value : values)
+						sum += value;
+					count += values.size();
+				}
+				check(name, sum, count);
+			}, total_count);
+		}
+
+		for (const Reader& reader : readers)
+		{
+			StreamStats stats;
+			bench.RunWithSetup(reader.name + suffix, setup, [&]()
+			{
+				StreamingReader in(paths, reader.options);
+				long long sum = 0;
+				size_t count = 0;
+				ParseIntegers(in, [&](uint32_t, int64_t value)
+				{
+					sum += value;
+					count++;
+				});
+				check(reader.name, sum, count);
+				stats = in.Stats();
+			}, total_count);
+			// Stalls: the parser kept every buffer; with few, the reads are ahead of it
+			std::cout << reader.name << suffix << ": " << stats.chunks << " chunks, " << stats.stalls << " stalls\n";
+		}
+	}
+
+    std::cout << "\n";
+    bench.Report();
+
+    for (const std::string& path : paths)
+		std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,783 @@
+// Streaming input over many files: reads kept in flight with io_uring (or mmap + madvise), chunks handed to the parser through a lock-free ring
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include "Asm_kernels.h"
+#include "Backing_memory.h"
+#include "Bit_tricks.h"
+#include "Ring_buffer.h"
+#include "Simd_integer_parser.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define STREAMING_READER_IO_URING 1
+#else
+#define STREAMING_READER_IO_URING 0
+#endif
+
+#if STREAMING_READER_IO_URING
+/*
+	The smallest io_uring front end that does the job, straight on the
+	system calls (no liburing): one submission queue and one completion
+	queue shared with the kernel through mmap. Single threaded: the thread
+	that prepares entries is the one that reaps them.
+*/
+class IoUring
+{
+    int m_Fd = -1;
+    void* m_SqRing = MAP_FAILED;
+    void* m_CqRing = MAP_FAILED;
+    io_uring_sqe* m_Sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t m_SqRingBytes = 0;
+    size_t m_CqRingBytes = 0;
+    size_t m_SqesBytes = 0;
+
+    unsigned* m_SqHead = nullptr;
+    unsigned* m_SqTail = nullptr;
+    unsigned* m_SqArray = nullptr;
+    unsigned m_SqMask = 0;
+    unsigned m_SqEntries = 0;
+    unsigned m_SqPrepared = 0;  // Our tail: entries filled in, published on Submit()
+    unsigned m_SqSubmitted = 0; // Entries the kernel has taken
+
+    unsigned* m_CqHead = nullptr;
+    unsigned* m_CqTail = nullptr;
+    io_uring_cqe* m_Cqes = nullptr;
+    unsigned m_CqMask = 0;
+
+    [[noreturn]] void Fail(const char* what)
+    {
+        int error = errno;
+        Close();
+        throw std::system_error(error, std::generic_category(), what);
+    }
+
+    void* MapRing(size_t bytes, off_t offset)
+    {
+        return mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, offset);
+    }
+
+    void Close()
+    {
+        if (m_Sqes != MAP_FAILED)
+			munmap(m_Sqes, m_SqesBytes);
+        if (m_CqRing != MAP_FAILED && m_CqRing != m_SqRing)
+			munmap(m_CqRing, m_CqRingBytes);
+        if (m_SqRing != MAP_FAILED)
+			munmap(m_SqRing, m_SqRingBytes);
+        if (m_Fd >= 0)
+			::close(m_Fd);
+        m_Fd = -1;
+        m_SqRing = m_CqRing = MAP_FAILED;
+        m_Sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    }
+
+    template<typename T>
+    static T* At(void* ring, unsigned offset)
+    {
+        return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+    }
+
+public:
+    // Throws std::system_error when the kernel has no io_uring or won't let us use it (ENOSYS, EPERM under seccomp)
+    explicit IoUring(unsigned entries)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        m_Fd = int(syscall(__NR_io_uring_setup, entries, &params));
+        if (m_Fd < 0)
+			Fail("io_uring_setup");
+
+        m_SqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_CqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap)
+			m_SqRingBytes = m_CqRingBytes = m_SqRingBytes > m_CqRingBytes ? m_SqRingBytes : m_CqRingBytes;
+
+        if ((m_SqRing = MapRing(m_SqRingBytes, IORING_OFF_SQ_RING)) == MAP_FAILED)
+			Fail("io_uring: mmap");
+        m_CqRing = single_mmap ? m_SqRing : MapRing(m_CqRingBytes, IORING_OFF_CQ_RING);
+        if (m_CqRing == MAP_FAILED)
+			Fail("io_uring: mmap");
+        m_SqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+        m_Sqes = static_cast<io_uring_sqe*>(MapRing(m_SqesBytes, IORING_OFF_SQES));
+        if (m_Sqes == MAP_FAILED)
+			Fail("io_uring: mmap");
+
+        m_SqHead = At<unsigned>(m_SqRing, params.sq_off.head);
+        m_SqTail = At<unsigned>(m_SqRing, params.sq_off.tail);
+        m_SqArray = At<unsigned>(m_SqRing, params.sq_off.array);
+        m_SqMask = *At<unsigned>(m_SqRing, params.sq_off.ring_mask);
+        m_SqEntries = params.sq_entries;
+        m_SqPrepared = m_SqSubmitted = *m_SqTail;
+
+        m_CqHead = At<unsigned>(m_CqRing, params.cq_off.head);
+        m_CqTail = At<unsigned>(m_CqRing, params.cq_off.tail);
+        m_Cqes = At<io_uring_cqe>(m_CqRing, params.cq_off.cqes);
+        m_CqMask = *At<unsigned>(m_CqRing, params.cq_off.ring_mask);
+    }
+
+    ~IoUring() { Close(); }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Pins 'count' buffers for IORING_OP_READ_FIXED; false if the kernel refuses (RLIMIT_MEMLOCK, old kernel)
+    bool RegisterBuffers(const iovec* buffers, unsigned count)
+    {
+        return syscall(__NR_io_uring_register, m_Fd, IORING_REGISTER_BUFFERS, buffers, count) == 0;
+    }
+
+    // A zeroed entry to fill in, nullptr when the submission queue is full
+    io_uring_sqe* NextEntry()
+    {
+        if (m_SqPrepared - std::atomic_ref<unsigned>(*m_SqHead).load(std::memory_order_acquire) >= m_SqEntries)
+			return nullptr;
+        unsigned index = m_SqPrepared & m_SqMask;
+        io_uring_sqe* entry = &m_Sqes[index];
+        std::memset(entry, 0, sizeof(*entry));
+        m_SqArray[index] = index;
+        ++m_SqPrepared;
+        return entry;
+    }
+
+    // Hands the prepared entries to the kernel, and with 'wait_for' > 0 sleeps until that many completions are in
+    void Submit(unsigned wait_for = 0)
+    {
+        std::atomic_ref<unsigned>(*m_SqTail).store(m_SqPrepared, std::memory_order_release);
+        for (;;)
+		{
+			long done = syscall(__NR_io_uring_enter, m_Fd, m_SqPrepared - m_SqSubmitted, wait_for,
+			                    wait_for ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+			if (done >= 0)
+			{
+				m_SqSubmitted += unsigned(done);
+				return;
+			}
+			if (errno != EINTR)
+				throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+		}
+    }
+
+    bool PopCompletion(io_uring_cqe& out)
+    {
+        unsigned head = *m_CqHead;
+        if (head == std::atomic_ref<unsigned>(*m_CqTail).load(std::memory_order_acquire))
+			return false;
+        out = m_Cqes[head & m_CqMask];
+        std::atomic_ref<unsigned>(*m_CqHead).store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+#endif
+
+enum class StreamBackend
+{
+    Auto,    // io_uring when the kernel allows it, Map otherwise
+    IoUring,
+    Map
+};
+
+struct StreamOptions
+{
+    size_t chunkBytes = size_t(1) << 20;
+    uint32_t buffers = 16;      // Chunks alive at once, in flight or with the consumer: the memory bound
+    uint32_t depthPerFile = 4;  // Reads in flight per file
+    uint32_t filesInFlight = 4; // Files read at once; spread over devices, each one adds its own bandwidth
+    StreamBackend backend = StreamBackend::Auto;
+};
+
+// A piece of one file; the chunks of a file arrive in order, those of different files interleaved
+struct StreamChunk
+{
+    const char* data = nullptr;
+    size_t size = 0;
+    uint32_t file = 0;   // Index in the list given to the reader
+    uint64_t offset = 0; // Of data[0] in the file
+    bool last = false;   // Nothing of this file after it
+};
+
+struct StreamStats
+{
+    uint64_t bytes = 0;
+    uint64_t chunks = 0;
+    uint64_t stalls = 0; // Times the I/O thread had nothing to read into: every buffer was with the consumer
+};
+
+/*
+	Reads a list of files on a background thread, a few chunks ahead of the
+	consumer, and hands the chunks over through an SpscRing; the consumer
+	gives each one back with Release() through a second ring. Only
+	'buffers' chunks exist, so when the consumer falls behind the I/O
+	thread runs out of buffers and waits for it (back pressure): memory use
+	stays fixed however fast the disks are.
+
+		StreamingReader reader({ "a.txt", "b.txt" });
+		while (const StreamChunk* chunk = reader.Next())
+		{
+			Parse(chunk->file, chunk->data, chunk->size);
+			reader.Release(chunk);
+		}
+
+	io_uring: the buffers are registered with the kernel once (fixed
+	buffers, no page pinning per read) and up to 'depthPerFile' reads per
+	file are queued on 'filesInFlight' files at a time; one system call
+	submits new reads and collects finished ones. Reads that complete out
+	of order wait until the chunks before them are in.
+
+	Map, when io_uring isn't available: each file is mapped with
+	madvise(MADV_SEQUENTIAL) and the I/O thread touches every page of a
+	chunk before handing it over, so the page faults, and the disk reads
+	behind them, happen there instead of in the parser.
+
+	One consumer thread. Open errors throw from the constructor, read
+	errors from Next(), as std::system_error.
+*/
+class StreamingReader
+{
+    struct t_Slot : StreamChunk
+    {
+        char* buffer = nullptr; // io_uring only
+        uint32_t index = 0;
+        size_t filled = 0;      // Bytes read so far, a read can come back short
+    };
+
+    struct t_File
+    {
+        int fd = -1;
+        uint64_t size = 0;
+        uint64_t issued = 0;    // Bytes asked for
+        uint64_t delivered = 0; // Bytes handed to the consumer, in order
+        uint32_t inFlight = 0;
+        std::vector<t_Slot*> early; // Complete, waiting for the chunks before them
+        char* mapped = nullptr;
+        uint32_t withConsumer = 0;  // Map: chunks not released yet
+    };
+
+    StreamOptions m_Options;
+    std::vector<t_File> m_Files;
+    std::unique_ptr<t_Slot[]> m_Slots;
+    MmapBacking m_Backing{ MmapBacking::Options{ MmapBacking::HugePages::None, true, -1 } };
+    char* m_Buffers = nullptr;
+    size_t m_BufferBytes = 0;
+#if STREAMING_READER_IO_URING
+    std::unique_ptr<IoUring> m_Ring;
+#endif
+    bool m_FixedBuffers = false;
+
+    SpscRing<t_Slot*> m_Ready; // I/O thread -> consumer, nullptr at the end
+    SpscRing<t_Slot*> m_Free;  // Consumer -> I/O thread
+    std::atomic<bool> m_Stop{ false };
+    std::atomic<uint64_t> m_Bytes{ 0 };
+    std::atomic<uint64_t> m_Chunks{ 0 };
+    std::atomic<uint64_t> m_Stalls{ 0 };
+    std::exception_ptr m_Error; // Written by the I/O thread before the end marker
+    bool m_Finished = false;
+    std::thread m_Thread;
+
+    [[noreturn]] static void Fail(int error, const std::string& what)
+    {
+        throw std::system_error(error, std::generic_category(), what);
+    }
+
+    void Deliver(t_Slot* slot)
+    {
+        m_Bytes.fetch_add(slot->size, std::memory_order_relaxed);
+        m_Chunks.fetch_add(1, std::memory_order_relaxed);
+        m_Ready.Push(slot); // Never blocks: the ring has room for every slot and the end marker
+    }
+
+    // Waits for a buffer the consumer gave back; nullptr if the reader is being destroyed
+    t_Slot* WaitForFree(std::vector<t_Slot*>& spare)
+    {
+        if (!spare.empty())
+		{
+			t_Slot* slot = spare.back();
+			spare.pop_back();
+			return slot;
+		}
+        m_Stalls.fetch_add(1, std::memory_order_relaxed);
+        SpinBackoff backoff;
+        t_Slot* slot;
+        while (!m_Free.TryPop(slot))
+		{
+			if (m_Stop.load(std::memory_order_relaxed))
+				return nullptr;
+			backoff.Pause();
+		}
+        return slot;
+    }
+
+#if STREAMING_READER_IO_URING
+    void Queue(t_Slot* slot)
+    {
+        io_uring_sqe* entry = m_Ring->NextEntry(); // Never full: there are as many entries as slots
+        entry->opcode = m_FixedBuffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        entry->fd = m_Files[slot->file].fd;
+        entry->off = slot->offset + slot->filled;
+        entry->addr = reinterpret_cast<uint64_t>(slot->buffer + slot->filled);
+        entry->len = unsigned(slot->size - slot->filled);
+        entry->buf_index = uint16_t(slot->index);
+        entry->user_data = reinterpret_cast<uint64_t>(slot);
+    }
+
+    void RunIoUring()
+    {
+        std::vector<t_Slot*> spare;
+        for (uint32_t i = 0; i < m_Options.buffers; ++i)
+			spare.push_back(&m_Slots[i]);
+        std::vector<uint32_t> active; // Files being read
+        size_t next_file = 0;
+        uint32_t in_flight = 0;
+
+        while (!m_Stop.load(std::memory_order_relaxed))
+		{
+			t_Slot* slot;
+			while (m_Free.TryPop(slot))
+				spare.push_back(slot);
+
+			// Drop finished files, start new ones, then top every active file's queue up
+			std::erase_if(active, [&](uint32_t file) { return m_Files[file].delivered == m_Files[file].size; });
+			while (active.size() < m_Options.filesInFlight && next_file < m_Files.size())
+				active.push_back(uint32_t(next_file++));
+			if (active.empty())
+				break;
+
+			bool queued = false;
+			for (uint32_t file : active)
+			{
+				t_File& f = m_Files[file];
+				while (!spare.empty() && f.inFlight < m_Options.depthPerFile && f.issued < f.size)
+				{
+					slot = spare.back();
+					spare.pop_back();
+					slot->file = file;
+					slot->offset = f.issued;
+					slot->size = size_t(std::min<uint64_t>(m_Options.chunkBytes, f.size - f.issued));
+					slot->filled = 0;
+					slot->data = slot->buffer;
+					slot->last = f.issued + slot->size == f.size;
+					f.issued += slot->size;
+					++f.inFlight;
+					++in_flight;
+					Queue(slot);
+					queued = true;
+				}
+			}
+
+			if (!in_flight)
+			{
+				// Every buffer is with the consumer or waiting for an earlier chunk: wait for one to come back
+				slot = WaitForFree(spare);
+				if (!slot)
+					break;
+				spare.push_back(slot);
+				continue;
+			}
+
+			// Nothing new went out: sleep in the kernel until a read is done
+			m_Ring->Submit(queued ? 0 : 1);
+
+			io_uring_cqe completion;
+			while (m_Ring->PopCompletion(completion))
+			{
+				slot = reinterpret_cast<t_Slot*>(completion.user_data);
+				t_File& f = m_Files[slot->file];
+				if (completion.res == -EINTR || completion.res == -EAGAIN)
+				{
+					Queue(slot);
+					continue;
+				}
+				if (completion.res <= 0)
+					Fail(completion.res ? -completion.res : EIO, "StreamingReader: read");
+
+				slot->filled += size_t(completion.res);
+				if (slot->filled < slot->size)
+				{
+					Queue(slot); // Short read: ask for the rest
+					continue;
+				}
+				--f.inFlight;
+				--in_flight;
+				f.early.push_back(slot);
+			}
+
+			// Hand over everything that is next in its file
+			for (uint32_t file : active)
+			{
+				t_File& f = m_Files[file];
+				for (bool found = true; found;)
+				{
+					found = false;
+					for (size_t i = 0; i < f.early.size(); ++i)
+					{
+						if (f.early[i]->offset == f.delivered)
+						{
+							f.delivered += f.early[i]->size;
+							Deliver(f.early[i]);
+							f.early[i] = f.early.back();
+							f.early.pop_back();
+							found = true;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+        // Stopped early: the kernel may still be writing into our buffers
+        io_uring_cqe completion;
+        while (in_flight)
+		{
+			m_Ring->Submit(1);
+			while (m_Ring->PopCompletion(completion))
+			{
+				t_Slot* slot = reinterpret_cast<t_Slot*>(completion.user_data);
+				slot->filled += completion.res > 0 ? size_t(completion.res) : 0;
+				if (completion.res > 0 && slot->filled < slot->size && !m_Stop.load(std::memory_order_relaxed))
+					Queue(slot);
+				else
+					--in_flight;
+			}
+		}
+    }
+#endif
+
+    void ReleaseMapped(t_Slot* slot)
+    {
+        t_File& f = m_Files[slot->file];
+        if (--f.withConsumer == 0 && f.delivered == f.size && f.mapped)
+		{
+			munmap(f.mapped, f.size);
+			f.mapped = nullptr;
+		}
+    }
+
+    void RunMapped()
+    {
+        std::vector<t_Slot*> spare;
+        for (uint32_t i = 0; i < m_Options.buffers; ++i)
+			spare.push_back(&m_Slots[i]);
+        const size_t page = size_t(sysconf(_SC_PAGESIZE));
+
+        for (uint32_t file = 0; file < m_Files.size(); ++file)
+		{
+			t_File& f = m_Files[file];
+			if (!f.size)
+				continue;
+			void* p = mmap(nullptr, f.size, PROT_READ, MAP_PRIVATE, f.fd, 0);
+			if (p == MAP_FAILED)
+				Fail(errno, "StreamingReader: mmap");
+			madvise(p, f.size, MADV_SEQUENTIAL);
+			f.mapped = static_cast<char*>(p);
+
+			while (f.delivered < f.size)
+			{
+				t_Slot* slot;
+				while (m_Free.TryPop(slot))
+				{
+					ReleaseMapped(slot);
+					spare.push_back(slot);
+				}
+				if (spare.empty())
+				{
+					if (!(slot = WaitForFree(spare)))
+						return;
+					ReleaseMapped(slot);
+					spare.push_back(slot);
+				}
+
+				slot = spare.back();
+				spare.pop_back();
+				slot->file = file;
+				slot->offset = f.delivered;
+				slot->size = size_t(std::min<uint64_t>(m_Options.chunkBytes, f.size - f.delivered));
+				slot->data = f.mapped + f.delivered;
+				slot->last = f.delivered + slot->size == f.size;
+
+				// Fault the chunk in here, one read per page
+				for (size_t offset = 0; offset < slot->size; offset += page)
+					(void)static_cast<const volatile char*>(slot->data)[offset];
+
+				f.delivered += slot->size;
+				++f.withConsumer;
+				Deliver(slot);
+			}
+		}
+    }
+
+    void Run()
+    {
+        try
+		{
+#if STREAMING_READER_IO_URING
+			if (m_Ring)
+				RunIoUring();
+			else
+				RunMapped();
+#else
+			RunMapped();
+#endif
+		}
+        catch (...)
+		{
+			m_Error = std::current_exception();
+		}
+        m_Ready.Push(nullptr);
+    }
+
+public:
+    explicit StreamingReader(const std::vector<std::string>& paths, const StreamOptions& options = StreamOptions())
+        : m_Options(options),
+          m_Ready(size_t(options.buffers ? options.buffers : 1) + 1),
+          m_Free(options.buffers ? options.buffers : 1)
+    {
+        m_Options.buffers = options.buffers ? options.buffers : 1;
+        m_Options.chunkBytes = options.chunkBytes ? options.chunkBytes : 1;
+        m_Options.depthPerFile = options.depthPerFile ? options.depthPerFile : 1;
+        m_Options.filesInFlight = options.filesInFlight ? options.filesInFlight : 1;
+
+        m_Files.resize(paths.size());
+        try
+		{
+			for (size_t i = 0; i < paths.size(); ++i)
+			{
+				struct stat info;
+				m_Files[i].fd = ::open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+				if (m_Files[i].fd < 0 || fstat(m_Files[i].fd, &info) != 0)
+					Fail(errno, paths[i]);
+				m_Files[i].size = uint64_t(info.st_size);
+			}
+
+#if STREAMING_READER_IO_URING
+			if (m_Options.backend != StreamBackend::Map)
+			{
+				try
+				{
+					m_Ring = std::make_unique<IoUring>(unsigned(NextPowerOfTwo(m_Options.buffers)));
+				}
+				catch (const std::system_error&)
+				{
+					if (m_Options.backend == StreamBackend::IoUring)
+						throw;
+				}
+			}
+#else
+			if (m_Options.backend == StreamBackend::IoUring)
+				Fail(ENOSYS, "StreamingReader: io_uring");
+#endif
+
+			m_Slots.reset(new t_Slot[m_Options.buffers]);
+			for (uint32_t i = 0; i < m_Options.buffers; ++i)
+				m_Slots[i].index = i;
+
+#if STREAMING_READER_IO_URING
+			if (m_Ring)
+			{
+				m_Buffers = static_cast<char*>(m_Backing.AcquireBlock(m_Options.buffers * m_Options.chunkBytes, 4096, m_BufferBytes));
+				std::vector<iovec> buffers(m_Options.buffers);
+				for (uint32_t i = 0; i < m_Options.buffers; ++i)
+				{
+					m_Slots[i].buffer = m_Buffers + i * m_Options.chunkBytes;
+					buffers[i] = { m_Slots[i].buffer, m_Options.chunkBytes };
+				}
+				m_FixedBuffers = m_Ring->RegisterBuffers(buffers.data(), m_Options.buffers);
+			}
+#endif
+		}
+        catch (...)
+		{
+			Close();
+			throw;
+		}
+
+        m_Thread = std::thread([this]() { Run(); });
+    }
+
+    // Stops the I/O thread even if the files weren't read to the end
+    ~StreamingReader()
+    {
+        m_Stop.store(true, std::memory_order_relaxed);
+        m_Thread.join();
+        Close();
+    }
+
+    StreamingReader(const StreamingReader&) = delete;
+    StreamingReader& operator=(const StreamingReader&) = delete;
+
+    size_t FileCount() const { return m_Files.size(); }
+
+    StreamBackend Backend() const
+    {
+#if STREAMING_READER_IO_URING
+        return m_Ring ? StreamBackend::IoUring : StreamBackend::Map;
+#else
+        return StreamBackend::Map;
+#endif
+    }
+
+    // io_uring reads into buffers registered with the kernel (IORING_OP_READ_FIXED)
+    bool FixedBuffers() const { return m_FixedBuffers; }
+
+    // Exact once Next() has returned nullptr
+    StreamStats Stats() const
+    {
+        return { m_Bytes.load(std::memory_order_relaxed), m_Chunks.load(std::memory_order_relaxed),
+                 m_Stalls.load(std::memory_order_relaxed) };
+    }
+
+    // The next chunk, waiting for it if need be; nullptr once every file has been read
+    const StreamChunk* Next()
+    {
+        if (m_Finished)
+			return nullptr;
+
+        SpinBackoff backoff;
+        t_Slot* slot;
+        while (!m_Ready.TryPop(slot))
+			backoff.Pause();
+        if (!slot)
+		{
+			m_Finished = true;
+			if (m_Error)
+				std::rethrow_exception(m_Error);
+		}
+        return slot;
+    }
+
+    // Gives the chunk's buffer back for the next read; its data is gone after this
+    void Release(const StreamChunk* chunk)
+    {
+        m_Free.Push(static_cast<t_Slot*>(const_cast<StreamChunk*>(chunk)));
+    }
+
+private:
+    void Close()
+    {
+#if STREAMING_READER_IO_URING
+        m_Ring.reset(); // Unregisters the buffers
+#endif
+        if (m_Buffers)
+			m_Backing.ReleaseBlock(m_Buffers, m_BufferBytes, 4096);
+        m_Buffers = nullptr;
+        for (t_File& f : m_Files)
+		{
+			if (f.mapped)
+				munmap(f.mapped, f.size);
+			if (f.fd >= 0)
+				::close(f.fd);
+			f.mapped = nullptr;
+			f.fd = -1;
+		}
+    }
+};
+
+namespace StreamDetail
+{
+    inline bool IsSpace(char c) { return static_cast<unsigned char>(c) <= ' '; }
+
+    // A whole token the SIMD path left alone: too long, cut between two chunks, or not a number
+    inline bool ParseToken(std::string_view token, int64_t& value)
+    {
+        const char* begin = token.data();
+        const char* end = begin + token.size();
+        if (begin != end && *begin == '+')
+        {
+            ++begin; // from_chars doesn't take a leading '+'
+            if (begin != end && *begin == '-')
+				return false;
+        }
+        auto [stop, error] = std::from_chars(begin, end, value);
+        return begin != end && error == std::errc() && stop == end;
+    }
+}
+
+/*
+	Calls emit(file, value) for every whitespace separated integer of every
+	file of 'reader', in order within each file. A number cut between two
+	chunks is put back together from a small per file carry. True when
+	everything was read, false at the first token that isn't an int64_t.
+*/
+template<typename Emit>
+bool ParseIntegers(StreamingReader& reader, Emit&& emit)
+{
+    using StreamDetail::IsSpace;
+    std::vector<std::string> carry(reader.FileCount());
+
+    while (const StreamChunk* chunk = reader.Next())
+	{
+		const uint32_t file = chunk->file;
+		const char* p = chunk->data;
+		const char* end = p + chunk->size;
+		std::string& pending = carry[file];
+		bool ok = true;
+
+		if (!pending.empty())
+		{
+			const char* stop = p;
+			while (stop != end && !IsSpace(*stop))
+				++stop;
+			pending.append(p, stop);
+			p = stop;
+			if (p != end || chunk->last)
+			{
+				int64_t value;
+				ok = StreamDetail::ParseToken(pending, value);
+				if (ok)
+					emit(file, value);
+				pending.clear();
+			}
+		}
+
+		while (ok && p != end)
+		{
+			p = SimdIntegerScanner::Scan(p, end, [&](int64_t value)
+			{
+				emit(file, value);
+				return true;
+			});
+
+			// The last few bytes of the chunk, or a token the fast path doesn't take
+			while (p != end && IsSpace(*p))
+				++p;
+			if (p == end)
+				break;
+			const char* stop = p;
+			while (stop != end && !IsSpace(*stop))
+				++stop;
+			if (stop == end && !chunk->last)
+			{
+				pending.assign(p, stop);
+				break;
+			}
+			int64_t value;
+			ok = StreamDetail::ParseToken(std::string_view(p, size_t(stop - p)), value);
+			if (ok)
+				emit(file, value);
+			p = stop;
+		}
+
+		reader.Release(chunk);
+		if (!ok)
+			return false;
+	}
+    return true;
+}
@@ -0,0 +1,97 @@
+// Request handlers doing scratch allocations on thread local arenas
+#include <iostream>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+#include "Thread_local_arena.h"
+
+constexpr size_t REQUEST_COUNT = 200'000;
+constexpr size_t ALLOCS_PER_REQUEST = 16;
+
+// A fake request: a handful of short lived buffers whose contents get summed
+template<typename Alloc, typename Free>
+uint64_t HandleRequest(size_t request, Alloc&& alloc, Free&& release)
+{
+    uint64_t sum = 0;
+    uint32_t* buffers[ALLOCS_PER_REQUEST];
+    size_t sizes[ALLOCS_PER_REQUEST];
+
+    for (size_t i = 0; i < ALLOCS_PER_REQUEST; i++)
+	{
+		sizes[i] = 8 + (request * 7 + i * 13) % 120;
+		buffers[i] = alloc(sizes[i]);
+		for (size_t j = 0; j < sizes[i]; j++)
+		{
+			buffers[i][j] = uint32_t(request + j);
+		}
+	}
+
+    for (size_t i = 0; i < ALLOCS_PER_REQUEST; i++)
+	{
+		sum += buffers[i][sizes[i] - 1];
+		release(buffers[i]);
+	}
+    return sum;
+}
+
+template<typename Worker>
+const BenchmarkResult& RunWorkers(Benchmark& bench, const std::string& name, const size_t thread_count, Worker&& worker)
+{
+    return bench.Run(name, [&]()
+    {
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_count; t++)
+		{
+			threads.emplace_back(worker, REQUEST_COUNT / thread_count);
+		}
+        for (auto& thread : threads)
+		{
+			thread.join();
+		}
+    }, REQUEST_COUNT);
+}
+
+int main(int argc, char** argv)
+{
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv));
+    const size_t thread_count = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+    std::atomic<uint64_t> checksum{ 0 };
+
+    // Arena blocks are 2 MB pages taken from one shared pool
+    PagePoolBacking<> pages(thread_count * 2);
+    ThreadArenas::Configure(PagePoolBacking<>::PageBytes(), &pages);
+
+    RunWorkers(bench, "new/delete", thread_count, [&](size_t requests)
+    {
+        uint64_t sum = 0;
+        for (size_t r = 0; r < requests; r++)
+		{
+			sum += HandleRequest(r,
+				[](size_t n) { return new uint32_t[n]; },
+				[](uint32_t* p) { delete[] p; });
+		}
+        checksum += sum;
+    });
+
+    RunWorkers(bench, "thread local arenas", thread_count, [&](size_t requests)
+    {
+        uint64_t sum = 0;
+        for (size_t r = 0; r < requests; r++)
+		{
+			ArenaScope scratch; // Reset when the request is done
+			sum += HandleRequest(r,
+				[&](size_t n) { return scratch.allocate<uint32_t>(n); },
+				[](uint32_t*) {});
+		}
+        checksum += sum;
+    });
+
+    std::cout << thread_count << " threads, " << REQUEST_COUNT << " requests per run\n";
+    bench.Report();
+    std::cout << "\nChecksum: " << checksum << "\n";
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+// Thread local scratch arenas with a scoped reset
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include "Arena.h"
+#include "Memory_pool.h"
+
+/*
+	Large fixed size pages shared by every thread, handed out as arena blocks.
+	Arenas only come here when they grow, so a lock-free pool without thread
+	caches is plenty. Requests bigger than a page, or made while the pool is
+	empty, fall back to operator new.
+
+	The pool must outlive every arena that uses it, including the thread
+	local ones: destroy it after the worker threads have been joined.
+*/
+template<size_t PageSize = 2 * 1024 * 1024>
+class PagePoolBacking : public BackingProvider
+{
+    struct alignas(4096) t_Page
+    {
+        unsigned char bytes[PageSize];
+    };
+
+    ConcurrentMemoryPool<t_Page> m_Pages;
+
+public:
+    explicit PagePoolBacking(const size_t page_count) : m_Pages(page_count, 1) {}
+
+    static constexpr size_t PageBytes() { return PageSize; }
+
+    size_t PreferredBlockSize() const override { return PageSize; }
+
+    void* AcquireBlock(size_t min_bytes, size_t align, size_t& got_bytes) override
+    {
+        if (min_bytes <= PageSize && align <= alignof(t_Page))
+        {
+            if (t_Page* page = m_Pages.TryAllocate())
+            {
+                got_bytes = PageSize;
+                return page;
+            }
+        }
+
+        return HeapBacking::Instance().AcquireBlock(min_bytes, align, got_bytes);
+    }
+
+    void ReleaseBlock(void* block, size_t bytes, size_t align) override
+    {
+        if (m_Pages.Owns(block))
+        {
+            m_Pages.Deallocate(static_cast<t_Page*>(block));
+            return;
+        }
+        HeapBacking::Instance().ReleaseBlock(block, bytes, align);
+    }
+};
+
+/*
+	One arena per thread, created the first time the thread asks for it.
+	Configure() sets the first block size and backing provider for arenas that
+	don't exist yet, so call it before starting the workers.
+*/
+class ThreadArenas
+{
+    static inline std::atomic<size_t> s_BlockSize{ 64 * 1024 };
+    static inline std::atomic<BackingProvider*> s_Backing{ nullptr };
+
+public:
+    static void Configure(const size_t block_size, BackingProvider* backing = nullptr)
+    {
+        s_BlockSize.store(block_size, std::memory_order_relaxed);
+        s_Backing.store(backing, std::memory_order_release);
+    }
+
+    // The calling thread's arena, no locking involved
+    static Arena& Local()
+    {
+        thread_local Arena arena(s_BlockSize.load(std::memory_order_relaxed),
+                                 s_Backing.load(std::memory_order_acquire));
+        return arena;
+    }
+};
+
+/*
+	Scratch allocations for the current scope:
+
+		void HandleRequest()
+		{
+			ArenaScope scratch;
+			char* buffer = scratch.allocate<char>(4096);
+			...
+		}   // everything allocated through the thread's arena since 'scratch' is gone
+
+	Scopes nest: an inner scope only rolls back what was allocated inside it.
+	The outermost scope leaves the arena empty, as if reset() was called.
+*/
+class ArenaScope
+{
+    Arena& m_Arena;
+    Arena::Marker m_Marker;
+
+public:
+    ArenaScope() : m_Arena(ThreadArenas::Local()), m_Marker(m_Arena.mark()) {}
+    ~ArenaScope() { m_Arena.rollback(m_Marker); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+    Arena& arena() const { return m_Arena; }
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t))
+    {
+        return m_Arena.allocate(size, align);
+    }
+
+    template<typename T>
+    T* allocate(size_t count = 1)
+    {
+        return m_Arena.allocate<T>(count);
+    }
+};
@@ -0,0 +1,226 @@
+// Scaling from 1 to all cores: AutoArray scans, bulk random fills, uneven work and block sorts on a WorkStealingPool
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Auto_array.h"
+#include "Benchmark.h"
+#include "Simd_random.h"
+#include "Work_stealing_pool.h"
+
+constexpr size_t SCAN_COUNT = 1 << 25;      // 128 MB of uint32_t
+constexpr size_t FILL_COUNT = 1 << 24;      // 128 MB of uint64_t
+constexpr size_t UNEVEN_COUNT = 1 << 14;
+constexpr size_t SORT_COUNT = 1 << 24;
+constexpr size_t SORT_BLOCK = 1 << 16;
+constexpr size_t SPAWN_COUNT = 1 << 20;
+constexpr size_t SMALL_FOR = 64;
+constexpr size_t PIECE = 1 << 16;           // Fixed grain: the same pieces, and the same results, for any thread count
+
+// Item i costs about i / 4 rounds: the last quarter of the range holds almost half the work
+uint64_t UnevenWork(size_t i)
+{
+    uint64_t x = i;
+    for (size_t round = 0; round < i / 4; round++)
+	{
+		x ^= x >> 31;
+		x *= 0x7FB5D329728EA185;
+	}
+    return x;
+}
+
+// LSD radix sort of one block, 8 bits per pass; 'scratch' holds as many keys as 'keys'
+void RadixSort(uint32_t* keys, uint32_t* scratch, size_t count)
+{
+    for (int shift = 0; shift < 32; shift += 8)
+	{
+		size_t offsets[256] = {};
+		for (size_t i = 0; i < count; i++)
+			++offsets[(keys[i] >> shift) & 0xFF];
+		size_t total = 0;
+		for (size_t& offset : offsets)
+		{
+			size_t n = offset;
+			offset = total;
+			total += n;
+		}
+		for (size_t i = 0; i < count; i++)
+			scratch[offsets[(keys[i] >> shift) & 0xFF]++] = keys[i];
+		std::swap(keys, scratch);
+	}
+    // Four passes: the sorted keys are back in the caller's array
+}
+
+// Powers of two up to the core count, and the core count itself
+std::vector<size_t> ThreadCounts()
+{
+    const size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    std::vector<size_t> counts;
+    for (size_t n = 1; n < cores; n *= 2)
+		counts.push_back(n);
+    counts.push_back(cores);
+    return counts;
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions defaults;
+    defaults.repetitions = 5;
+    Benchmark bench(BenchmarkOptions::FromArgs(argc, argv, defaults));
+    const std::vector<size_t> thread_counts = ThreadCounts();
+
+    AutoArray<uint32_t> scan(SCAN_COUNT);
+    for (size_t i = 0; i < SCAN_COUNT; i++)
+		scan[i] = uint32_t(i * 2654435761u);
+
+    AutoArray<uint64_t> fill(FILL_COUNT);
+    AutoArray<uint32_t> unsorted(SORT_COUNT), keys(SORT_COUNT);
+    SimdRandom<>(7).Fill(std::span<uint32_t>(unsorted.data(), SORT_COUNT), 0, UINT32_MAX);
+
+    // Single threaded baselines
+    uint64_t serial_sum = 0;
+    bench.Run("scan: AutoArray sum, plain loop", [&]()
+    {
+        uint64_t sum = 0;
+        for (uint32_t value : scan)
+			sum += value;
+        serial_sum = sum;
+        DoNotOptimize(sum);
+    }, SCAN_COUNT);
+
+    bench.Run("fill: SimdRandom, one generator", [&]()
+    {
+        SimdRandom<>(1).Fill(std::span<uint64_t>(fill.data(), FILL_COUNT));
+        ClobberMemory();
+    }, FILL_COUNT);
+
+    bench.Run("uneven: plain loop", [&]()
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < UNEVEN_COUNT; i++)
+			total += UnevenWork(i);
+        DoNotOptimize(total);
+    }, UNEVEN_COUNT);
+
+    bench.RunWithSetup("sort: 64K blocks, heap scratch per block", [&]()
+    {
+        std::memcpy(keys.data(), unsorted.data(), SORT_COUNT * sizeof(uint32_t));
+    }, [&]()
+    {
+        for (size_t block = 0; block < SORT_COUNT; block += SORT_BLOCK)
+		{
+			std::vector<uint32_t> scratch(SORT_BLOCK);
+			RadixSort(keys.data() + block, scratch.data(), SORT_BLOCK);
+		}
+        ClobberMemory();
+    }, SORT_COUNT);
+
+    for (size_t threads : thread_counts)
+	{
+		WorkStealingPool pool(threads);
+		const std::string suffix = ", " + std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+
+		uint64_t parallel_sum = 0;
+		bench.Run("scan: ParallelReduce" + suffix, [&]()
+		{
+			const uint32_t* values = scan.data();
+			parallel_sum = ParallelReduce(pool, 0, SCAN_COUNT, PIECE, uint64_t(0), [values](size_t begin, size_t end)
+			{
+				uint64_t sum = 0;
+				for (size_t i = begin; i < end; i++)
+					sum += values[i];
+				return sum;
+			}, [](uint64_t a, uint64_t b) { return a + b; });
+			DoNotOptimize(parallel_sum);
+		}, SCAN_COUNT);
+		if (parallel_sum != serial_sum)
+			std::cout << "scan" << suffix << ": wrong sum\n";
+
+		// One generator per 1M piece, seeded by the piece number: the output doesn't depend on who ran what
+		bench.Run("fill: SimdRandom per piece" + suffix, [&]()
+		{
+			ParallelFor(pool, 0, FILL_COUNT / (16 * PIECE), 1, [&](size_t begin, size_t end)
+			{
+				for (size_t piece = begin; piece < end; piece++)
+					SimdRandom<>(1 + piece).Fill(std::span<uint64_t>(fill.data() + piece * 16 * PIECE, 16 * PIECE));
+			});
+			ClobberMemory();
+		}, FILL_COUNT);
+
+		// Contiguous slices per thread: whoever gets the last slice does the most work while the others wait
+		bench.Run("uneven: std::thread per equal slice" + suffix, [&]()
+		{
+			std::vector<uint64_t> totals(threads);
+			std::vector<std::thread> workers;
+			for (size_t t = 0; t < threads; t++)
+			{
+				workers.emplace_back([&, t]()
+				{
+					uint64_t total = 0;
+					for (size_t i = UNEVEN_COUNT * t / threads; i < UNEVEN_COUNT * (t + 1) / threads; i++)
+						total += UnevenWork(i);
+					totals[t] = total;
+				});
+			}
+			for (std::thread& worker : workers)
+				worker.join();
+			DoNotOptimize(totals.data());
+		}, UNEVEN_COUNT);
+
+		bench.Run("uneven: ParallelReduce, grain 64" + suffix, [&]()
+		{
+			uint64_t total = ParallelReduce(pool, 0, UNEVEN_COUNT, 64, uint64_t(0), [](size_t begin, size_t end)
+			{
+				uint64_t sum = 0;
+				for (size_t i = begin; i < end; i++)
+					sum += UnevenWork(i);
+				return sum;
+			}, [](uint64_t a, uint64_t b) { return a + b; });
+			DoNotOptimize(total);
+		}, UNEVEN_COUNT);
+
+		// The scratch buffer comes from the worker's arena and is rolled back when the task returns
+		bench.RunWithSetup("sort: 64K blocks, arena scratch" + suffix, [&]()
+		{
+			std::memcpy(keys.data(), unsorted.data(), SORT_COUNT * sizeof(uint32_t));
+		}, [&]()
+		{
+			ParallelFor(pool, 0, SORT_COUNT / SORT_BLOCK, 1, [&](size_t begin, size_t end)
+			{
+				uint32_t* scratch = WorkStealingPool::Scratch().allocate<uint32_t>(SORT_BLOCK);
+				for (size_t block = begin; block < end; block++)
+					RadixSort(keys.data() + block * SORT_BLOCK, scratch, SORT_BLOCK);
+			});
+			ClobberMemory();
+		}, SORT_COUNT);
+
+		// Task overhead: one task per index, nothing to do in it
+		bench.Run("spawn: ParallelFor, grain 1, empty body" + suffix, [&]()
+		{
+			ParallelFor(pool, 0, SPAWN_COUNT, 1, [](size_t begin, size_t) { DoNotOptimize(begin); });
+		}, SPAWN_COUNT);
+
+		// Short fork-joins: the calling thread spawns and runs a big share of the tasks, through its own task cache
+		bench.Run("spawn: small ParallelFor calls, grain 1" + suffix, [&]()
+		{
+			for (size_t i = 0; i < SPAWN_COUNT; i += SMALL_FOR)
+				ParallelFor(pool, 0, SMALL_FOR, 1, [](size_t begin, size_t) { DoNotOptimize(begin); });
+		}, SPAWN_COUNT);
+		// Batched: the free blocks are still on the stack in magazines of 64, not one block at a time
+		const auto stack = pool.TaskStack();
+		std::cout << "task stack" << suffix << ": " << stack.blocks << " blocks in " << stack.magazines << " magazines\n";
+	}
+
+    bool sorted = true;
+    for (size_t block = 0; block < SORT_COUNT; block += SORT_BLOCK)
+		sorted = sorted && std::is_sorted(keys.data() + block, keys.data() + block + SORT_BLOCK);
+    if (!sorted)
+		std::cout << "sort: blocks not sorted\n";
+
+    bench.Report();
+    return 0;
+}
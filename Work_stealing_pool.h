@@ -0,0 +1,509 @@
+// Work-stealing thread pool: a Chase-Lev deque per worker, pooled task objects, per-task scratch arenas, ParallelFor / ParallelReduce
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Asm_kernels.h"
+#include "Bit_tricks.h"
+#include "Memory_pool.h"
+#include "Ring_buffer.h"
+#include "Thread_local_arena.h"
+
+/*
+	Chase-Lev work-stealing deque (Chase & Lev 2005, memory orders from
+	Le, Pop, Cohen & Zappa Nardelli 2013). The owner pushes and pops at the
+	bottom like a stack: newest first, still hot in its cache. Thieves take
+	from the top: oldest first, which in divide and conquer is the biggest
+	piece left. Owner and thieves only race for the last element, with a
+	CAS on 'top'.
+
+	The buffer doubles when full. Thieves may still be reading the old one,
+	so old buffers are kept until the deque goes away (together they are
+	smaller than the current one).
+*/
+template<typename T>
+class ChaseLevDeque
+{
+    static_assert(std::is_trivially_copyable_v<T>, "ChaseLevDeque: elements are copied through relaxed atomics");
+
+    struct t_Buffer
+    {
+        const int64_t mask;
+        const std::unique_ptr<std::atomic<T>[]> slots;
+
+        explicit t_Buffer(int64_t capacity) : mask(capacity - 1), slots(new std::atomic<T>[size_t(capacity)]) {}
+
+        T Get(int64_t index) const { return slots[index & mask].load(std::memory_order_relaxed); }
+        void Put(int64_t index, T value) { slots[index & mask].store(value, std::memory_order_relaxed); }
+    };
+
+    alignas(64) std::atomic<int64_t> m_Top{ 0 };
+    alignas(64) std::atomic<int64_t> m_Bottom{ 0 };
+    std::atomic<t_Buffer*> m_Buffer;
+    std::vector<std::unique_ptr<t_Buffer>> m_Buffers; // Every buffer so far, the current one last (owner only)
+
+    t_Buffer* Grow(t_Buffer* buffer, int64_t top, int64_t bottom)
+    {
+        auto bigger = std::make_unique<t_Buffer>(2 * (buffer->mask + 1));
+        for (int64_t i = top; i < bottom; ++i)
+			bigger->Put(i, buffer->Get(i));
+        buffer = bigger.get();
+        m_Buffers.push_back(std::move(bigger));
+        m_Buffer.store(buffer, std::memory_order_release);
+        return buffer;
+    }
+
+public:
+    // Rounded up to a power of two
+    explicit ChaseLevDeque(size_t capacity = 256)
+    {
+        m_Buffers.push_back(std::make_unique<t_Buffer>(int64_t(NextPowerOfTwo(capacity < 2 ? size_t(2) : capacity))));
+        m_Buffer.store(m_Buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    // Owner only
+    void Push(T value)
+    {
+        int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+        int64_t top = m_Top.load(std::memory_order_acquire);
+        t_Buffer* buffer = m_Buffer.load(std::memory_order_relaxed);
+        if (bottom - top > buffer->mask)
+			buffer = Grow(buffer, top, bottom);
+        buffer->Put(bottom, value);
+        m_Bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    // Owner only: the newest element
+    bool Pop(T& out)
+    {
+        int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+        t_Buffer* buffer = m_Buffer.load(std::memory_order_relaxed);
+
+        // Store then load, both seq_cst: either a thief sees the lower bottom or we see its higher top
+        m_Bottom.store(bottom, std::memory_order_seq_cst);
+        int64_t top = m_Top.load(std::memory_order_seq_cst);
+        if (top > bottom)
+        {
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        out = buffer->Get(bottom);
+        if (top < bottom)
+			return true;
+
+        // The last element: whoever moves 'top' first gets it
+        bool won = m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    // Any thread: the oldest element. False when empty, or when another thread took it first
+    bool Steal(T& out)
+    {
+        int64_t top = m_Top.load(std::memory_order_seq_cst);
+        int64_t bottom = m_Bottom.load(std::memory_order_seq_cst);
+        if (top >= bottom)
+			return false;
+
+        out = m_Buffer.load(std::memory_order_acquire)->Get(top);
+        return m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    bool EmptyApprox() const
+    {
+        return m_Top.load(std::memory_order_acquire) >= m_Bottom.load(std::memory_order_acquire);
+    }
+};
+
+/*
+	Fixed set of threads running small tasks:
+
+		WorkStealingPool pool;              // hardware_concurrency() threads, the caller included
+		WorkStealingPool::TaskGroup group;
+		pool.Spawn(group, [&]() { ... });   // from any thread, tasks included
+		pool.Wait(group);                   // runs tasks too until the group is done
+
+	A pool of N threads starts N - 1 workers: the thread blocked in Wait()
+	is the last one. Each worker owns a Chase-Lev deque. A task spawned by a
+	worker goes to the bottom of its own deque; one spawned from outside
+	goes to a shared MpmcRing. An idle thread pops its own deque, then the
+	ring, then steals from the other workers starting at a random one, and
+	after a short spin sleeps until a Spawn() wakes it.
+
+	Tasks live in 64 byte blocks of a ConcurrentMemoryPool: a worker
+	allocates from its ThreadCache and frees into the cache of whichever
+	thread ran the task, so spawning doesn't call the heap. Threads that
+	aren't workers share one more cache, taken with a try-lock; whoever
+	finds it busy goes to the pool directly. The callable is
+	stored in the block and must fit 48 bytes (capture by reference); when
+	the pool has no block left, Spawn() runs the callable right away.
+
+	Every task runs inside an ArenaScope on its thread's ThreadArenas
+	arena: Scratch() memory is rolled back when the task returns, so a
+	worker's arena is empty again between one task and the next and never
+	calls the heap once it has grown. Tasks must not throw.
+*/
+class WorkStealingPool
+{
+public:
+    class TaskGroup
+    {
+        friend class WorkStealingPool;
+        std::atomic<size_t> m_Pending{ 0 };
+
+    public:
+        TaskGroup() = default;
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        bool Done() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+    };
+
+private:
+    static constexpr size_t s_InlineBytes = 48;
+    static constexpr int s_IdleSpins = 16; // Failed looks for work before a worker goes to sleep
+
+    struct t_Task
+    {
+        void (*run)(t_Task& task); // Calls the callable and destroys it
+        TaskGroup* group;
+        alignas(std::max_align_t) unsigned char callable[s_InlineBytes];
+    };
+    static_assert(sizeof(t_Task) == 64, "WorkStealingPool: a task is one cache line");
+
+    using t_TaskPool = ConcurrentMemoryPool<t_Task>;
+
+    struct alignas(64) t_Worker
+    {
+        WorkStealingPool& pool;
+        ChaseLevDeque<t_Task*> deque;
+        t_TaskPool::ThreadCache tasks;
+        uint64_t victimState; // xorshift state for picking whom to steal from
+        std::thread thread;
+
+        t_Worker(WorkStealingPool& owner, uint64_t seed) : pool(owner), tasks(owner.m_Tasks), victimState(seed | 1) {}
+
+        size_t NextVictim()
+        {
+            victimState ^= victimState << 13;
+            victimState ^= victimState >> 7;
+            victimState ^= victimState << 17;
+            return size_t(victimState);
+        }
+    };
+
+    t_TaskPool m_Tasks;              // Declared first: outlives the workers' caches
+    MpmcRing<t_Task*> m_Injected;    // Tasks spawned by threads that aren't workers
+    t_TaskPool::ThreadCache m_OutsideTasks; // The thread in Wait() spawns and runs a share of the tasks too
+    std::atomic<bool> m_OutsideBusy{ false };
+    std::vector<std::unique_ptr<t_Worker>> m_Workers;
+    alignas(64) std::atomic<uint32_t> m_WakeEpoch{ 0 };
+    std::atomic<uint32_t> m_Sleeping{ 0 };
+    std::atomic<bool> m_Stop{ false };
+
+    static inline thread_local t_Worker* s_Current = nullptr;
+
+    t_Worker* CurrentWorker() const
+    {
+        return s_Current && &s_Current->pool == this ? s_Current : nullptr;
+    }
+
+    t_Task* FindWork(t_Worker* self)
+    {
+        t_Task* task;
+        if (self && self->deque.Pop(task))
+			return task;
+        if (m_Injected.TryPop(task))
+			return task;
+
+        const size_t count = m_Workers.size();
+        const size_t start = self ? self->NextVictim() : 0;
+        for (size_t i = 0; i < count; ++i)
+		{
+			t_Worker& victim = *m_Workers[(start + i) % count];
+			if (&victim != self && victim.deque.Steal(task))
+				return task;
+		}
+        return nullptr;
+    }
+
+    // Task blocks for threads that aren't workers: through m_OutsideTasks when no other such thread holds it
+    t_Task* AllocateOutside()
+    {
+        if (m_OutsideBusy.exchange(true, std::memory_order_acquire))
+			return m_Tasks.TryAllocate();
+        t_Task* task = m_OutsideTasks.TryAllocate();
+        m_OutsideBusy.store(false, std::memory_order_release);
+        return task;
+    }
+
+    void DeallocateOutside(t_Task* task)
+    {
+        if (m_OutsideBusy.exchange(true, std::memory_order_acquire))
+		{
+			m_Tasks.Deallocate(task);
+			return;
+		}
+        m_OutsideTasks.Deallocate(task);
+        m_OutsideBusy.store(false, std::memory_order_release);
+    }
+
+    void RunTask(t_Task* task, t_Worker* self)
+    {
+        TaskGroup* group = task->group;
+        {
+            ArenaScope scratch;
+            task->run(*task);
+        }
+        if (self)
+			self->tasks.Deallocate(task);
+        else
+			DeallocateOutside(task);
+
+        // Last touch of the group: Wait() may return and destroy it right after
+        group->m_Pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    // Pairs with the worker's increment of m_Sleeping in WorkerLoop: one of the two sees the other
+    void WakeOne()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_Sleeping.load(std::memory_order_relaxed))
+        {
+            m_WakeEpoch.fetch_add(1, std::memory_order_release);
+            m_WakeEpoch.notify_one();
+        }
+    }
+
+    void WorkerLoop(t_Worker& self)
+    {
+        s_Current = &self;
+        int idle = 0;
+        while (!m_Stop.load(std::memory_order_relaxed))
+		{
+			if (t_Task* task = FindWork(&self))
+			{
+				RunTask(task, &self);
+				idle = 0;
+				continue;
+			}
+			if (++idle < s_IdleSpins)
+			{
+				SpinPause();
+				continue;
+			}
+
+			// Announce we are going to sleep, then look once more: a Spawn() in between either sees us or we see its task
+			uint32_t epoch = m_WakeEpoch.load(std::memory_order_acquire);
+			m_Sleeping.fetch_add(1, std::memory_order_seq_cst);
+			// Orders the increment before FindWork()'s relaxed loads, as the fence in WakeOne() does for the push
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			t_Task* task = FindWork(&self);
+			if (!task && !m_Stop.load(std::memory_order_relaxed))
+				m_WakeEpoch.wait(epoch, std::memory_order_acquire);
+			m_Sleeping.fetch_sub(1, std::memory_order_relaxed);
+			if (task)
+				RunTask(task, &self);
+			idle = 0;
+		}
+        s_Current = nullptr;
+    }
+
+public:
+    // 'thread_count' includes the thread that calls Wait(); 'task_blocks' bounds the tasks alive at once
+    explicit WorkStealingPool(size_t thread_count = std::thread::hardware_concurrency(), size_t task_blocks = 16 * 1024)
+        : m_Tasks(task_blocks), m_Injected(1024), m_OutsideTasks(m_Tasks)
+    {
+        const size_t worker_count = thread_count > 1 ? thread_count - 1 : 0;
+        m_Workers.reserve(worker_count);
+        for (size_t i = 0; i < worker_count; ++i)
+			m_Workers.push_back(std::make_unique<t_Worker>(*this, 0x9E3779B97F4A7C15 * (i + 1)));
+
+        // Only once the list is complete: thieves walk it without a lock
+        for (auto& worker : m_Workers)
+			worker->thread = std::thread([this, self = worker.get()]() { WorkerLoop(*self); });
+    }
+
+    // Wait for your groups first: tasks still queued are never run
+    ~WorkStealingPool()
+    {
+        m_Stop.store(true, std::memory_order_relaxed);
+        m_WakeEpoch.fetch_add(1, std::memory_order_release);
+        m_WakeEpoch.notify_all();
+        for (auto& worker : m_Workers)
+			worker->thread.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t ThreadCount() const { return m_Workers.size() + 1; }
+
+    // Free task blocks on the pool's shared stack, between groups (see ConcurrentMemoryPool::SharedStack)
+    t_TaskPool::StackShape TaskStack() const { return m_Tasks.SharedStack(); }
+
+    // The calling thread's scratch arena: inside a task, everything allocated from it is freed when the task returns
+    static Arena& Scratch() { return ThreadArenas::Local(); }
+
+    template<typename F>
+    void Spawn(TaskGroup& group, F&& f)
+    {
+        using t_Callable = std::decay_t<F>;
+        static_assert(sizeof(t_Callable) <= s_InlineBytes && alignof(t_Callable) <= alignof(std::max_align_t),
+                      "WorkStealingPool: the callable must fit in 48 bytes, capture by reference");
+
+        t_Worker* self = CurrentWorker();
+        t_Task* task = self ? self->tasks.TryAllocate() : AllocateOutside();
+        if (!task)
+        {
+            // Out of task blocks: running it here only costs parallelism
+            f();
+            return;
+        }
+
+        ::new (static_cast<void*>(task->callable)) t_Callable(std::forward<F>(f));
+        task->run = [](t_Task& t)
+        {
+            t_Callable* callable = std::launder(reinterpret_cast<t_Callable*>(t.callable));
+            (*callable)();
+            std::destroy_at(callable);
+        };
+        task->group = &group;
+        group.m_Pending.fetch_add(1, std::memory_order_relaxed);
+
+        if (self)
+			self->deque.Push(task);
+        else if (!m_Injected.TryPush(task))
+		{
+			RunTask(task, nullptr);
+			return;
+		}
+        WakeOne();
+    }
+
+    // Runs queued tasks, this group's or not, until every task of 'group' is done
+    void Wait(TaskGroup& group)
+    {
+        t_Worker* self = CurrentWorker();
+        SpinBackoff backoff;
+        while (group.m_Pending.load(std::memory_order_acquire))
+		{
+			if (t_Task* task = FindWork(self))
+			{
+				RunTask(task, self);
+				backoff.Reset();
+			}
+			else
+				backoff.Pause();
+		}
+    }
+};
+
+namespace WorkStealingDetail
+{
+    template<typename Body>
+    struct t_ForContext
+    {
+        WorkStealingPool& pool;
+        WorkStealingPool::TaskGroup& group;
+        Body& body;
+        size_t grain;
+    };
+
+    // Splits off the upper half as a task until the piece is small enough, then runs it
+    template<typename Body>
+    void Split(t_ForContext<Body>& context, size_t first, size_t last)
+    {
+        while (last - first > context.grain)
+		{
+			size_t middle = first + (last - first) / 2;
+			context.pool.Spawn(context.group, [&context, middle, last]() { Split(context, middle, last); });
+			last = middle;
+		}
+        context.body(first, last);
+    }
+
+    // About 8 pieces per thread: enough slack to even out uneven pieces
+    inline size_t DefaultGrain(const WorkStealingPool& pool, size_t count)
+    {
+        size_t grain = count / (8 * pool.ThreadCount());
+        return grain ? grain : 1;
+    }
+}
+
+/*
+	Calls body(begin, end) on pieces of [first, last) of at most 'grain'
+	indices (0: about 8 pieces per thread) and returns when all are done.
+	The range is halved recursively and each upper half becomes a task, so
+	a thief always takes half of the biggest piece left.
+*/
+template<typename Body>
+void ParallelFor(WorkStealingPool& pool, size_t first, size_t last, size_t grain, Body&& body)
+{
+    if (first >= last)
+		return;
+
+    WorkStealingPool::TaskGroup group;
+    WorkStealingDetail::t_ForContext<std::remove_reference_t<Body>> context{
+        pool, group, body, grain ? grain : WorkStealingDetail::DefaultGrain(pool, last - first) };
+    {
+        // The first piece runs right here, with the same scratch rules as a task
+        ArenaScope scratch;
+        WorkStealingDetail::Split(context, first, last);
+    }
+    pool.Wait(group);
+}
+
+// f(element) for every element of a contiguous range (AutoArray, std::vector, std::span...)
+template<typename Range, typename F>
+void ParallelForEach(WorkStealingPool& pool, Range& range, F&& f, size_t grain = 0)
+{
+    auto* data = std::data(range);
+    ParallelFor(pool, 0, std::size(range), grain, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+			f(data[i]);
+    });
+}
+
+/*
+	map(begin, end) on pieces of 'grain' indices (0: about 8 pieces per
+	thread), then combine(result, piece) from left to right. The pieces only
+	depend on 'grain', so with an explicit grain the result is the same for
+	any number of threads, floating point sums included.
+*/
+template<typename T, typename Map, typename Combine>
+T ParallelReduce(WorkStealingPool& pool, size_t first, size_t last, size_t grain, T identity, Map&& map, Combine&& combine)
+{
+    if (first >= last)
+		return identity;
+
+    grain = grain ? grain : WorkStealingDetail::DefaultGrain(pool, last - first);
+    const size_t pieces = (last - first + grain - 1) / grain;
+    std::vector<T> partials(pieces, identity);
+    ParallelFor(pool, 0, pieces, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t piece = begin; piece < end; ++piece)
+		{
+			size_t piece_first = first + piece * grain;
+			partials[piece] = map(piece_first, std::min(last, piece_first + grain));
+		}
+    });
+
+    T result = std::move(identity);
+    for (T& partial : partials)
+		result = combine(std::move(result), std::move(partial));
+    return result;
+}